@@ -1,30 +1,273 @@
+import gzip
+import hashlib
+import os
+
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.const import CONF_ID
+from esphome.cpp_generator import cpp_string_escape
 
 ftp_http_proxy_ns = cg.esphome_ns.namespace('ftp_http_proxy')
 FTPHTTPProxy = ftp_http_proxy_ns.class_('FTPHTTPProxy', cg.Component)
 
 CONF_FTP_SERVER = 'ftp_server'
+CONF_FTP_PORT = 'ftp_port'
 CONF_USERNAME = 'username'
 CONF_PASSWORD = 'password'
 CONF_LOCAL_PORT = 'local_port'
+CONF_CONNECT_TIMEOUT = 'connect_timeout'
+CONF_PASSIVE_MODE = 'passive_mode'
+CONF_DNS_REFRESH_INTERVAL = 'dns_refresh_interval'
+CONF_POOL_SIZE = 'pool_size'
+CONF_IDLE_TIMEOUT = 'idle_timeout'
+CONF_TRANSFER_WORKERS = 'transfer_workers'
+CONF_TRANSFER_QUEUE_SIZE = 'transfer_queue_size'
+CONF_RELAY_BUFFER_COUNT = 'relay_buffer_count'
+CONF_RELAY_BUFFER_SIZE = 'relay_buffer_size'
+CONF_RELAY_USE_PSRAM = 'relay_use_psram'
+CONF_READ_AHEAD_SIZE = 'read_ahead_size'
+CONF_COALESCING_BUFFER_SIZE = 'coalescing_buffer_size'
+CONF_SHARE_TOKENS = 'share_tokens'
+CONF_LISTING_CACHE_TTL = 'listing_cache_ttl'
+CONF_METADATA_CACHE_TTL = 'metadata_cache_ttl'
+CONF_CACHE = 'cache'
+CONF_SIZE = 'size'
+CONF_MAX_FILE_SIZE = 'max_file_size'
+CONF_REVALIDATE_INTERVAL = 'revalidate_interval'
+CONF_DIRECTORY = 'directory'
+CONF_DIRECTORY_SIZE = 'directory_size'
+CONF_SEGMENTED_FETCH = 'segmented_fetch'
+CONF_CONNECTIONS = 'connections'
+CONF_SEGMENT_SIZE = 'segment_size'
+CONF_MIN_FILE_SIZE = 'min_file_size'
+CONF_PERSISTENCE = 'persistence'
+CONF_PARTITION = 'partition'
+CONF_FLUSH_INTERVAL = 'flush_interval'
+CONF_MIME_TYPES = 'mime_types'
+CONF_EXTENSION = 'extension'
+CONF_TYPE = 'type'
+CONF_DISPOSITION = 'disposition'
+CONF_CACHEABLE = 'cacheable'
+CONF_READ_AHEAD = 'read_ahead'
+CONF_MOUNTS = 'mounts'
+CONF_PREFIX = 'prefix'
+CONF_PATH = 'path'
+
+# Drapeaux de MimePolicy (mime_types.h)
+MIME_INLINE = 1 << 0
+MIME_CACHEABLE = 1 << 1
+MIME_READ_AHEAD = 1 << 2
+
+INDEX_HTML = os.path.join(os.path.dirname(__file__), 'web', 'index.html')
+
+
+def gzip_asset(path):
+    """Compresse un fichier de l'interface; mtime=0 pour un résultat reproductible."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    compressed = gzip.compress(data, compresslevel=9, mtime=0)
+    etag = '"' + hashlib.sha1(compressed).hexdigest()[:16] + '"'
+    return compressed, etag
+
+
+def asset_definition(name, data, etag):
+    """Définition C++ des octets compressés, de leur taille et de l'ETag (liaison externe)."""
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append('  ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+    return (
+        'namespace esphome {\nnamespace ftp_http_proxy {\n'
+        f'extern const uint8_t {name}_GZ[] = {{\n' + '\n'.join(rows) + '\n};\n'
+        f'extern const size_t {name}_GZ_SIZE = {len(data)};\n'
+        f'extern const char {name}_ETAG[] = "{etag.replace(chr(34), chr(92) + chr(34))}";\n'
+        '}  // namespace ftp_http_proxy\n}  // namespace esphome'
+    )
+
+
+CACHE_SCHEMA = cv.Schema({
+    cv.Optional(CONF_SIZE, default=0): cv.int_range(min=0),
+    cv.Optional(CONF_MAX_FILE_SIZE, default=524288): cv.int_range(min=1024),
+    cv.Optional(CONF_REVALIDATE_INTERVAL, default='10s'): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_DIRECTORY): cv.string,
+    cv.Optional(CONF_DIRECTORY_SIZE, default=0): cv.int_range(min=0),
+})
+
+def mime_extension(value):
+    """Extension sans le point, en minuscules, comparée telle quelle par lookup_mime_type()."""
+    value = cv.string_strict(value).lower().lstrip('.')
+    if not value or not all(c.isalnum() or c in '-_+' for c in value):
+        raise cv.Invalid(f"Extension invalide: '{value}'")
+    return value
+
+
+MIME_TYPE_SCHEMA = cv.Schema({
+    cv.Required(CONF_EXTENSION): mime_extension,
+    cv.Required(CONF_TYPE): cv.string_strict,
+    cv.Optional(CONF_DISPOSITION, default='inline'): cv.one_of('inline', 'attachment', lower=True),
+    cv.Optional(CONF_CACHEABLE, default=True): cv.boolean,
+    # Par défaut: lecture anticipée pour les types audio/* et video/*
+    cv.Optional(CONF_READ_AHEAD): cv.boolean,
+})
+
+
+def mime_table_definition(entries):
+    """Table MIME_TYPES_EXTRA triée par extension (recherche dichotomique côté C++)."""
+    rows = []
+    for entry in sorted(entries, key=lambda e: e[CONF_EXTENSION].encode()):
+        policy = 0
+        if entry[CONF_DISPOSITION] == 'inline':
+            policy |= MIME_INLINE
+        if entry[CONF_CACHEABLE]:
+            policy |= MIME_CACHEABLE
+        read_ahead = entry.get(CONF_READ_AHEAD, entry[CONF_TYPE].startswith(('audio/', 'video/')))
+        if read_ahead:
+            policy |= MIME_READ_AHEAD
+        rows.append(f'  {{{cpp_string_escape(entry[CONF_EXTENSION])}, {cpp_string_escape(entry[CONF_TYPE])}, {policy}}},')
+    if not rows:
+        # Un tableau C++ ne peut pas être vide: entrée sentinelle jamais consultée (compte à 0)
+        rows.append('  {"", "", 0},')
+    return (
+        'namespace esphome {\nnamespace ftp_http_proxy {\n'
+        'extern const MimeType MIME_TYPES_EXTRA[] = {\n' + '\n'.join(rows) + '\n};\n'
+        f'extern const size_t MIME_TYPES_EXTRA_COUNT = {len(entries)};\n'
+        '}  // namespace ftp_http_proxy\n}  // namespace esphome'
+    )
+
+
+def unique_mime_extensions(entries):
+    seen = set()
+    for entry in entries:
+        if entry[CONF_EXTENSION] in seen:
+            raise cv.Invalid(f"Extension '{entry[CONF_EXTENSION]}' déclarée plusieurs fois")
+        seen.add(entry[CONF_EXTENSION])
+    return entries
 
-CONFIG_SCHEMA = cv.Schema({
+
+SEGMENTED_FETCH_SCHEMA = cv.Schema({
+    cv.Optional(CONF_CONNECTIONS, default=1): cv.int_range(min=1, max=4),
+    cv.Optional(CONF_SEGMENT_SIZE, default=262144): cv.int_range(min=16384, max=1048576),
+    cv.Optional(CONF_MIN_FILE_SIZE, default=4194304): cv.int_range(min=0),
+})
+
+PERSISTENCE_SCHEMA = cv.Schema({
+    cv.Required(CONF_PARTITION): cv.All(cv.string, cv.Length(min=1, max=16)),
+    cv.Optional(CONF_FLUSH_INTERVAL, default='30s'): cv.positive_time_period_milliseconds,
+})
+
+def mount_prefix(value):
+    """Premier(s) segment(s) du chemin d'URL, sans '/' initial ni final."""
+    value = cv.string_strict(value).strip('/')
+    if not value or '..' in value.split('/'):
+        raise cv.Invalid(f"Préfixe de mount invalide: '{value}'")
+    return value
+
+
+def mount_root(value):
+    """Répertoire VFS absolu (point de montage SD/LittleFS), sans '/' final."""
+    value = cv.string_strict(value)
+    if not value.startswith('/') or value.rstrip('/') == '':
+        raise cv.Invalid(f"Le répertoire d'un mount doit être un chemin absolu: '{value}'")
+    return value.rstrip('/')
+
+
+MOUNT_SCHEMA = cv.Schema({
+    cv.Required(CONF_PREFIX): mount_prefix,
+    cv.Required(CONF_PATH): mount_root,
+})
+
+
+def unique_mount_prefixes(entries):
+    seen = set()
+    for entry in entries:
+        if entry[CONF_PREFIX] in seen:
+            raise cv.Invalid(f"Préfixe '{entry[CONF_PREFIX]}' déclaré plusieurs fois")
+        seen.add(entry[CONF_PREFIX])
+    return entries
+
+def validate_coalescing(config):
+    """L'anneau partagé doit contenir au moins un bloc du relais."""
+    size = config[CONF_COALESCING_BUFFER_SIZE]
+    if 0 < size < config[CONF_RELAY_BUFFER_SIZE]:
+        raise cv.Invalid(f"{CONF_COALESCING_BUFFER_SIZE} doit être 0 ou au moins {CONF_RELAY_BUFFER_SIZE}")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(cv.Schema({
     cv.GenerateID(): cv.declare_id(FTPHTTPProxy),
     cv.Required(CONF_FTP_SERVER): cv.string,
+    cv.Optional(CONF_FTP_PORT, default=21): cv.port,
     cv.Required(CONF_USERNAME): cv.string,
     cv.Required(CONF_PASSWORD): cv.string,
     cv.Optional(CONF_LOCAL_PORT, default=8080): cv.port,
-}).extend(cv.COMPONENT_SCHEMA)
+    cv.Optional(CONF_CONNECT_TIMEOUT, default='5s'): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_PASSIVE_MODE, default='epsv'): cv.one_of('epsv', 'pasv', lower=True),
+    cv.Optional(CONF_DNS_REFRESH_INTERVAL, default='300s'): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_POOL_SIZE, default=2): cv.int_range(min=1, max=8),
+    cv.Optional(CONF_IDLE_TIMEOUT, default='60s'): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_TRANSFER_WORKERS, default=2): cv.int_range(min=1, max=8),
+    cv.Optional(CONF_TRANSFER_QUEUE_SIZE, default=4): cv.int_range(min=1, max=32),
+    cv.Optional(CONF_RELAY_BUFFER_COUNT, default=2): cv.int_range(min=2, max=16),
+    cv.Optional(CONF_RELAY_BUFFER_SIZE, default=8192): cv.int_range(min=1024, max=65536),
+    cv.Optional(CONF_RELAY_USE_PSRAM, default=True): cv.boolean,
+    cv.Optional(CONF_READ_AHEAD_SIZE, default=0): cv.int_range(min=0, max=1048576),
+    cv.Optional(CONF_COALESCING_BUFFER_SIZE, default=0): cv.int_range(min=0, max=4194304),
+    cv.Optional(CONF_SHARE_TOKENS, default='random'): cv.one_of('random', 'signed', lower=True),
+    cv.Optional(CONF_LISTING_CACHE_TTL, default='30s'): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_METADATA_CACHE_TTL, default='10s'): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_CACHE, default={}): CACHE_SCHEMA,
+    cv.Optional(CONF_SEGMENTED_FETCH, default={}): SEGMENTED_FETCH_SCHEMA,
+    cv.Optional(CONF_PERSISTENCE): PERSISTENCE_SCHEMA,
+    cv.Optional(CONF_MIME_TYPES, default=[]): cv.All(cv.ensure_list(MIME_TYPE_SCHEMA), unique_mime_extensions),
+    cv.Optional(CONF_MOUNTS, default=[]): cv.All(cv.ensure_list(MOUNT_SCHEMA), unique_mount_prefixes),
+}).extend(cv.COMPONENT_SCHEMA), validate_coalescing)
 
 async def to_code(config):
+    index_gz, index_etag = gzip_asset(INDEX_HTML)
+    cg.add_global(cg.RawStatement(asset_definition('INDEX_HTML', index_gz, index_etag)))
+    cg.add_global(cg.RawStatement(mime_table_definition(config[CONF_MIME_TYPES])))
+
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
 
     cg.add(var.set_ftp_server(config[CONF_FTP_SERVER]))
+    cg.add(var.set_ftp_port(config[CONF_FTP_PORT]))
     cg.add(var.set_username(config[CONF_USERNAME]))
     cg.add(var.set_password(config[CONF_PASSWORD]))
     cg.add(var.set_local_port(config[CONF_LOCAL_PORT]))
+    cg.add(var.set_connect_timeout(config[CONF_CONNECT_TIMEOUT]))
+    cg.add(var.set_use_epsv(config[CONF_PASSIVE_MODE] == 'epsv'))
+    cg.add(var.set_dns_refresh_interval(config[CONF_DNS_REFRESH_INTERVAL]))
+    cg.add(var.set_pool_size(config[CONF_POOL_SIZE]))
+    cg.add(var.set_idle_timeout(config[CONF_IDLE_TIMEOUT]))
+    cg.add(var.set_transfer_workers(config[CONF_TRANSFER_WORKERS]))
+    cg.add(var.set_transfer_queue_size(config[CONF_TRANSFER_QUEUE_SIZE]))
+    cg.add(var.set_relay_buffer_count(config[CONF_RELAY_BUFFER_COUNT]))
+    cg.add(var.set_relay_buffer_size(config[CONF_RELAY_BUFFER_SIZE]))
+    cg.add(var.set_relay_use_psram(config[CONF_RELAY_USE_PSRAM]))
+    cg.add(var.set_read_ahead_size(config[CONF_READ_AHEAD_SIZE]))
+    cg.add(var.set_coalescing_buffer_size(config[CONF_COALESCING_BUFFER_SIZE]))
+    cg.add(var.set_signed_share_tokens(config[CONF_SHARE_TOKENS] == 'signed'))
+    cg.add(var.set_listing_cache_ttl(config[CONF_LISTING_CACHE_TTL]))
+    cg.add(var.set_metadata_cache_ttl(config[CONF_METADATA_CACHE_TTL]))
+
+    cache = config[CONF_CACHE]
+    cg.add(var.set_cache_size(cache[CONF_SIZE]))
+    cg.add(var.set_cache_max_file_size(cache[CONF_MAX_FILE_SIZE]))
+    cg.add(var.set_cache_revalidate_interval(cache[CONF_REVALIDATE_INTERVAL]))
+    if CONF_DIRECTORY in cache:
+        cg.add(var.set_cache_directory(cache[CONF_DIRECTORY]))
+        cg.add(var.set_cache_directory_size(cache[CONF_DIRECTORY_SIZE]))
+
+    segmented = config[CONF_SEGMENTED_FETCH]
+    cg.add(var.set_segment_connections(segmented[CONF_CONNECTIONS]))
+    cg.add(var.set_segment_size(segmented[CONF_SEGMENT_SIZE]))
+    cg.add(var.set_segment_min_file_size(segmented[CONF_MIN_FILE_SIZE]))
 
+    if CONF_PERSISTENCE in config:
+        persistence = config[CONF_PERSISTENCE]
+        cg.add(var.set_store_partition(persistence[CONF_PARTITION]))
+        cg.add(var.set_store_flush_interval(persistence[CONF_FLUSH_INTERVAL]))
 
+    # Préfixes les plus longs d'abord: "sd/musique" l'emporte sur "sd"
+    for mount in sorted(config[CONF_MOUNTS], key=lambda m: -len(m[CONF_PREFIX])):
+        cg.add(var.add_local_mount(mount[CONF_PREFIX], mount[CONF_PATH]))
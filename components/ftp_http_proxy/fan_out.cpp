@@ -0,0 +1,166 @@
+#include "fan_out.h"
+#include "esphome/core/log.h"
+#include <lwip/sockets.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const char *TAG = "ftp_proxy.fanout";
+
+FanOutGroup::FanOutGroup(const std::string &key, std::string head, char *ring, size_t ring_size, FanOutDone done)
+    : key_(key), head_(std::move(head)), ring_(ring), ring_size_(ring_size), done_(std::move(done)) {
+  mutex_ = xSemaphoreCreateMutex();
+}
+
+FanOutGroup::~FanOutGroup() {
+  vSemaphoreDelete(mutex_);
+  heap_caps_free(ring_);
+}
+
+bool FanOutGroup::attach(FileTransferContext *ctx, int fd) {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  bool accepted = accepting_;
+  if (accepted) {
+    pending_.push_back({ctx, fd, 0, 0});
+  }
+  xSemaphoreGive(mutex_);
+  return accepted;
+}
+
+void FanOutGroup::adopt_pending() {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  for (auto &client : pending_) {
+    clients_.push_back(client);
+  }
+  pending_.clear();
+  xSemaphoreGive(mutex_);
+}
+
+bool FanOutGroup::flush(Client &client) {
+  while (client.head_sent < head_.size()) {
+    int sent = send(client.fd, head_.data() + client.head_sent, head_.size() - client.head_sent, MSG_DONTWAIT);
+    if (sent <= 0) {
+      return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    client.head_sent += sent;
+  }
+  while (client.cursor < produced_) {
+    size_t pos = client.cursor % ring_size_;
+    size_t len = (size_t) std::min<int64_t>(produced_ - client.cursor, ring_size_ - pos);
+    int sent = send(client.fd, ring_ + pos, len, MSG_DONTWAIT);
+    if (sent <= 0) {
+      return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    client.cursor += sent;
+  }
+  return true;
+}
+
+void FanOutGroup::drop(size_t index, FanOutOutcome outcome) {
+  Client client = clients_[index];
+  clients_.erase(clients_.begin() + index);
+  done_(client.ctx, outcome, client.cursor);
+}
+
+void FanOutGroup::publish(const char *data, size_t len) {
+  // Ce bloc va écraser le début du corps: les rattachements sont fermés avant toute écriture,
+  // un client accepté après coup recevrait des octets qui ne sont plus les siens
+  int64_t next = produced_ + len;
+  if (next > (int64_t) ring_size_ && accepting_) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    accepting_ = false;
+    xSemaphoreGive(mutex_);
+  }
+  adopt_pending();
+
+  // Un client dont les octets non envoyés seraient écrasés par ce bloc quitte le groupe
+  for (size_t i = 0; i < clients_.size();) {
+    Client &client = clients_[i];
+    if (!flush(client)) {
+      drop(i, FAN_OUT_FAILED);
+    } else if (next - client.cursor > (int64_t) ring_size_) {
+      ESP_LOGD(TAG, "Client trop lent détaché de %s après %lld octets", key_.c_str(), (long long) client.cursor);
+      // En-têtes incomplets: la réponse ne peut pas être reprise ailleurs
+      drop(i, client.head_sent == head_.size() ? FAN_OUT_DETACHED : FAN_OUT_FAILED);
+    } else {
+      i++;
+    }
+  }
+
+  size_t pos = produced_ % ring_size_;
+  size_t first = std::min(len, ring_size_ - pos);
+  memcpy(ring_ + pos, data, first);
+  memcpy(ring_, data + first, len - first);
+  produced_ = next;
+
+  for (size_t i = 0; i < clients_.size();) {
+    if (!flush(clients_[i])) {
+      drop(i, FAN_OUT_FAILED);
+    } else {
+      i++;
+    }
+  }
+}
+
+void FanOutGroup::finish(bool complete, uint32_t idle_timeout_ms) {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  accepting_ = false;
+  xSemaphoreGive(mutex_);
+  adopt_pending();
+
+  if (!complete) {
+    while (!clients_.empty()) {
+      drop(clients_.size() - 1, FAN_OUT_FAILED);
+    }
+    return;
+  }
+
+  // Vider l'anneau vers les clients restants; chacun dispose de idle_timeout_ms sans progression
+  std::vector<int64_t> last_progress(clients_.size(), esp_timer_get_time());
+  std::vector<int64_t> last_cursor;
+  for (auto &client : clients_) {
+    last_cursor.push_back(client.cursor + client.head_sent);
+  }
+  while (!clients_.empty()) {
+    int64_t now = esp_timer_get_time();
+    for (size_t i = 0; i < clients_.size();) {
+      Client &client = clients_[i];
+      bool alive = flush(client);
+      int64_t position = client.cursor + client.head_sent;
+      if (position != last_cursor[i]) {
+        last_cursor[i] = position;
+        last_progress[i] = now;
+      }
+      bool done = client.head_sent == head_.size() && client.cursor == produced_;
+      if (!alive || done || (now - last_progress[i]) / 1000 > idle_timeout_ms) {
+        last_cursor.erase(last_cursor.begin() + i);
+        last_progress.erase(last_progress.begin() + i);
+        drop(i, done ? FAN_OUT_COMPLETE : FAN_OUT_FAILED);
+      } else {
+        i++;
+      }
+    }
+    if (clients_.empty()) {
+      break;
+    }
+
+    // Attendre qu'au moins un client puisse recevoir
+    fd_set writable;
+    FD_ZERO(&writable);
+    int max_fd = -1;
+    for (auto &client : clients_) {
+      FD_SET(client.fd, &writable);
+      max_fd = std::max(max_fd, client.fd);
+    }
+    struct timeval timeout = {.tv_sec = 0, .tv_usec = 100000};
+    select(max_fd + 1, nullptr, &writable, nullptr, &timeout);
+  }
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+struct FileTransferContext;
+
+enum FanOutOutcome {
+  FAN_OUT_COMPLETE,  // Corps entièrement envoyé
+  FAN_OUT_FAILED,    // Client déconnecté ou flux source interrompu: réponse tronquée
+  FAN_OUT_DETACHED,  // Client trop lent pour l'anneau: à reprendre par son propre téléchargement
+};
+
+// Sort d'un client rattaché; sent: octets du corps déjà envoyés à ce client
+using FanOutDone = std::function<void(FileTransferContext *ctx, FanOutOutcome outcome, int64_t sent)>;
+
+/* Diffusion d'un même téléchargement à plusieurs clients HTTP.
+ * Le worker du premier client (meneur) publie chaque bloc reçu du serveur FTP dans un anneau;
+ * chaque client rattaché a son propre curseur et reçoit les en-têtes du meneur puis le corps.
+ * Les envois sont non bloquants: un client qui ne suit pas l'anneau est détaché plutôt que
+ * de ralentir le groupe. Un client ne peut se rattacher que tant que l'octet 0 est dans l'anneau. */
+class FanOutGroup {
+ public:
+  FanOutGroup(const std::string &key, std::string head, char *ring, size_t ring_size, FanOutDone done);
+  ~FanOutGroup();
+
+  const std::string &key() const { return key_; }
+
+  // Thread httpd: false si le groupe n'accepte plus de clients (début du corps sorti de l'anneau)
+  bool attach(FileTransferContext *ctx, int fd);
+
+  // Meneur: publie le bloc suivant du corps et fait avancer chaque client
+  void publish(const char *data, size_t len);
+
+  // Meneur: fin du flux source. complete: tous les octets ont été publiés; les clients
+  // rattachés reçoivent la fin de l'anneau, au plus idle_timeout_ms sans progression chacun.
+  void finish(bool complete, uint32_t idle_timeout_ms);
+
+  size_t client_count() const { return clients_.size(); }
+
+ protected:
+  struct Client {
+    FileTransferContext *ctx;
+    int fd;
+    size_t head_sent;  // Octets des en-têtes déjà envoyés
+    int64_t cursor;    // Octets du corps déjà envoyés
+  };
+
+  void adopt_pending();
+  // Envoie tout ce qui est possible sans bloquer; false si le client est perdu
+  bool flush(Client &client);
+  void drop(size_t index, FanOutOutcome outcome);
+
+  std::string key_;
+  std::string head_;
+  char *ring_;
+  size_t ring_size_;
+  int64_t produced_{0};  // Octets publiés depuis le début du corps
+  FanOutDone done_;
+
+  SemaphoreHandle_t mutex_;
+  bool accepting_{true};
+  std::vector<Client> pending_;  // Rattachés par httpd, pas encore pris en charge par le meneur
+  std::vector<Client> clients_;  // Manipulés uniquement par le meneur
+};
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,329 @@
+#include "file_cache.h"
+#include "esphome/core/log.h"
+#include "esp_heap_caps.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const char *TAG = "ftp_proxy.cache";
+
+// En-tête des fichiers du second niveau, suivi du chemin puis du contenu
+struct DiskHeader {
+  uint32_t magic;
+  uint32_t path_len;
+  int64_t size;
+  int64_t modified;
+};
+static const uint32_t DISK_MAGIC = 0x46435031;  // "FCP1"
+
+CachedFile::CachedFile(const std::string &path, int64_t size, time_t modified)
+    : path(path), size(size), modified(modified) {
+  uint32_t caps = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0 ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT;
+  data = (uint8_t *) heap_caps_malloc(size > 0 ? size : 1, caps);
+}
+
+CachedFile::~CachedFile() {
+  if (data != nullptr) {
+    heap_caps_free(data);
+  }
+}
+
+bool FileCache::init(size_t ram_budget, size_t max_file_size, const std::string &disk_dir, size_t disk_budget) {
+  ram_budget_ = ram_budget;
+  max_file_size_ = max_file_size < ram_budget ? max_file_size : ram_budget;
+  disk_dir_ = disk_dir;
+  disk_budget_ = disk_dir.empty() ? 0 : disk_budget;
+  if (ram_budget_ == 0) {
+    return true;
+  }
+
+  mutex_ = xSemaphoreCreateMutex();
+  if (mutex_ == nullptr) {
+    return false;
+  }
+  if (disk_budget_ > 0) {
+    load_disk_index();
+  }
+  ESP_LOGI(TAG, "Cache de fichiers: %u Ko en RAM, fichiers jusqu'à %u Ko, second niveau %s (%u Ko)",
+           (unsigned) (ram_budget_ / 1024), (unsigned) (max_file_size_ / 1024),
+           disk_budget_ > 0 ? disk_dir_.c_str() : "désactivé", (unsigned) (disk_budget_ / 1024));
+  return true;
+}
+
+std::shared_ptr<CachedFile> FileCache::create(const std::string &path, int64_t size, time_t modified) {
+  if (!enabled() || size < 0 || (size_t) size > max_file_size_) {
+    return nullptr;
+  }
+  auto file = std::make_shared<CachedFile>(path, size, modified);
+  if (file->data == nullptr) {
+    ESP_LOGW(TAG, "Mémoire insuffisante pour mettre en cache %s (%lld octets)", path.c_str(), (long long) size);
+    return nullptr;
+  }
+  return file;
+}
+
+std::shared_ptr<CachedFile> FileCache::lookup(const std::string &path) {
+  if (!enabled()) {
+    return nullptr;
+  }
+  std::shared_ptr<CachedFile> found;
+  DiskEntry disk_entry;
+  bool on_disk = false;
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  LruList::iterator *it = index_.find(path);
+  if (it != nullptr) {
+    // Remonter l'entrée en tête de la liste LRU
+    lru_.splice(lru_.begin(), lru_, *it);
+    found = lru_.front();
+  } else if (DiskEntry *entry = disk_index_.find(path)) {
+    entry->last_used = ++disk_clock_;
+    disk_entry = *entry;
+    on_disk = true;
+  }
+  xSemaphoreGive(mutex_);
+
+  if (on_disk) {
+    found = load_from_disk(path, disk_entry);
+    if (found) {
+      insert(found);
+    }
+  }
+  return found;
+}
+
+std::vector<std::shared_ptr<CachedFile>> FileCache::make_room(size_t needed) {
+  std::vector<std::shared_ptr<CachedFile>> evicted;
+  while (!lru_.empty() && ram_used_ + needed > ram_budget_) {
+    std::shared_ptr<CachedFile> victim = lru_.back();
+    index_.erase(victim->path);
+    ram_used_ -= victim->size;
+    lru_.pop_back();
+    evicted.push_back(std::move(victim));
+  }
+  return evicted;
+}
+
+void FileCache::insert(std::shared_ptr<CachedFile> file) {
+  if (!enabled() || !file) {
+    return;
+  }
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  remove_locked(file->path);
+  std::vector<std::shared_ptr<CachedFile>> evicted = make_room(file->size);
+  lru_.push_front(file);
+  index_.insert(file->path, lru_.begin());
+  ram_used_ += file->size;
+  xSemaphoreGive(mutex_);
+
+  ESP_LOGD(TAG, "Mis en cache: %s (%lld octets, %u Ko utilisés)", file->path.c_str(), (long long) file->size,
+           (unsigned) (ram_used_ / 1024));
+
+  // Écritures flash hors du verrou: les entrées évincées restent valides grâce au shared_ptr
+  if (disk_budget_ > 0) {
+    for (const auto &victim : evicted) {
+      spill_to_disk(*victim);
+    }
+  }
+}
+
+void FileCache::remove_locked(const std::string &path) {
+  LruList::iterator *it = index_.find(path);
+  if (it != nullptr) {
+    ram_used_ -= (**it)->size;
+    lru_.erase(*it);
+    index_.erase(path);
+  }
+}
+
+void FileCache::remove(const std::string &path) {
+  if (!enabled()) {
+    return;
+  }
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  remove_locked(path);
+  xSemaphoreGive(mutex_);
+  remove_disk_entry(path);
+}
+
+std::string FileCache::disk_path(uint32_t file_id) const {
+  char name[16];
+  snprintf(name, sizeof(name), "/%08x.fc", (unsigned) file_id);
+  return disk_dir_ + name;
+}
+
+uint32_t FileCache::allocate_file_id(const std::string &path) {
+  // Deux chemins de même hash ne partagent jamais un fichier: sondage linéaire sur le nom
+  uint32_t file_id = StringHash()(path);
+  while (disk_files_.find(file_id) != nullptr) {
+    file_id++;
+  }
+  disk_files_.insert(file_id, path);
+  return file_id;
+}
+
+void FileCache::load_disk_index() {
+  mkdir(disk_dir_.c_str(), 0755);
+  DIR *dir = opendir(disk_dir_.c_str());
+  if (dir == nullptr) {
+    ESP_LOGW(TAG, "Répertoire du cache %s inaccessible, second niveau désactivé", disk_dir_.c_str());
+    disk_budget_ = 0;
+    return;
+  }
+  struct dirent *de;
+  while ((de = readdir(dir)) != nullptr) {
+    unsigned file_id;
+    char extension[4];
+    if (sscanf(de->d_name, "%8x.%3s", &file_id, extension) != 2 || strcmp(extension, "fc") != 0) {
+      continue;
+    }
+    std::string file_path = disk_dir_ + "/" + de->d_name;
+    FILE *f = fopen(file_path.c_str(), "rb");
+    if (f == nullptr) {
+      continue;
+    }
+    DiskHeader header;
+    std::string path;
+    bool valid = fread(&header, sizeof(header), 1, f) == 1 && header.magic == DISK_MAGIC && header.path_len < 1024;
+    if (valid) {
+      path.resize(header.path_len);
+      valid = fread(&path[0], 1, header.path_len, f) == header.path_len;
+    }
+    fclose(f);
+    if (!valid || disk_used_ + header.size > disk_budget_ || disk_index_.find(path) != nullptr) {
+      unlink(file_path.c_str());
+      continue;
+    }
+    disk_index_.insert(path, DiskEntry{header.size, (time_t) header.modified, 0, file_id});
+    disk_files_.insert(file_id, path);
+    disk_used_ += header.size;
+  }
+  closedir(dir);
+  ESP_LOGI(TAG, "Second niveau: %u fichiers retrouvés (%u Ko)", (unsigned) disk_index_.size(),
+           (unsigned) (disk_used_ / 1024));
+}
+
+void FileCache::spill_to_disk(const CachedFile &file) {
+  if ((size_t) file.size > disk_budget_) {
+    return;
+  }
+
+  // Libérer de la place en supprimant les fichiers les moins récemment utilisés
+  std::vector<std::string> victims;
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  if (disk_index_.find(file.path) != nullptr) {
+    xSemaphoreGive(mutex_);
+    return;
+  }
+  size_t used = disk_used_;
+  while (used + file.size > disk_budget_) {
+    std::string oldest;
+    uint32_t oldest_use = UINT32_MAX;
+    disk_index_.for_each([&](const std::string &path, DiskEntry &entry) {
+      if (entry.last_used < oldest_use && std::find(victims.begin(), victims.end(), path) == victims.end()) {
+        oldest_use = entry.last_used;
+        oldest = path;
+      }
+    });
+    if (oldest.empty()) {
+      break;
+    }
+    used -= disk_index_.find(oldest)->size;
+    victims.push_back(oldest);
+  }
+  uint32_t file_id = allocate_file_id(file.path);
+  xSemaphoreGive(mutex_);
+
+  for (const auto &victim : victims) {
+    remove_disk_entry(victim);
+  }
+
+  std::string target = disk_path(file_id);
+  FILE *f = fopen(target.c_str(), "wb");
+  if (f == nullptr) {
+    ESP_LOGW(TAG, "Écriture impossible dans le cache disque: %s", target.c_str());
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    disk_files_.erase(file_id);
+    xSemaphoreGive(mutex_);
+    return;
+  }
+  DiskHeader header = {DISK_MAGIC, (uint32_t) file.path.size(), file.size, (int64_t) file.modified};
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(file.path.data(), 1, file.path.size(), f) == file.path.size() &&
+            fwrite(file.data, 1, file.size, f) == (size_t) file.size;
+  fclose(f);
+  if (!ok) {
+    unlink(target.c_str());
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    disk_files_.erase(file_id);
+    xSemaphoreGive(mutex_);
+    return;
+  }
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  disk_index_.insert(file.path, DiskEntry{file.size, file.modified, ++disk_clock_, file_id});
+  disk_used_ += file.size;
+  xSemaphoreGive(mutex_);
+  ESP_LOGD(TAG, "Copié sur le second niveau: %s", file.path.c_str());
+}
+
+std::shared_ptr<CachedFile> FileCache::load_from_disk(const std::string &path, const DiskEntry &entry) {
+  auto file = create(path, entry.size, entry.modified);
+  if (!file) {
+    return nullptr;
+  }
+  std::string source = disk_path(entry.file_id);
+  FILE *f = fopen(source.c_str(), "rb");
+  if (f == nullptr) {
+    remove_disk_entry(path);
+    return nullptr;
+  }
+  // Le fichier doit être celui de ce chemin, avec la taille et la date indexées
+  DiskHeader header;
+  std::string stored_path(path.size(), '\0');
+  bool ok = fread(&header, sizeof(header), 1, f) == 1 && header.magic == DISK_MAGIC &&
+            header.path_len == path.size() && header.size == entry.size &&
+            header.modified == (int64_t) entry.modified &&
+            fread(&stored_path[0], 1, path.size(), f) == path.size() && stored_path == path &&
+            fread(file->data, 1, entry.size, f) == (size_t) entry.size;
+  fclose(f);
+  if (!ok) {
+    ESP_LOGW(TAG, "Entrée du second niveau incohérente, ignorée: %s", path.c_str());
+    remove_disk_entry(path);
+    return nullptr;
+  }
+  ESP_LOGD(TAG, "Relu depuis le second niveau: %s", path.c_str());
+  return file;
+}
+
+void FileCache::remove_disk_entry(const std::string &path) {
+  if (disk_budget_ == 0) {
+    return;
+  }
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  DiskEntry *entry = disk_index_.find(path);
+  bool present = entry != nullptr;
+  uint32_t file_id = 0;
+  if (present) {
+    file_id = entry->file_id;
+    disk_used_ -= entry->size;
+    disk_index_.erase(path);
+  }
+  xSemaphoreGive(mutex_);
+  if (present) {
+    // Nom libéré seulement après la suppression: il ne peut pas être réattribué entre-temps
+    unlink(disk_path(file_id).c_str());
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    disk_files_.erase(file_id);
+    xSemaphoreGive(mutex_);
+  }
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
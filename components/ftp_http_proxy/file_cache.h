@@ -0,0 +1,91 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "open_hash_map.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+// Contenu complet d'un fichier en mémoire; immuable une fois inséré dans le cache
+struct CachedFile {
+  CachedFile(const std::string &path, int64_t size, time_t modified);
+  ~CachedFile();
+
+  std::string path;
+  int64_t size;
+  time_t modified;
+  uint8_t *data{nullptr};
+  std::atomic<int64_t> validated{0};  // Dernière validation SIZE/MDTM (µs esp_timer)
+};
+
+/* Cache LRU de fichiers complets, en PSRAM, avec un second niveau optionnel
+ * sur une partition montée (LittleFS/FAT): les fichiers évincés de la RAM y sont
+ * recopiés et peuvent y être relus sans passer par le serveur FTP. */
+class FileCache {
+ public:
+  bool init(size_t ram_budget, size_t max_file_size, const std::string &disk_dir, size_t disk_budget);
+  bool enabled() const { return ram_budget_ > 0; }
+  size_t max_file_size() const { return max_file_size_; }
+
+  // Alloue un fichier à remplir (nullptr si trop gros ou mémoire insuffisante)
+  std::shared_ptr<CachedFile> create(const std::string &path, int64_t size, time_t modified);
+  // Entrée en RAM, ou relue depuis le second niveau; nullptr si absente
+  std::shared_ptr<CachedFile> lookup(const std::string &path);
+  void insert(std::shared_ptr<CachedFile> file);
+  void remove(const std::string &path);
+
+  void record_hit() { hits_++; }
+  void record_miss() { misses_++; }
+  uint32_t hits() const { return hits_; }
+  uint32_t misses() const { return misses_; }
+  size_t ram_used() const { return ram_used_; }
+
+ protected:
+  struct DiskEntry {
+    int64_t size{0};
+    time_t modified{0};
+    uint32_t last_used{0};  // Compteur d'accès, pour l'éviction LRU
+    uint32_t file_id{0};    // Nom du fichier: hash du chemin, incrémenté en cas de collision
+  };
+  using LruList = std::list<std::shared_ptr<CachedFile>>;
+
+  std::vector<std::shared_ptr<CachedFile>> make_room(size_t needed);
+  void remove_locked(const std::string &path);
+
+  std::string disk_path(uint32_t file_id) const;
+  // Premier nom libre à partir du hash du chemin; mutex_ tenu par l'appelant
+  uint32_t allocate_file_id(const std::string &path);
+  void load_disk_index();
+  void spill_to_disk(const CachedFile &file);
+  std::shared_ptr<CachedFile> load_from_disk(const std::string &path, const DiskEntry &entry);
+  void remove_disk_entry(const std::string &path);
+
+  size_t ram_budget_{0};
+  size_t max_file_size_{0};
+  size_t ram_used_{0};
+  LruList lru_;  // Plus récent en tête
+  OpenHashMap<std::string, LruList::iterator, StringHash> index_;
+
+  std::string disk_dir_;
+  size_t disk_budget_{0};
+  size_t disk_used_{0};
+  uint32_t disk_clock_{0};
+  OpenHashMap<std::string, DiskEntry, StringHash> disk_index_;
+  OpenHashMap<uint32_t, std::string, IntHash> disk_files_;  // file_id -> chemin (réservé ou écrit)
+
+  SemaphoreHandle_t mutex_{nullptr};
+  std::atomic<uint32_t> hits_{0};
+  std::atomic<uint32_t> misses_{0};
+};
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
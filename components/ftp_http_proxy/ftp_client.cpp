@@ -0,0 +1,362 @@
+#include "ftp_client.h"
+#include "metrics.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef USE_HOST
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#else
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+#endif
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const char *TAG = "ftp_proxy.client";
+
+// Une réponse ne dépasse jamais quelques lignes; au-delà, le flux est considéré comme corrompu
+static const size_t MAX_REPLY_SIZE = 4096;
+
+static bool is_reply_line(const std::string &line) {
+  return line.size() >= 4 && isdigit((unsigned char) line[0]) && isdigit((unsigned char) line[1]) &&
+         isdigit((unsigned char) line[2]) && (line[3] == ' ' || line[3] == '-' || line[3] == '\r');
+}
+
+bool ftp_send(FtpControl &ctrl, const char *commands) {
+  size_t len = strlen(commands);
+  while (len > 0) {
+    int sent = send(ctrl.sock, commands, len, 0);
+    if (sent <= 0) {
+      return false;
+    }
+    commands += sent;
+    len -= sent;
+  }
+  return true;
+}
+
+int ftp_read_reply(FtpControl &ctrl, char *buffer, size_t buffer_size) {
+  std::string reply;
+  int code = -1;
+  buffer[0] = '\0';
+
+  while (true) {
+    size_t eol = ctrl.pending.find('\n');
+    if (eol == std::string::npos) {
+      if (ctrl.pending.size() + reply.size() > MAX_REPLY_SIZE) {
+        ESP_LOGW(TAG, "Réponse FTP trop longue, session abandonnée");
+        return -1;
+      }
+      char chunk[256];
+      int received = recv(ctrl.sock, chunk, sizeof(chunk), 0);
+      if (received <= 0) {
+        return -1;
+      }
+      ctrl.pending.append(chunk, received);
+      continue;
+    }
+
+    std::string line = ctrl.pending.substr(0, eol + 1);
+    ctrl.pending.erase(0, eol + 1);
+    reply += line;
+
+    if (code < 0) {
+      // Première ligne: "NNN texte" termine la réponse, "NNN-texte" ouvre un bloc multi-ligne
+      if (!is_reply_line(line)) {
+        reply.clear();
+        continue;
+      }
+      code = atoi(line.c_str());
+      if (line[3] != '-') {
+        break;
+      }
+    } else if (is_reply_line(line) && line[3] != '-' && atoi(line.c_str()) == code) {
+      // Fin du bloc: même code suivi d'un espace (RFC 959 §4.2)
+      break;
+    }
+  }
+
+  size_t len = std::min(reply.size(), buffer_size - 1);
+  memcpy(buffer, reply.data(), len);
+  buffer[len] = '\0';
+  proxy_metrics().record_ftp_error(code);
+  return code;
+}
+
+int ftp_command(FtpControl &ctrl, const char* command, char* buffer, size_t buffer_size) {
+  if (command != nullptr && !ftp_send(ctrl, command)) {
+    buffer[0] = '\0';
+    return -1;
+  }
+  return ftp_read_reply(ctrl, buffer, buffer_size);
+}
+
+bool ftp_resync(FtpControl &ctrl) {
+  if (!ftp_send(ctrl, "NOOP\r\n")) {
+    return false;
+  }
+  char reply[256];
+  // Au plus quelques réponses de fin de transfert précèdent celle du NOOP
+  for (int i = 0; i < 4; i++) {
+    int code = ftp_read_reply(ctrl, reply, sizeof(reply));
+    if (code < 0) {
+      return false;
+    }
+    if (code == 200) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ftp_resolve(const char *server, int port, struct sockaddr_storage &addr, socklen_t &addr_len) {
+  uint32_t start = micros();
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;  // IPv6 ou IPv4, dans l'ordre de préférence du résolveur
+  hints.ai_socktype = SOCK_STREAM;
+  char service[8];
+  snprintf(service, sizeof(service), "%d", port);
+
+  struct addrinfo *result = nullptr;
+  int err = getaddrinfo(server, service, &hints, &result);
+  if (err != 0 || result == nullptr) {
+    ESP_LOGE(TAG, "Échec de la résolution DNS de %s: %d", server, err);
+    return false;
+  }
+  memcpy(&addr, result->ai_addr, result->ai_addrlen);
+  addr_len = result->ai_addrlen;
+  freeaddrinfo(result);
+  proxy_metrics().dns.record_us(micros() - start);
+  return true;
+}
+
+bool connect_with_timeout(int sock, const struct sockaddr *addr, socklen_t addr_len, uint32_t timeout_ms) {
+  int flags = fcntl(sock, F_GETFL, 0);
+  fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+
+  int ret = connect(sock, addr, addr_len);
+  if (ret != 0 && errno == EINPROGRESS) {
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(sock, &writable);
+    struct timeval timeout = {.tv_sec = (long) (timeout_ms / 1000), .tv_usec = (long) (timeout_ms % 1000) * 1000};
+    ret = select(sock + 1, nullptr, &writable, nullptr, &timeout);
+    if (ret == 0) {
+      errno = ETIMEDOUT;
+      ret = -1;
+    } else if (ret > 0) {
+      int err = 0;
+      socklen_t err_len = sizeof(err);
+      getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &err_len);
+      errno = err;
+      ret = err == 0 ? 0 : -1;
+    }
+  }
+
+  fcntl(sock, F_SETFL, flags);
+  return ret == 0;
+}
+
+// Port annoncé par EPSV: "229 Entering Extended Passive Mode (|||port|)" (RFC 2428),
+// le délimiteur est le premier caractère après la parenthèse
+static int parse_epsv_port(const char *reply) {
+  const char *open = strchr(reply, '(');
+  if (open == nullptr || open[1] == '\0') {
+    return -1;
+  }
+  char delim = open[1];
+  if (open[2] != delim || open[3] != delim) {
+    return -1;
+  }
+  char *end;
+  long port = strtol(open + 4, &end, 10);
+  if (*end != delim || port <= 0 || port > 65535) {
+    return -1;
+  }
+  return (int) port;
+}
+
+// Port annoncé par PASV: "227 Entering Passive Mode (h1,h2,h3,h4,p1,p2)"
+static int parse_pasv_port(const char *reply) {
+  const char *open = strchr(reply, '(');
+  int ip[4], port[2];
+  if (open == nullptr ||
+      sscanf(open, "(%d,%d,%d,%d,%d,%d)", &ip[0], &ip[1], &ip[2], &ip[3], &port[0], &port[1]) != 6) {
+    return -1;
+  }
+  return port[0] * 256 + port[1];
+}
+
+int open_data_connection(FtpControl &ctrl, char* buffer, size_t buffer_size, uint32_t connect_timeout_ms) {
+  uint32_t start = micros();
+  int data_port = -1;
+
+  // Mode passif étendu d'abord: seul le port est annoncé, valable en IPv4 comme en IPv6
+  if (ctrl.epsv) {
+    int code = ftp_command(ctrl, "EPSV\r\n", buffer, buffer_size);
+    if (code == 229) {
+      data_port = parse_epsv_port(buffer);
+      if (data_port < 0) {
+        ESP_LOGE(TAG, "Impossible de parser la réponse EPSV");
+        return -1;
+      }
+    } else if (code >= 500 && code < 600) {
+      ESP_LOGD(TAG, "EPSV non supporté, repli sur PASV pour cette session");
+      ctrl.epsv = false;
+    } else {
+      ESP_LOGE(TAG, "Erreur en mode passif étendu: %s", buffer);
+      return -1;
+    }
+  }
+
+  if (data_port < 0) {
+    if (ftp_command(ctrl, "PASV\r\n", buffer, buffer_size) != 227) {
+      ESP_LOGE(TAG, "Erreur en mode passif");
+      return -1;
+    }
+    data_port = parse_pasv_port(buffer);
+    if (data_port < 0) {
+      ESP_LOGE(TAG, "Impossible de parser la réponse PASV");
+      return -1;
+    }
+  }
+
+  // L'adresse IP annoncée par PASV est souvent fausse derrière un NAT: le canal de données
+  // rejoint toujours le pair de la connexion de contrôle, seul le port change
+  struct sockaddr_storage data_addr;
+  socklen_t data_addr_len = sizeof(data_addr);
+  if (getpeername(ctrl.sock, (struct sockaddr *) &data_addr, &data_addr_len) != 0) {
+    ESP_LOGE(TAG, "Adresse du serveur FTP inconnue: %d", errno);
+    return -1;
+  }
+  if (data_addr.ss_family == AF_INET6) {
+    ((struct sockaddr_in6 *) &data_addr)->sin6_port = htons(data_port);
+  } else {
+    ((struct sockaddr_in *) &data_addr)->sin_port = htons(data_port);
+  }
+
+  // Connexion au port de données
+  int data_sock = socket(data_addr.ss_family, SOCK_STREAM, 0);
+  if (data_sock < 0) {
+    ESP_LOGE(TAG, "Échec de création du socket de données");
+    return -1;
+  }
+  
+  int flag = 1;
+  setsockopt(data_sock, SOL_SOCKET, SO_KEEPALIVE, &flag, sizeof(flag));
+  
+  int rcvbuf = 32768;
+  setsockopt(data_sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  
+  struct timeval data_timeout = {.tv_sec = 10, .tv_usec = 0};
+  setsockopt(data_sock, SOL_SOCKET, SO_RCVTIMEO, &data_timeout, sizeof(data_timeout));
+  
+  if (!connect_with_timeout(data_sock, (struct sockaddr *) &data_addr, data_addr_len, connect_timeout_ms)) {
+    ESP_LOGE(TAG, "Échec de connexion au port de données: %d", errno);
+    close(data_sock);
+    return -1;
+  }
+  proxy_metrics().pasv.record_us(micros() - start);
+  return data_sock;
+}
+
+int ftp_login(FtpControl &ctrl, const struct sockaddr *addr, socklen_t addr_len, const char *username,
+              const char *password, uint32_t connect_timeout_ms) {
+  int sock = socket(addr->sa_family, SOCK_STREAM, 0);
+  if (sock < 0) {
+    ESP_LOGE(TAG, "Échec de création du socket : %d", errno);
+    return FTP_LOGIN_REFUSED;
+  }
+
+  // Configuration du socket pour être plus robuste
+  int flag = 1;
+  setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &flag, sizeof(flag));
+  
+  // Augmenter la taille du buffer de réception
+  int rcvbuf = 16384;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  // Timeout pour les opérations socket
+  struct timeval timeout = {.tv_sec = 10, .tv_usec = 0};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  uint32_t start = micros();
+  if (!connect_with_timeout(sock, addr, addr_len, connect_timeout_ms)) {
+    ESP_LOGE(TAG, "Échec de connexion FTP : %d", errno);
+    close(sock);
+    return FTP_UNREACHABLE;
+  }
+  proxy_metrics().connect.record_us(micros() - start);
+  start = micros();
+
+  ctrl.sock = sock;
+  ctrl.pending.clear();
+
+  // Le message de bienvenue peut être multi-ligne (220-...)
+  char buffer[512];
+  int banner_code = ftp_read_reply(ctrl, buffer, sizeof(buffer));
+  if (banner_code != 220) {
+    close(sock);
+    ctrl.sock = -1;
+    if (banner_code < 0) {
+      ESP_LOGE(TAG, "Message de bienvenue FTP non reçu");
+      return FTP_UNREACHABLE;
+    }
+    // "421 Too many connections" et consorts: le serveur répond, seule cette session est refusée
+    ESP_LOGW(TAG, "Session FTP refusée par le serveur: %s", buffer);
+    return FTP_LOGIN_REFUSED;
+  }
+
+  // USER, PASS et TYPE I enchaînés: un seul aller-retour au lieu de trois
+  std::string commands = std::string("USER ") + username + "\r\nPASS " + password + "\r\nTYPE I\r\n";
+  if (!ftp_send(ctrl, commands.c_str())) {
+    close(sock);
+    ctrl.sock = -1;
+    return FTP_UNREACHABLE;
+  }
+  int user_code = ftp_read_reply(ctrl, buffer, sizeof(buffer));
+  int code = user_code < 0 ? -1 : ftp_read_reply(ctrl, buffer, sizeof(buffer));
+  if (code < 0) {
+    // Délai dépassé ou connexion coupée en pleine authentification
+    ESP_LOGE(TAG, "Pas de réponse du serveur FTP pendant l'authentification");
+    close(sock);
+    ctrl.sock = -1;
+    return FTP_UNREACHABLE;
+  }
+  // 230 dès USER: pas de mot de passe attendu, la réponse à PASS (202/503) est ignorée
+  if (user_code != 230 && (user_code != 331 || (code != 230 && code != 202))) {
+    ESP_LOGE(TAG, "Authentification FTP échouée: %s", buffer);
+    close(sock);
+    ctrl.sock = -1;
+    return FTP_LOGIN_REFUSED;
+  }
+
+  // Mode binaire
+  code = ftp_read_reply(ctrl, buffer, sizeof(buffer));
+  if (code != 200) {
+    ESP_LOGE(TAG, "Échec de TYPE I: %s", buffer);
+    close(sock);
+    ctrl.sock = -1;
+    return code < 0 ? FTP_UNREACHABLE : FTP_LOGIN_REFUSED;
+  }
+  proxy_metrics().login.record_us(micros() - start);
+
+  return 0;
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#ifdef USE_HOST
+#include <sys/socket.h>
+#else
+#include <lwip/sockets.h>
+#endif
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+/* Primitives du client FTP sur sockets BSD, sans dépendance à FreeRTOS ni à esp_http_server:
+ * elles se compilent aussi bien avec lwIP (ESP-IDF) qu'avec la plateforme host d'ESPHome. */
+
+// Connexion de contrôle: le socket et les octets reçus au-delà de la dernière réponse lue
+// (plusieurs réponses peuvent arriver dans un même segment quand les commandes sont enchaînées)
+struct FtpControl {
+  int sock{-1};
+  std::string pending;
+  bool epsv{true};  // EPSV tenté en premier; désactivé pour la session si le serveur le refuse
+};
+
+// Envoie une ou plusieurs commandes (chacune terminée par CRLF) sans attendre de réponse
+bool ftp_send(FtpControl &ctrl, const char *commands);
+
+// Lit la réponse complète suivante, y compris les réponses multi-lignes "NNN-" ... "NNN texte".
+// Le texte (toutes les lignes) est copié dans buffer; retourne le code ou -1 en cas d'erreur.
+int ftp_read_reply(FtpControl &ctrl, char *buffer, size_t buffer_size);
+
+// Envoie une commande puis lit sa réponse; command == nullptr: lit seulement la réponse suivante
+int ftp_command(FtpControl &ctrl, const char *command, char *buffer, size_t buffer_size);
+
+// Après la fermeture anticipée d'un canal de données, consomme les réponses du transfert
+// (226, 426, 451... selon le serveur) jusqu'à celle d'un NOOP: la session redevient utilisable
+bool ftp_resync(FtpControl &ctrl);
+
+// Résolution par getaddrinfo (réentrante, contrairement à gethostbyname)
+bool ftp_resolve(const char *server, int port, struct sockaddr_storage &addr, socklen_t &addr_len);
+
+// connect() non bloquant borné par timeout_ms; le socket est rendu en mode bloquant
+bool connect_with_timeout(int sock, const struct sockaddr *addr, socklen_t addr_len, uint32_t timeout_ms);
+
+// Échecs de ftp_login: serveur injoignable (connexion, délai, lecture) ou session refusée par un
+// serveur qui répond (bienvenue 4xx/5xx comme "421 Too many connections", identifiants)
+static const int FTP_LOGIN_REFUSED = -1;
+static const int FTP_UNREACHABLE = -2;
+
+// Ouvre une session de contrôle authentifiée en mode binaire; USER, PASS et TYPE I partent ensemble.
+// Retourne 0 (ctrl.sock valide), FTP_LOGIN_REFUSED ou FTP_UNREACHABLE.
+int ftp_login(FtpControl &ctrl, const struct sockaddr *addr, socklen_t addr_len, const char *username,
+              const char *password, uint32_t connect_timeout_ms);
+
+// Ouvre le canal de données en mode passif (EPSV, ou PASV en repli) vers l'adresse du pair de la
+// connexion de contrôle, en IPv4 comme en IPv6; retourne le socket ou -1
+int open_data_connection(FtpControl &ctrl, char *buffer, size_t buffer_size, uint32_t connect_timeout_ms = 10000);
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
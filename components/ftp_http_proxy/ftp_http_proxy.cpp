@@ -1,7 +1,17 @@
 #include "ftp_http_proxy.h"
+#include "relay_engine.h"
+#include "ftp_client.h"
+#include "segmented_fetch.h"
+#include "metrics.h"
+#include "ftp_listing.h"
+#include "file_cache.h"
+#include "mime_types.h"
+#include "share_store.h"
+#include "share_token.h"
+#include "http_response.h"
+#include "esphome/core/hal.h"
 #include "esphome/core/log.h"
 #include <lwip/sockets.h>
-#include <lwip/netdb.h>
 #include <cstring>
 #include <arpa/inet.h>
 #include "esp_task_wdt.h"
@@ -10,7 +20,10 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <algorithm>
+#include <memory>
 #include <string>
+#include <ctime>
+#include <sys/stat.h>
 #include "esp_timer.h"
 #include "esp_check.h"
 #include "esp_wifi.h"
@@ -20,183 +33,95 @@
 
 static const char *TAG = "ftp_proxy";
 
-// Interface HTML pour le navigateur de fichiers (inclus comme chaîne)
-static const char* HTML_INDEX = R"=====(
-<!DOCTYPE html>
-<html lang="fr">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>ESP32 File Browser</title>
-    <style>
-        body { font-family: Arial, sans-serif; max-width: 800px; margin: 0 auto; padding: 20px; }
-        h1 { color: #333; }
-        .file-list { list-style: none; padding: 0; }
-        .file-item { padding: 10px; border-bottom: 1px solid #eee; display: flex; justify-content: space-between; align-items: center; }
-        .file-name { flex-grow: 1; }
-        .file-actions { display: flex; gap: 10px; }
-        .btn { padding: 6px 12px; border-radius: 4px; cursor: pointer; text-decoration: none; font-size: 14px; }
-        .download-btn { background: #4CAF50; color: white; border: none; }
-        .share-btn { background: #2196F3; color: white; border: none; }
-        .toggle-btn { background: #FF9800; color: white; border: none; }
-        .modal { display: none; position: fixed; top: 0; left: 0; width: 100%; height: 100%; background: rgba(0,0,0,0.5); align-items: center; justify-content: center; }
-        .modal-content { background: white; padding: 20px; border-radius: 5px; width: 90%; max-width: 500px; }
-        .close-btn { float: right; cursor: pointer; font-size: 20px; }
-        .share-link { padding: 10px; background: #f5f5f5; border-radius: 4px; word-break: break-all; margin: 10px 0; }
-        .copy-btn { background: #673AB7; color: white; border: none; padding: 5px 10px; cursor: pointer; border-radius: 4px; }
-        .success-msg { color: green; display: none; }
-        .shareable-badge { display: inline-block; background: #4CAF50; color: white; font-size: 10px; padding: 3px 6px; border-radius: 3px; margin-left: 5px; }
-    </style>
-</head>
-<body>
-    <h1>ESP32 File Browser</h1>
-    
-    <ul class="file-list">
-        <!-- Files will be loaded here -->
-    </ul>
-    
-    <div id="shareModal" class="modal">
-        <div class="modal-content">
-            <span class="close-btn">&times;</span>
-            <h2>Partage de fichier</h2>
-            <p>Lien de partage (valide pour <span id="expiryHours">24</span> heures):</p>
-            <div class="share-link" id="shareLink"></div>
-            <button class="copy-btn" onclick="copyShareLink()">Copier</button>
-            <span class="success-msg" id="copySuccess">Lien copié!</span>
-        </div>
-    </div>
-    
-    <script>
-        // Charger la liste des fichiers
-        function loadFiles() {
-            fetch('/api/files')
-                .then(response => response.json())
-                .then(files => {
-                    const fileList = document.querySelector('.file-list');
-                    fileList.innerHTML = '';
-                    
-                    files.forEach(file => {
-                        const li = document.createElement('li');
-                        li.className = 'file-item';
-                        
-                        const nameDiv = document.createElement('div');
-                        nameDiv.className = 'file-name';
-                        nameDiv.textContent = file.name;
-                        
-                        if (file.shareable) {
-                            const badge = document.createElement('span');
-                            badge.className = 'shareable-badge';
-                            badge.textContent = 'Partageable';
-                            nameDiv.appendChild(badge);
-                        }
-                        
-                        const actionsDiv = document.createElement('div');
-                        actionsDiv.className = 'file-actions';
-                        
-                        const downloadBtn = document.createElement('a');
-                        downloadBtn.className = 'btn download-btn';
-                        downloadBtn.textContent = 'Télécharger';
-                        downloadBtn.href = '/' + file.path;
-                        actionsDiv.appendChild(downloadBtn);
-                        
-                        // Bouton de partage uniquement pour les fichiers
-                        if (file.type === 'file') {
-                            const toggleBtn = document.createElement('button');
-                            toggleBtn.className = 'btn toggle-btn';
-                            toggleBtn.textContent = file.shareable ? 'Ne pas partager' : 'Rendre partageable';
-                            toggleBtn.onclick = () => toggleShareable(file.path, !file.shareable);
-                            actionsDiv.appendChild(toggleBtn);
-                            
-                            if (file.shareable) {
-                                const shareBtn = document.createElement('button');
-                                shareBtn.className = 'btn share-btn';
-                                shareBtn.textContent = 'Partager';
-                                shareBtn.onclick = () => createShareLink(file.path);
-                                actionsDiv.appendChild(shareBtn);
-                            }
-                        }
-                        
-                        li.appendChild(nameDiv);
-                        li.appendChild(actionsDiv);
-                        fileList.appendChild(li);
-                    });
-                })
-                .catch(error => console.error('Erreur lors du chargement des fichiers:', error));
-        }
-        
-        // Activer/Désactiver le partage d'un fichier
-        function toggleShareable(path, shareable) {
-            fetch('/api/toggle-shareable', {
-                method: 'POST',
-                headers: { 'Content-Type': 'application/json' },
-                body: JSON.stringify({ path: path, shareable: shareable })
-            })
-            .then(response => {
-                if (response.ok) {
-                    loadFiles(); // Recharger la liste des fichiers
-                } else {
-                    console.error('Erreur lors du changement de statut de partage');
-                }
-            })
-            .catch(error => console.error('Erreur:', error));
-        }
-        
-        // Créer un lien de partage
-        function createShareLink(path) {
-            fetch('/api/share', {
-                method: 'POST',
-                headers: { 'Content-Type': 'application/json' },
-                body: JSON.stringify({ path: path, expiry: 24 })
-            })
-            .then(response => response.json())
-            .then(data => {
-                const shareLink = document.getElementById('shareLink');
-                shareLink.textContent = window.location.origin + data.link;
-                
-                document.getElementById('expiryHours').textContent = data.expiry;
-                
-                const modal = document.getElementById('shareModal');
-                modal.style.display = 'flex';
-            })
-            .catch(error => console.error('Erreur lors de la création du lien:', error));
-        }
-        
-        // Copier le lien de partage
-        function copyShareLink() {
-            const shareLink = document.getElementById('shareLink').textContent;
-            navigator.clipboard.writeText(shareLink).then(() => {
-                const copySuccess = document.getElementById('copySuccess');
-                copySuccess.style.display = 'inline';
-                setTimeout(() => { copySuccess.style.display = 'none'; }, 2000);
-            });
-        }
-        
-        // Fermer la modal
-        document.querySelector('.close-btn').onclick = function() {
-            document.getElementById('shareModal').style.display = 'none';
-        }
-        
-        // Fermer la modal si on clique en dehors
-        window.onclick = function(event) {
-            const modal = document.getElementById('shareModal');
-            if (event.target == modal) {
-                modal.style.display = 'none';
-            }
-        }
-        
-        // Charger les fichiers au démarrage
-        document.addEventListener('DOMContentLoaded', loadFiles);
-    </script>
-</body>
-</html>
-)=====";
 
 namespace esphome {
 namespace ftp_http_proxy {
 
+// Interface web (web/index.html) compressée en gzip par __init__.py, stockée en flash
+extern const uint8_t INDEX_HTML_GZ[];
+extern const size_t INDEX_HTML_GZ_SIZE;
+extern const char INDEX_HTML_ETAG[];
+
 void FTPHTTPProxy::setup() {
   ESP_LOGI(TAG, "Initialisation du proxy FTP/HTTP avec ESP-IDF 5.1.5");
 
+  // Pool de connexions de contrôle FTP
+  pool_mutex_ = xSemaphoreCreateMutex();
+  pool_slots_ = xSemaphoreCreateCounting(pool_size_, pool_size_);
+  dir_cache_mutex_ = xSemaphoreCreateMutex();
+  shares_mutex_ = xSemaphoreCreateMutex();
+  metadata_mutex_ = xSemaphoreCreateMutex();
+  dns_mutex_ = xSemaphoreCreateMutex();
+  flights_mutex_ = xSemaphoreCreateMutex();
+  if (pool_mutex_ == nullptr || pool_slots_ == nullptr || dir_cache_mutex_ == nullptr || shares_mutex_ == nullptr ||
+      metadata_mutex_ == nullptr || dns_mutex_ == nullptr || flights_mutex_ == nullptr ||
+      !file_cache_.init(cache_size_, cache_max_file_size_, cache_directory_, cache_directory_size_)) {
+    ESP_LOGE(TAG, "Échec de création du pool de connexions FTP");
+    this->mark_failed();
+    return;
+  }
+
+  if (signed_share_tokens_ && !share_signer_.init()) {
+    ESP_LOGW(TAG, "Clé de partage indisponible: liens de partage aléatoires");
+  }
+
+  // Partages persistants: seul l'en-tête de l'image est lu, les recherches se font en flash
+  if (!store_partition_.empty()) {
+    int64_t start = esp_timer_get_time();
+    if (share_store_.open(store_partition_)) {
+      ESP_LOGI(TAG, "Partages persistants: %u fichiers, %u liens, ouverts en %lld µs",
+               (unsigned) share_store_.file_count(), (unsigned) share_store_.share_count(),
+               (long long) (esp_timer_get_time() - start));
+      if (xTaskCreate(share_store_task, "ftp_store", 4096, this, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+        ESP_LOGW(TAG, "Tâche d'écriture des partages non créée, écriture à l'arrêt uniquement");
+      }
+    } else {
+      ESP_LOGW(TAG, "Partition de partages indisponible: partages conservés en RAM uniquement");
+    }
+  }
+
+  // Mounts locaux: le système de fichiers peut être monté plus tard, un absent n'est pas bloquant
+  for (auto &mount : local_mounts_) {
+    struct stat st;
+    if (stat(mount->root().c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+      ESP_LOGI(TAG, "Mount local: /%s/ -> %s", mount->prefix().c_str(), mount->root().c_str());
+    } else {
+      ESP_LOGW(TAG, "Mount local /%s/: répertoire %s introuvable pour l'instant", mount->prefix().c_str(),
+               mount->root().c_str());
+    }
+  }
+
+  // Workers de transfert permanents alimentés par une file d'attente bornée
+  job_queue_ = xQueueCreate(transfer_queue_size_, sizeof(FileTransferContext *));
+  if (job_queue_ == nullptr) {
+    ESP_LOGE(TAG, "Échec de création de la file de transferts");
+    this->mark_failed();
+    return;
+  }
+  for (int i = 0; i < transfer_workers_; i++) {
+    char name[24];
+    snprintf(name, sizeof(name), "ftp_worker_%d", i);
+    BaseType_t task_created = xTaskCreatePinnedToCore(
+      transfer_worker_task,         // Fonction de tâche
+      name,                         // Nom de tâche
+      8192,                         // Taille de la pile
+      this,                         // Paramètres de la tâche
+      tskIDLE_PRIORITY + 1,         // Priorité
+      NULL,                         // Handle (non nécessaire)
+      1                             // S'exécute sur le cœur 1 (laisse le cœur 0 pour l'interface WiFi)
+    );
+    if (task_created != pdPASS) {
+      ESP_LOGE(TAG, "Échec de création du worker de transfert %d", i);
+      this->mark_failed();
+      return;
+    }
+  }
+
+  // Résolution de l'adresse du serveur FTP hors du chemin des requêtes
+  if (xTaskCreate(dns_refresh_task, "ftp_dns", 3072, this, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+    ESP_LOGW(TAG, "Tâche de résolution DNS non créée, résolution à la première requête");
+  }
+
   // Ne pas essayer de réinitialiser le watchdog, utiliser celui déjà configuré
   // Planifier le démarrage du serveur HTTP après un délai pour que le WiFi et LWIP soient prêts
   delayed_setup_ = true;
@@ -216,454 +141,1602 @@ void FTPHTTPProxy::loop() {
     return;
   }
 
+  // Fermeture des connexions FTP inactives depuis trop longtemps
+  this->evict_idle_ftp_connections();
+
   // Nettoyage des liens de partage expirés
+  this->expire_shares();
+
+#ifdef USE_SENSOR
+  this->publish_sensors();
+#endif
+}
+
+#ifdef USE_SENSOR
+void FTPHTTPProxy::publish_sensors() {
+  uint32_t now = millis();
+  if (now - last_sensor_publish_ < SENSOR_PUBLISH_INTERVAL_MS) {
+    return;
+  }
+  last_sensor_publish_ = now;
+
+  ProxyMetrics &metrics = proxy_metrics();
+  if (active_transfers_sensor_ != nullptr) {
+    active_transfers_sensor_->publish_state(metrics.active_transfers);
+  }
+  if (bytes_relayed_sensor_ != nullptr) {
+    bytes_relayed_sensor_->publish_state(metrics.bytes_relayed);
+  }
+  if (queue_depth_sensor_ != nullptr && job_queue_ != nullptr) {
+    queue_depth_sensor_->publish_state(uxQueueMessagesWaiting(job_queue_));
+  }
+  if (ftp_errors_sensor_ != nullptr) {
+    ftp_errors_sensor_->publish_state(metrics.ftp_errors_total);
+  }
+  if (cache_hit_ratio_sensor_ != nullptr) {
+    uint32_t hits = file_cache_.hits();
+    uint32_t total = hits + file_cache_.misses();
+    cache_hit_ratio_sensor_->publish_state(total > 0 ? 100.0f * hits / total : 0.0f);
+  }
+  if (psram_free_sensor_ != nullptr) {
+    psram_free_sensor_->publish_state(heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+  }
+  if (internal_free_sensor_ != nullptr) {
+    internal_free_sensor_->publish_state(heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+  }
+}
+#endif
+
+void FTPHTTPProxy::expire_shares() {
   int64_t now = esp_timer_get_time() / 1000000; // Temps en secondes
-  active_shares_.erase(
-    std::remove_if(
-      active_shares_.begin(), 
-      active_shares_.end(),
-      [now](const ShareLink& link) { return link.expiry < now; }
-    ),
-    active_shares_.end()
-  );
+  if (xSemaphoreTake(shares_mutex_, 0) != pdTRUE) {
+    return;
+  }
+  // Seuls les liens arrivés à échéance sont visités: O(expirés) par passage
+  while (!share_expiries_.empty() && share_expiries_.top().expiry < now) {
+    const ShareExpiry &top = share_expiries_.top();
+    ShareLink *share = active_shares_.find(top.token);
+    // Entrée périmée du tas si le lien a été remplacé entre-temps
+    if (share != nullptr && share->expiry == top.expiry) {
+      ESP_LOGD(TAG, "Lien de partage expiré: %s", top.token.c_str());
+      active_shares_.erase(top.token);
+    }
+    share_expiries_.pop();
+  }
+  xSemaphoreGive(shares_mutex_);
 }
 
-bool FTPHTTPProxy::is_shareable(const std::string &path) {
-  // Rechercher le fichier dans notre liste
-  for (const auto &file : ftp_files_) {
-    if (file.path == path) {
-      return file.shareable;
+// Avant cette date, l'horloge n'a pas encore été synchronisée (SNTP)
+static const time_t CLOCK_VALID_AFTER = 1577836800;  // 2020-01-01
+
+// Token aléatoire (8 chiffres hexadécimaux) sous la forme stockée dans la partition
+static bool parse_random_token(const std::string &token, uint32_t &value) {
+  if (token.size() != 8 || token.find_first_not_of("0123456789abcdef") != std::string::npos) {
+    return false;
+  }
+  value = strtoul(token.c_str(), nullptr, 16);
+  return true;
+}
+
+void FTPHTTPProxy::add_share(const ShareLink &share) {
+  xSemaphoreTake(shares_mutex_, portMAX_DELAY);
+  active_shares_.insert(share.token, share);
+  share_expiries_.push(ShareExpiry{share.expiry, share.token});
+  store_dirty_ = true;
+  xSemaphoreGive(shares_mutex_);
+}
+
+bool FTPHTTPProxy::find_share(const std::string &token, ShareLink &share) {
+  xSemaphoreTake(shares_mutex_, portMAX_DELAY);
+  ShareLink *found = active_shares_.find(token);
+  if (found != nullptr) {
+    share = *found;
+  }
+  // Liens de la partition ignorés tant qu'une révocation n'y est pas écrite
+  bool stored_valid = shares_revoked_ == store_revoked_;
+  xSemaphoreGive(shares_mutex_);
+  if (found != nullptr) {
+    return true;
+  }
+
+  uint32_t value;
+  uint32_t expiry;
+  if (!stored_valid || !parse_random_token(token, value) || !share_store_.find_share(value, share.path, expiry)) {
+    return false;
+  }
+  // Échéance enregistrée en heure Unix, ramenée au temps écoulé depuis le démarrage
+  time_t now = time(nullptr);
+  if (now < CLOCK_VALID_AFTER) {
+    ESP_LOGW(TAG, "Horloge non synchronisée: lien %s enregistré invérifiable", token.c_str());
+    return false;
+  }
+  share.token = token;
+  share.expiry = esp_timer_get_time() / 1000000 + ((int64_t) expiry - now);
+  return true;
+}
+
+bool FTPHTTPProxy::lookup_metadata(const std::string &path, int64_t &size, time_t &modified) {
+  if (metadata_cache_ttl_ms_ == 0) {
+    return false;
+  }
+  int64_t now = esp_timer_get_time();
+  xSemaphoreTake(metadata_mutex_, portMAX_DELAY);
+  FileMetadata *meta = metadata_cache_.find(path);
+  bool fresh = meta != nullptr && (now - meta->fetched) / 1000 < metadata_cache_ttl_ms_;
+  if (fresh) {
+    size = meta->size;
+    modified = meta->modified;
+  }
+  xSemaphoreGive(metadata_mutex_);
+  return fresh;
+}
+
+void FTPHTTPProxy::store_metadata(const std::string &path, int64_t size, time_t modified) {
+  if (metadata_cache_ttl_ms_ == 0) {
+    return;
+  }
+  int64_t now = esp_timer_get_time();
+  xSemaphoreTake(metadata_mutex_, portMAX_DELAY);
+  if (metadata_cache_.size() >= MAX_CACHED_METADATA) {
+    // Purge des entrées expirées; si rien n'a expiré, on repart d'une table vide
+    std::vector<std::string> expired;
+    metadata_cache_.for_each([&](const std::string &key, FileMetadata &meta) {
+      if ((now - meta.fetched) / 1000 >= metadata_cache_ttl_ms_) {
+        expired.push_back(key);
+      }
+    });
+    for (const auto &key : expired) {
+      metadata_cache_.erase(key);
+    }
+    if (metadata_cache_.size() >= MAX_CACHED_METADATA) {
+      metadata_cache_.clear();
     }
   }
-  return false;
+  metadata_cache_.insert(path, FileMetadata{size, modified, now});
+  xSemaphoreGive(metadata_mutex_);
 }
 
-void FTPHTTPProxy::create_share_link(const std::string &path, int expiry_hours) {
-  // Vérifier si le fichier est partageable
+void FTPHTTPProxy::invalidate_metadata(const std::string &path) {
+  xSemaphoreTake(metadata_mutex_, portMAX_DELAY);
+  metadata_cache_.erase(path);
+  xSemaphoreGive(metadata_mutex_);
+}
+
+bool FTPHTTPProxy::is_shareable(const std::string &path) {
+  // Changements en RAM d'abord, puis l'image de la partition
+  xSemaphoreTake(shares_mutex_, portMAX_DELAY);
+  FileEntry *file = ftp_files_.find(path);
+  bool known = file != nullptr;
+  bool shareable = known && file->shareable;
+  xSemaphoreGive(shares_mutex_);
+  if (!known && !share_store_.find_file(path, shareable)) {
+    shareable = false;
+  }
+  return shareable;
+}
+
+void FTPHTTPProxy::set_shareable(const std::string &path, bool shareable) {
+  uint32_t path_id = share_path_id(path);
+  std::string stored;
+  bool stored_known = share_store_.find_path(path_id, stored);
+  xSemaphoreTake(shares_mutex_, portMAX_DELAY);
+  ftp_files_.insert(path, FileEntry{path, shareable});
+  std::string *known = share_paths_.find(path_id);
+  const std::string *owner = known != nullptr ? known : (stored_known ? &stored : nullptr);
+  if (shareable && owner == nullptr) {
+    share_paths_.insert(path_id, path);
+  } else if (shareable && *owner != path) {
+    ESP_LOGW(TAG, "Collision de path_id entre %s et %s: liens aléatoires pour ce fichier", owner->c_str(),
+             path.c_str());
+  } else if (!shareable && known != nullptr && *known == path) {
+    // Retirer le fichier invalide aussi ses liens signés
+    share_paths_.erase(path_id);
+  }
+  store_dirty_ = true;
+  xSemaphoreGive(shares_mutex_);
+}
+
+bool FTPHTTPProxy::path_for_id(uint32_t path_id, std::string &path) {
+  xSemaphoreTake(shares_mutex_, portMAX_DELAY);
+  std::string *known = share_paths_.find(path_id);
+  if (known != nullptr) {
+    path = *known;
+  }
+  xSemaphoreGive(shares_mutex_);
+  return known != nullptr || share_store_.find_path(path_id, path);
+}
+
+std::string FTPHTTPProxy::issue_share(const std::string &path, int expiry_hours) {
   if (!is_shareable(path)) {
     ESP_LOGW(TAG, "Tentative de partage d'un fichier non partageable: %s", path.c_str());
-    return;
+    return "";
   }
-  
+
+  // Token signé: l'expiration est une heure Unix, elle survit donc à un redémarrage
+  std::string owner;
+  bool signable = path_for_id(share_path_id(path), owner) && owner == path;
+  time_t now = time(nullptr);
+  if (share_signer_.ready() && signable && now >= CLOCK_VALID_AFTER) {
+    return share_signer_.sign(path, (uint32_t) (now + (int64_t) expiry_hours * 3600));
+  }
+  if (share_signer_.ready() && now < CLOCK_VALID_AFTER) {
+    ESP_LOGW(TAG, "Horloge non synchronisée: lien aléatoire pour %s", path.c_str());
+  }
+
   // Générer un token aléatoire
-  uint32_t random_value = esp_random();
   char token[16];
-  snprintf(token, sizeof(token), "%08x", random_value);
-  
+  snprintf(token, sizeof(token), "%08x", (unsigned) esp_random());
+
   // Créer le lien de partage avec expiration
   ShareLink share;
   share.path = path;
   share.token = token;
-  share.expiry = (esp_timer_get_time() / 1000000) + (expiry_hours * 3600);
-  
-  // Ajouter à la liste des partages actifs
-  active_shares_.push_back(share);
-  
-  ESP_LOGI(TAG, "Lien de partage créé pour %s: token=%s, expire dans %d heures", 
-           path.c_str(), token, expiry_hours);
+  share.expiry = (esp_timer_get_time() / 1000000) + (int64_t) expiry_hours * 3600;
+  add_share(share);
+  return token;
 }
 
-bool FTPHTTPProxy::connect_to_ftp(int& sock, const char* server, const char* username, const char* password) {
-  struct hostent *ftp_host = gethostbyname(server);
-  if (!ftp_host) {
-    ESP_LOGE(TAG, "Échec de la résolution DNS");
+bool FTPHTTPProxy::resolve_share(const std::string &token, std::string &path, bool &expired) {
+  expired = false;
+  SignedShare signed_share;
+  if (share_signer_.ready() && ShareTokenSigner::decode(token, signed_share)) {
+    // Le fichier de l'image peut avoir été retiré du partage depuis la dernière écriture
+    if (!path_for_id(signed_share.path_id, path) || !share_signer_.verify(signed_share, path) ||
+        !is_shareable(path)) {
+      return false;
+    }
+    time_t now = time(nullptr);
+    if (now < CLOCK_VALID_AFTER) {
+      ESP_LOGW(TAG, "Horloge non synchronisée: expiration du lien invérifiable");
+      return false;
+    }
+    expired = (time_t) signed_share.expiry < now;
+    return true;
+  }
+
+  ShareLink share;
+  if (!find_share(token, share) || share.path.empty()) {
     return false;
   }
+  path = share.path;
+  expired = share.expiry < esp_timer_get_time() / 1000000;
+  return true;
+}
+
+bool FTPHTTPProxy::revoke_shares() {
+  xSemaphoreTake(shares_mutex_, portMAX_DELAY);
+  active_shares_.clear();
+  share_expiries_ = decltype(share_expiries_)();
+  shares_revoked_++;
+  store_dirty_ = true;
+  xSemaphoreGive(shares_mutex_);
+  return !share_signer_.ready() || share_signer_.revoke();
+}
+
+void FTPHTTPProxy::create_share_link(const std::string &path, int expiry_hours) {
+  std::string token = issue_share(path, expiry_hours);
+  if (!token.empty()) {
+    ESP_LOGI(TAG, "Lien de partage créé pour %s: token=%s, expire dans %d heures", path.c_str(), token.c_str(),
+             expiry_hours);
+  }
+}
+
+void FTPHTTPProxy::share_store_task(void* param) {
+  auto *proxy = (FTPHTTPProxy *)param;
+  while (true) {
+    vTaskDelay(pdMS_TO_TICKS(proxy->store_flush_ms_));
+    proxy->flush_share_store();
+  }
+}
+
+void FTPHTTPProxy::flush_share_store() {
+  if (!share_store_.ready()) {
+    return;
+  }
+  time_t now = time(nullptr);
+  bool clock_valid = now >= CLOCK_VALID_AFTER;
+  int64_t uptime = esp_timer_get_time() / 1000000;
+
+  // Tous les changements accumulés depuis la dernière écriture partent en une seule image
+  std::vector<StoredFile> files;
+  std::vector<StoredShare> shares;
+  std::vector<std::string> tokens;
+  xSemaphoreTake(shares_mutex_, portMAX_DELAY);
+  // Horloge enfin synchronisée: les liens gardés en RAM peuvent entrer dans l'image
+  if (shares_await_clock_ && clock_valid) {
+    shares_await_clock_ = false;
+    store_dirty_ = true;
+  }
+  if (!store_dirty_) {
+    xSemaphoreGive(shares_mutex_);
+    return;
+  }
+  store_dirty_ = false;
+  ftp_files_.for_each([&](const std::string &path, FileEntry &file) { files.push_back({path, file.shareable}); });
+  bool unsaved_shares = false;
+  active_shares_.for_each([&](const std::string &token, ShareLink &share) {
+    uint32_t value;
+    if (!clock_valid) {
+      // Sans heure Unix, l'échéance ne peut pas être enregistrée: le lien reste en RAM
+      unsaved_shares = true;
+    } else if (parse_random_token(token, value)) {
+      shares.push_back({value, share.path, (uint32_t) (now + (share.expiry - uptime))});
+      tokens.push_back(token);
+    }
+  });
+  uint32_t revoked = shares_revoked_;
+  bool drop_shares = revoked != store_revoked_;
+  xSemaphoreGive(shares_mutex_);
+
+  bool committed = share_store_.commit(files, shares, drop_shares, clock_valid ? now : 0);
+
+  xSemaphoreTake(shares_mutex_, portMAX_DELAY);
+  // Pas de nouvelle image pour ces liens tant que l'horloge n'est pas valide
+  shares_await_clock_ |= unsaved_shares;
+  if (!committed) {
+    store_dirty_ = true;
+  } else {
+    store_revoked_ = revoked;
+    // Ce qui est dans l'image quitte la RAM, sauf ce qui a changé pendant l'écriture
+    for (const auto &file : files) {
+      FileEntry *entry = ftp_files_.find(file.path);
+      if (entry != nullptr && entry->shareable == file.shareable) {
+        ftp_files_.erase(file.path);
+        uint32_t path_id = share_path_id(file.path);
+        std::string *known = share_paths_.find(path_id);
+        if (known != nullptr && *known == file.path) {
+          share_paths_.erase(path_id);
+        }
+      }
+    }
+    for (size_t i = 0; i < shares.size(); i++) {
+      ShareLink *share = active_shares_.find(tokens[i]);
+      if (share != nullptr && share->path == shares[i].path) {
+        active_shares_.erase(tokens[i]);
+      }
+    }
+  }
+  xSemaphoreGive(shares_mutex_);
+}
 
-  sock = socket(AF_INET, SOCK_STREAM, 0);
-  if (sock < 0) {
-    ESP_LOGE(TAG, "Échec de création du socket : %d", errno);
+void FTPHTTPProxy::on_shutdown() {
+  // Redémarrage (OTA, bouton): écrire les changements en attente sans attendre la tâche
+  flush_share_store();
+}
+
+bool FTPHTTPProxy::connect_to_ftp(FtpControl &ctrl, bool record_failures) {
+  struct sockaddr_storage addr;
+  socklen_t addr_len;
+  ctrl.sock = -1;
+  ctrl.pending.clear();
+  ctrl.epsv = use_epsv_;
+  if (!get_server_address(addr, addr_len)) {
+    if (record_failures) {
+      record_ftp_reachable(false);
+    }
     return false;
   }
+  int result = ftp_login(ctrl, (struct sockaddr *) &addr, addr_len, username_.c_str(), password_.c_str(),
+                         connect_timeout_ms_);
+  // Une session refusée (identifiants, limite de sessions) prouve que le serveur répond
+  if (record_failures || result != FTP_UNREACHABLE) {
+    record_ftp_reachable(result != FTP_UNREACHABLE);
+  }
+  return result == 0;
+}
 
-  // Configuration du socket pour être plus robuste
-  int flag = 1;
-  setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &flag, sizeof(flag));
-  
-  // Augmenter la taille du buffer de réception
-  int rcvbuf = 16384;
-  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
-
-  // Timeout pour les opérations socket
-  struct timeval timeout = {.tv_sec = 10, .tv_usec = 0};
-  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-  setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
-
-  struct sockaddr_in server_addr;
-  memset(&server_addr, 0, sizeof(server_addr));
-  server_addr.sin_family = AF_INET;
-  server_addr.sin_port = htons(21);
-  server_addr.sin_addr.s_addr = *((unsigned long *)ftp_host->h_addr);
-
-  if (connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) != 0) {
-    ESP_LOGE(TAG, "Échec de connexion FTP : %d", errno);
-    close(sock);
-    sock = -1;
+void FTPHTTPProxy::dns_refresh_task(void* param) {
+  auto *proxy = (FTPHTTPProxy *)param;
+  while (true) {
+    bool resolved = proxy->refresh_server_address();
+    vTaskDelay(pdMS_TO_TICKS(resolved ? proxy->dns_refresh_ms_ : 5000));
+  }
+}
+
+bool FTPHTTPProxy::refresh_server_address() {
+  struct sockaddr_storage addr;
+  socklen_t addr_len;
+  if (!ftp_resolve(ftp_server_.c_str(), ftp_port_, addr, addr_len)) {
+    // L'adresse précédente reste utilisable: un serveur DNS muet ne coupe pas l'accès au NAS
     return false;
   }
+  xSemaphoreTake(dns_mutex_, portMAX_DELAY);
+  server_addr_ = addr;
+  server_addr_len_ = addr_len;
+  xSemaphoreGive(dns_mutex_);
+  return true;
+}
 
-  char buffer[512];
-  int bytes_received = recv(sock, buffer, sizeof(buffer) - 1, 0);
-  if (bytes_received <= 0 || !strstr(buffer, "220 ")) {
-    ESP_LOGE(TAG, "Message de bienvenue FTP non reçu");
-    close(sock);
-    sock = -1;
+bool FTPHTTPProxy::get_server_address(struct sockaddr_storage &addr, socklen_t &addr_len) {
+  xSemaphoreTake(dns_mutex_, portMAX_DELAY);
+  addr = server_addr_;
+  addr_len = server_addr_len_;
+  xSemaphoreGive(dns_mutex_);
+  if (addr_len > 0) {
+    return true;
+  }
+
+  // Pas encore résolue (démarrage avant le Wi-Fi): résolution immédiate par le worker
+  if (!refresh_server_address()) {
     return false;
   }
-  buffer[bytes_received] = '\0';
-
-  // Authentification
-  snprintf(buffer, sizeof(buffer), "USER %s\r\n", username);
-  send(sock, buffer, strlen(buffer), 0);
-  bytes_received = recv(sock, buffer, sizeof(buffer) - 1, 0);
-  buffer[bytes_received] = '\0';
-
-  snprintf(buffer, sizeof(buffer), "PASS %s\r\n", password);
-  send(sock, buffer, strlen(buffer), 0);
-  bytes_received = recv(sock, buffer, sizeof(buffer) - 1, 0);
-  buffer[bytes_received] = '\0';
-  if (!strstr(buffer, "230 ")) {
-    ESP_LOGE(TAG, "Authentification FTP échouée: %s", buffer);
-    close(sock);
-    sock = -1;
+  xSemaphoreTake(dns_mutex_, portMAX_DELAY);
+  addr = server_addr_;
+  addr_len = server_addr_len_;
+  xSemaphoreGive(dns_mutex_);
+  return true;
+}
+
+uint32_t FTPHTTPProxy::ftp_unavailable_for_ms() const {
+  int32_t remaining = (int32_t) (breaker_open_until_.load() - millis());
+  return consecutive_failures_ >= BREAKER_THRESHOLD && remaining > 0 ? remaining : 0;
+}
+
+void FTPHTTPProxy::record_ftp_reachable(bool reachable) {
+  if (reachable) {
+    if (consecutive_failures_.exchange(0) >= BREAKER_THRESHOLD) {
+      ESP_LOGI(TAG, "Serveur FTP de nouveau joignable");
+    }
+    return;
+  }
+  if (++consecutive_failures_ >= BREAKER_THRESHOLD) {
+    breaker_open_until_ = millis() + BREAKER_OPEN_MS;
+    ESP_LOGW(TAG, "Serveur FTP injoignable (%u échecs), requêtes refusées pendant %u s",
+             (unsigned) consecutive_failures_.load(), (unsigned) (BREAKER_OPEN_MS / 1000));
+  }
+}
+
+bool FTPHTTPProxy::acquire_ftp_connection(FTPControlConnection &conn, TickType_t wait, bool *refused) {
+  // Disjoncteur ouvert: inutile d'attendre un délai de connexion de plus
+  if (ftp_unavailable_for_ms() > 0) {
     return false;
   }
 
-  // Mode binaire
-  send(sock, "TYPE I\r\n", 8, 0);
-  bytes_received = recv(sock, buffer, sizeof(buffer) - 1, 0);
-  buffer[bytes_received] = '\0';
+  // Attendre qu'une session soit disponible (borne la charge sur le serveur FTP)
+  if (xSemaphoreTake(pool_slots_, wait) != pdTRUE) {
+    if (wait > 0) {
+      ESP_LOGW(TAG, "Aucune connexion FTP disponible dans le pool");
+    }
+    return false;
+  }
+
+  char buffer[128];
+  while (true) {
+    bool found = false;
+    xSemaphoreTake(pool_mutex_, portMAX_DELAY);
+    if (!idle_connections_.empty()) {
+      conn = idle_connections_.back();
+      idle_connections_.pop_back();
+      found = true;
+    }
+    xSemaphoreGive(pool_mutex_);
+
+    if (!found) {
+      break;
+    }
 
+    // Connexion restée inactive trop longtemps: le serveur l'a probablement fermée
+    int64_t idle_ms = (esp_timer_get_time() - conn.last_used) / 1000;
+    if (idle_ms < idle_timeout_ms_ && ftp_command(conn, "NOOP\r\n", buffer, sizeof(buffer)) == 200 &&
+        conn.pending.empty()) {
+      ESP_LOGD(TAG, "Réutilisation d'une connexion FTP du pool (socket %d)", conn.sock);
+      return true;
+    }
+
+    ESP_LOGD(TAG, "Connexion FTP du pool expirée, fermeture (socket %d)", conn.sock);
+    close(conn.sock);
+    conn.sock = -1;
+  }
+
+  // Aucune connexion réutilisable: en ouvrir une nouvelle
+  if (!connect_to_ftp(conn, refused == nullptr)) {
+    xSemaphoreGive(pool_slots_);
+    if (refused != nullptr) {
+      *refused = true;
+    }
+    return false;
+  }
+  uint32_t logins = ++proxy_metrics().ftp_logins;
+  ESP_LOGI(TAG, "Nouvelle connexion FTP authentifiée (connexions ouvertes depuis le démarrage: %u)",
+           (unsigned) logins);
   return true;
 }
 
-/* Cette fonction exécute le transfert de fichier dans une tâche séparée */
-// Correction dans la fonction file_transfer_task
+bool FTPHTTPProxy::acquire_segment_lane(FTPControlConnection &conn, size_t lanes_held) {
+  uint32_t cap = segment_lane_cap_.load();
+  if (cap > 0) {
+    if ((int32_t) (segment_cap_until_.load() - millis()) <= 0) {
+      segment_lane_cap_ = 0;
+    } else if (lanes_held >= cap) {
+      return false;
+    }
+  }
 
-void FTPHTTPProxy::file_transfer_task(void* param) {
-  FileTransferContext* ctx = (FileTransferContext*)param;
-  if (!ctx) {
-    ESP_LOGE(TAG, "Contexte de transfert invalide");
+  bool refused = false;
+  if (acquire_ftp_connection(conn, 0, &refused)) {
+    return true;
+  }
+  if (refused) {
+    segment_lane_cap_ = lanes_held;
+    segment_cap_until_ = millis() + SEGMENT_CAP_MS;
+    ESP_LOGI(TAG, "Session FTP supplémentaire refusée: téléchargements segmentés limités à %u session(s)",
+             (unsigned) lanes_held);
+  }
+  return false;
+}
+
+void FTPHTTPProxy::release_ftp_connection(FTPControlConnection &conn, bool reusable) {
+  if (conn.sock < 0) {
+    xSemaphoreGive(pool_slots_);
+    return;
+  }
+
+  // Des octets en attente signifient une réponse non consommée: la session est désynchronisée
+  if (reusable && conn.pending.empty()) {
+    conn.last_used = esp_timer_get_time();
+    xSemaphoreTake(pool_mutex_, portMAX_DELAY);
+    idle_connections_.push_back(conn);
+    xSemaphoreGive(pool_mutex_);
+  } else {
+    send(conn.sock, "QUIT\r\n", 6, 0);
+    close(conn.sock);
+  }
+  conn.sock = -1;
+  conn.pending.clear();
+  xSemaphoreGive(pool_slots_);
+}
+
+void FTPHTTPProxy::evict_idle_ftp_connections() {
+  // Ne jamais bloquer la boucle principale: on réessaiera au prochain passage
+  if (pool_mutex_ == nullptr || xSemaphoreTake(pool_mutex_, 0) != pdTRUE) {
+    return;
+  }
+
+  int64_t now = esp_timer_get_time();
+  auto it = idle_connections_.begin();
+  while (it != idle_connections_.end()) {
+    if ((now - it->last_used) / 1000 >= idle_timeout_ms_) {
+      ESP_LOGD(TAG, "Éviction d'une connexion FTP inactive (socket %d)", it->sock);
+      send(it->sock, "QUIT\r\n", 6, 0);
+      close(it->sock);
+      it = idle_connections_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  xSemaphoreGive(pool_mutex_);
+}
+
+// Sert un fichier depuis le cache mémoire, plages comprises, sans aucun échange FTP
+static bool serve_cached_file(FileTransferContext* ctx, const CachedFile &file) {
+  HttpResponseHead head;
+  set_content_type(head, ctx->remote_path);
+  set_validators(head, ctx->remote_path, file.size, file.modified);
+
+  int64_t offset, length;
+  RangeResult range = resolve_range(ctx, file.size, offset, length);
+  if (range == RANGE_UNSATISFIABLE) {
+    send_range_not_satisfiable(ctx->req, head, file.size);
+    return true;
+  }
+  if (length < 0) {
+    length = file.size - offset;
+  }
+  if (range == RANGE_OK) {
+    set_partial_content(head, offset, offset + length - 1, file.size);
+  }
+
+  if (!send_fixed_length_head(ctx->req, head, length) ||
+      !send_all(ctx->req, (const char*) file.data + offset, length)) {
+    httpd_sess_trigger_close(ctx->req->handle, httpd_req_to_sockfd(ctx->req));
+    return false;
+  }
+  proxy_metrics().bytes_relayed += length;
+  ESP_LOGI(TAG, "Servi depuis le cache: %s (%lld octets)", ctx->remote_path.c_str(), (long long) length);
+  return true;
+}
+
+/* Tâche de travail permanente: consomme les transferts de la file d'attente */
+void FTPHTTPProxy::transfer_worker_task(void* param) {
+  auto *proxy = (FTPHTTPProxy *)param;
+  FileTransferContext* ctx = nullptr;
+
+  // Buffers et tâche de lecture alloués une fois pour toute la durée de vie du worker
+  RelayEngine relay;
+  size_t read_ahead_count = (proxy->read_ahead_size_ + proxy->relay_buffer_size_ - 1) / proxy->relay_buffer_size_;
+  if (!relay.init(pcTaskGetName(nullptr), proxy->relay_buffer_count_, proxy->relay_buffer_size_,
+                  proxy->relay_use_psram_, read_ahead_count)) {
+    ESP_LOGE(TAG, "Échec d'initialisation du relais, worker arrêté");
     vTaskDelete(NULL);
     return;
   }
-  
-  ESP_LOGI(TAG, "Démarrage du transfert pour %s", ctx->remote_path.c_str());
-  
-  // Important: Créer une instance locale de FTPHTTPProxy pose problème
-  // car elle n'a pas accès aux données membres de l'instance originale
-  // Utilisons directement le contexte transmis
-  
-  int ftp_sock = -1;
+
+  while (true) {
+    if (xQueueReceive(proxy->job_queue_, &ctx, portMAX_DELAY) != pdTRUE || !ctx) {
+      continue;
+    }
+
+    ProxyMetrics &metrics = proxy_metrics();
+    metrics.active_transfers++;
+    metrics.transfers_total++;
+    int64_t start_time = esp_timer_get_time();
+    if (ctx->upload) {
+      ctx->backend->upload(ctx);
+    } else {
+      ctx->backend->download(ctx, relay);
+    }
+    metrics.transfer.record_us((uint32_t) (esp_timer_get_time() - start_time));
+    metrics.active_transfers--;
+
+    // Rendre la requête à httpd: la connexion client peut être réutilisée ou fermée
+    httpd_req_async_handler_complete(ctx->req);
+    delete ctx;
+  }
+}
+
+uint32_t FtpStorage::unavailable_for_ms() const { return proxy_->ftp_unavailable_for_ms(); }
+
+void FtpStorage::download(FileTransferContext* ctx, RelayEngine &relay) {
+  if (ctx->resume_length >= 0) {
+    FTPHTTPProxy::resume_transfer_task(ctx, relay);
+  } else {
+    FTPHTTPProxy::file_transfer_task(ctx, relay);
+  }
+}
+
+void FtpStorage::upload(FileTransferContext* ctx) { FTPHTTPProxy::upload_transfer_task(ctx); }
+
+StorageBackend* FTPHTTPProxy::route(const std::string &path) {
+  for (auto &mount : local_mounts_) {
+    if (mount->matches(path)) {
+      return mount.get();
+    }
+  }
+  return &ftp_storage_;
+}
+
+/* Envoi du corps de la requête vers le serveur FTP, par blocs de la taille d'un buffer de relais:
+ * la mémoire utilisée ne dépend pas de la taille du fichier */
+void FTPHTTPProxy::upload_transfer_task(FileTransferContext* ctx) {
+  FTPHTTPProxy* proxy = ctx->proxy;
+  httpd_req_t* req = ctx->req;
+  const char* command_name = ctx->append ? "APPE" : "STOR";
+  ESP_LOGI(TAG, "Démarrage de l'envoi (%s) pour %s, %u octets", command_name, ctx->remote_path.c_str(),
+           (unsigned) req->content_len);
+
+  FTPControlConnection conn;
   int data_sock = -1;
   bool success = false;
-  int bytes_received = 0;
+  bool reusable = false;
+  size_t total_bytes = 0;
+  int64_t start_time = esp_timer_get_time();
+  int code;
+  char reply[512];
+
+  bool psram = proxy->relay_use_psram_ && heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0;
+  size_t chunk_size = proxy->relay_buffer_size_;
+  char* chunk = (char*) heap_caps_malloc(chunk_size, psram ? MALLOC_CAP_SPIRAM : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  if (chunk == nullptr) {
+    ESP_LOGE(TAG, "Échec d'allocation du buffer d'envoi");
+    goto end_upload;
+  }
+
+  if (!proxy->acquire_ftp_connection(conn)) {
+    ESP_LOGE(TAG, "Impossible d'obtenir une connexion FTP");
+    goto end_upload;
+  }
+
+  data_sock = open_data_connection(conn, reply, sizeof(reply), proxy->connect_timeout_ms_);
+  if (data_sock < 0) {
+    goto end_upload;
+  }
 
-  // Allocation du buffer avec PSRAM si disponible
-  bool has_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0;
-  const int buffer_size = 8192;  // Taille optimisée pour l'ESP32-S3
-  char* buffer = nullptr;
+  {
+    std::string command = std::string(command_name) + " " + ctx->remote_path + "\r\n";
+    code = ftp_command(conn, command.c_str(), reply, sizeof(reply));
+  }
+  if (code != 150 && code != 125) {
+    ESP_LOGE(TAG, "Échec de %s: %s", command_name, reply);
+    reusable = code >= 400 && code != 421;
+    goto end_upload;
+  }
+
+  if (!receive_upload_body(req, chunk, chunk_size, [&](const char* data, size_t len) {
+        for (size_t offset = 0; offset < len;) {
+          int sent = send(data_sock, data + offset, len - offset, 0);
+          if (sent <= 0) {
+            ESP_LOGE(TAG, "Erreur d'écriture sur le canal de données: %d", errno);
+            return false;
+          }
+          offset += sent;
+        }
+        return true;
+      }, total_bytes)) {
+    goto end_upload;
+  }
+
+  // Fermer le canal de données signale la fin du fichier au serveur
+  close(data_sock);
+  data_sock = -1;
+  code = ftp_command(conn, nullptr, reply, sizeof(reply));
+  if (code != 226 && code != 250) {
+    ESP_LOGE(TAG, "Fin de %s refusée: %s", command_name, reply);
+    goto end_upload;
+  }
+  reusable = true;
+  success = true;
+
+end_upload:
+  if (data_sock != -1) close(data_sock);
+  if (conn.sock != -1) {
+    proxy->release_ftp_connection(conn, reusable);
+  }
+  heap_caps_free(chunk);
+
+  // Le contenu a pu changer même en cas d'échec partiel: caches du fichier et de son répertoire invalidés
+  size_t slash = ctx->remote_path.rfind('/');
+  proxy->invalidate_dir_cache(slash == std::string::npos ? "" : ctx->remote_path.substr(0, slash));
+  proxy->invalidate_metadata(ctx->remote_path);
+  proxy->file_cache_.remove(ctx->remote_path);
+
+  finish_upload(ctx, success, total_bytes, start_time, "Échec de l'envoi vers le serveur FTP");
+}
+
+/* Cette fonction exécute le transfert de fichier dans une tâche de travail */
+void FTPHTTPProxy::file_transfer_task(FileTransferContext* ctx, RelayEngine &relay) {
+  ESP_LOGI(TAG, "Démarrage du transfert pour %s", ctx->remote_path.c_str());
   
-  if (has_psram) {
-    buffer = (char*)heap_caps_malloc(buffer_size, MALLOC_CAP_SPIRAM);
-    ESP_LOGI(TAG, "Utilisation de la PSRAM pour le buffer");
+  // Le contexte transporte l'instance du proxy, propriétaire du pool de connexions
+  FTPHTTPProxy* proxy = ctx->proxy;
+  FTPControlConnection conn;
+  int data_sock = -1;
+  bool success = false;
+  bool reusable = false;
+  bool headers_sent = false;   // En-têtes partis: le statut HTTP ne peut plus changer
+  bool response_done = false;  // Réponse déjà complète (ex: 416)
+  bool fixed_length = false;   // Content-Length connu: envoi brut sans encodage chunked
+  int64_t file_size = -1;
+  int64_t body_length = -1;
+  int64_t range_offset = 0;
+  int64_t range_length = -1;  // -1: jusqu'à la fin du fichier
+  RangeResult range = RANGE_NONE;
+  HttpResponseHead head;
+  time_t modified = 0;
+  std::shared_ptr<CachedFile> cached;   // Entrée du cache correspondant au chemin
+  std::shared_ptr<CachedFile> filling;  // Copie en cours de constitution pendant le relais
+  bool cached_fresh = false;
+  bool have_metadata = false;
+  int64_t retr_start = 0;
+  FanOutGroup* group = nullptr;    // Autres clients servis par ce transfert
+  bool group_complete = false;     // Corps publié en entier dans l'anneau
+  bool own_client_failed = false;  // Client du meneur perdu, le groupe continue sans lui
+
+  // Buffer des réponses du canal de contrôle; les données passent par les buffers du relais
+  char buffer[1024];
+  const int buffer_size = sizeof(buffer);
+
+  // Métadonnées connues sans FTP: entrée du cache validée récemment, sinon cache de métadonnées
+  cached = proxy->file_cache_.lookup(ctx->remote_path);
+  cached_fresh = cached && (esp_timer_get_time() - cached->validated) / 1000 < proxy->cache_revalidate_ms_;
+  if (cached_fresh) {
+    file_size = cached->size;
+    modified = cached->modified;
+    have_metadata = true;
   } else {
-    buffer = (char*)malloc(buffer_size);
-    ESP_LOGI(TAG, "PSRAM non disponible, utilisation de la RAM standard");
+    have_metadata = proxy->lookup_metadata(ctx->remote_path, file_size, modified);
   }
-  
-  if (!buffer) {
-    ESP_LOGE(TAG, "Échec d'allocation pour le buffer");
+
+  // Requête conditionnelle satisfaite: 304 sans le moindre échange FTP
+  if (have_metadata) {
+    set_validators(head, ctx->remote_path, file_size, modified);
+    if (is_not_modified(ctx, head, modified)) {
+      success = send_not_modified(ctx->req, head);
+      response_done = true;
+      headers_sent = true;
+      goto end_transfer;
+    }
+  }
+
+  // Entrée validée récemment: servie directement depuis la mémoire, sans toucher au serveur FTP
+  if (cached_fresh) {
+    proxy->file_cache_.record_hit();
+    success = serve_cached_file(ctx, *cached);
+    response_done = true;
+    headers_sent = true;
+    goto end_transfer;
+  }
+
+  // Connexion de contrôle authentifiée issue du pool
+  if (!proxy->acquire_ftp_connection(conn)) {
+    ESP_LOGE(TAG, "Impossible d'obtenir une connexion FTP");
     goto end_transfer;
   }
 
-  // Connexion au serveur FTP - Utilisez une méthode statique ou accessible
-  // Note: Pour simplifier, je mets directement le code connect_to_ftp ici
+  // Métadonnées du fichier: SIZE pour Content-Length et les plages, MDTM pour Last-Modified.
+  // Les deux commandes partent ensemble, les réponses arrivent dans l'ordre.
+  if (!have_metadata) {
+    std::string commands = "SIZE " + ctx->remote_path + "\r\nMDTM " + ctx->remote_path + "\r\n";
+    if (!ftp_send(conn, commands.c_str())) {
+      goto end_transfer;
+    }
+    int code = ftp_read_reply(conn, buffer, buffer_size);
+    if (code == 213) {
+      file_size = strtoll(buffer + 4, nullptr, 10);
+    } else if (code > 0) {
+      ESP_LOGD(TAG, "SIZE non supporté pour %s, envoi en chunked", ctx->remote_path.c_str());
+    } else {
+      goto end_transfer;
+    }
+
+    code = ftp_read_reply(conn, buffer, buffer_size);
+    if (code < 0) {
+      goto end_transfer;
+    }
+    if (code != 213 || !parse_ftp_timestamp(buffer + 4, modified)) {
+      modified = 0;
+    }
+
+    if (file_size >= 0) {
+      proxy->store_metadata(ctx->remote_path, file_size, modified);
+    }
+    set_validators(head, ctx->remote_path, file_size, modified);
+
+    // Une seule paire SIZE/MDTM suffit pour répondre 304, sans RETR
+    if (is_not_modified(ctx, head, modified)) {
+      reusable = true;
+      success = send_not_modified(ctx->req, head);
+      response_done = true;
+      headers_sent = true;
+      goto end_transfer;
+    }
+  }
+
+  // Revalidation du cache par SIZE/MDTM: aucune connexion de données si le fichier n'a pas changé
+  if (cached) {
+    if (cached->size == file_size && cached->modified == modified) {
+      cached->validated = esp_timer_get_time();
+      proxy->file_cache_.record_hit();
+      reusable = true;
+      success = serve_cached_file(ctx, *cached);
+      response_done = true;
+      headers_sent = true;
+      goto end_transfer;
+    }
+    ESP_LOGD(TAG, "Entrée du cache obsolète: %s", ctx->remote_path.c_str());
+    proxy->file_cache_.remove(ctx->remote_path);
+    cached.reset();
+  }
+  if (proxy->file_cache_.enabled()) {
+    proxy->file_cache_.record_miss();
+  }
+
+  range = resolve_range(ctx, file_size, range_offset, range_length);
+  if (range == RANGE_UNSATISFIABLE) {
+    ESP_LOGW(TAG, "Plage non satisfaisable pour %s (taille %lld)", ctx->remote_path.c_str(), (long long) file_size);
+    send_range_not_satisfiable(ctx->req, head, file_size);
+    response_done = true;
+    success = true;
+    reusable = true;
+    goto end_transfer;
+  }
+
+  // Configuration des headers HTTP
+  set_content_type(head, ctx->remote_path);
+
+  // Gros fichier: segments lus en parallèle sur plusieurs sessions FTP, chacune avec son propre REST.
+  // Sans session supplémentaire disponible (pool plein, serveur qui refuse) on reste en flux unique.
+  if (file_size >= 0 && proxy->segment_connections_ > 1) {
+    int64_t segmented_offset = range == RANGE_OK ? range_offset : 0;
+    int64_t segmented_length = range_length >= 0 ? range_length : file_size - segmented_offset;
+    if (segmented_length >= (int64_t) proxy->segment_min_file_size_) {
+      std::vector<FTPControlConnection> lanes = {conn};
+      while ((int) lanes.size() < proxy->segment_connections_) {
+        FTPControlConnection lane;
+        if (!proxy->acquire_segment_lane(lane, lanes.size())) {
+          break;
+        }
+        lanes.push_back(lane);
+      }
+
+      SegmentedFetch fetch;
+      std::vector<FtpControl*> socks;
+      for (auto &lane : lanes) {
+        socks.push_back(&lane);
+      }
+      // Premiers segments ouverts avant l'envoi des en-têtes: une session qui refuse le transfert
+      // est écartée, et sous deux voies actives on se replie sur le flux unique
+      int64_t start_time = esp_timer_get_time();
+      size_t active_lanes = 0;
+      if (lanes.size() > 1 &&
+          fetch.init(lanes.size(), proxy->segment_size_, proxy->relay_use_psram_, proxy->connect_timeout_ms_)) {
+        active_lanes = fetch.start(socks, ctx->remote_path, segmented_offset, segmented_length);
+        if (active_lanes < 2) {
+          ESP_LOGW(TAG, "Segments refusés par le serveur, repli sur un flux unique");
+          fetch.cancel();
+        }
+      }
+      bool segmented = active_lanes >= 2;
+      std::vector<bool> released(lanes.size(), false);
+      if (segmented) {
+        // Sessions écartées: rendues au pool sans attendre la fin du transfert
+        for (size_t i = 1; i < lanes.size(); i++) {
+          if (!fetch.lane_active(i)) {
+            proxy->release_ftp_connection(lanes[i], fetch.lane_reusable(i));
+            released[i] = true;
+          }
+        }
+        ESP_LOGI(TAG, "Téléchargement segmenté de %s: %u sessions, segments de %u Ko", ctx->remote_path.c_str(),
+                 (unsigned) active_lanes, (unsigned) (proxy->segment_size_ / 1024));
+        if (range == RANGE_OK) {
+          set_partial_content(head, segmented_offset, segmented_offset + segmented_length - 1, file_size);
+        }
+        fixed_length = true;
+        body_length = segmented_length;
+        if (send_fixed_length_head(ctx->req, head, body_length)) {
+          headers_sent = true;
+          int64_t first_data_us = 0;
+          SegmentedResult fetched = fetch.run([&](const char* data, size_t len) {
+            if (first_data_us == 0) {
+              first_data_us = esp_timer_get_time();
+            }
+            if (!send_all(ctx->req, data, len)) {
+              return false;
+            }
+            proxy_metrics().bytes_relayed += len;
+            return true;
+          });
+          // Les sessions envoient REST/RETR dès start(): même mesure qu'en flux unique
+          if (first_data_us > 0) {
+            proxy_metrics().first_byte.record_us((uint32_t) (first_data_us - start_time));
+          }
+          success = fetched.success && (int64_t) fetched.bytes == body_length;
+          int64_t elapsed_ms = std::max<int64_t>((esp_timer_get_time() - start_time) / 1000, 1);
+          ESP_LOGI(TAG, "Téléchargement segmenté %s: %u Ko en %lld ms (%u Ko/s)", success ? "terminé" : "interrompu",
+                   (unsigned) (fetched.bytes / 1024), (long long) elapsed_ms,
+                   (unsigned) (fetched.bytes * 1000 / 1024 / elapsed_ms));
+        } else {
+          ESP_LOGE(TAG, "Échec d'envoi des en-têtes au client");
+          fetch.cancel();
+        }
+        reusable = fetch.lane_reusable(0);
+        conn = lanes[0];
+      }
+      // Flux unique: sur la première session restée saine après les segments refusés
+      size_t main_lane = 0;
+      if (!segmented) {
+        while (main_lane < lanes.size() && !fetch.lane_reusable(main_lane)) {
+          main_lane++;
+        }
+        if (main_lane == lanes.size()) {
+          ESP_LOGE(TAG, "Aucune session FTP utilisable pour %s", ctx->remote_path.c_str());
+          main_lane = 0;
+        }
+        conn = lanes[main_lane];
+        reusable = fetch.lane_reusable(main_lane);
+      }
+      // La session principale est rendue en fin de transfert; les autres dès maintenant
+      for (size_t i = 0; i < lanes.size(); i++) {
+        if (i != main_lane && !released[i]) {
+          proxy->release_ftp_connection(lanes[i], fetch.lane_reusable(i));
+        }
+      }
+      if (!segmented && !reusable) {
+        goto end_transfer;
+      }
+      if (segmented) {
+        response_done = true;
+        goto end_transfer;
+      }
+    }
+  }
+
+  // Canal de données en mode passif
+  data_sock = open_data_connection(conn, buffer, buffer_size, proxy->connect_timeout_ms_);
+  if (data_sock < 0) {
+    goto end_transfer;
+  }
+
+  // REST et RETR partent ensemble. Si REST est refusé, RETR part de l'octet 0: on sert le fichier complet.
   {
-    struct hostent *ftp_host = gethostbyname(ctx->ftp_server.c_str());
-    if (!ftp_host) {
-      ESP_LOGE(TAG, "Échec de la résolution DNS");
+    std::string commands = "RETR " + ctx->remote_path + "\r\n";
+    bool resume = range == RANGE_OK && range_offset > 0;
+    if (resume) {
+      commands = "REST " + std::to_string((long long) range_offset) + "\r\n" + commands;
+    }
+    retr_start = esp_timer_get_time();
+    if (!ftp_send(conn, commands.c_str())) {
+      ESP_LOGE(TAG, "Échec d'envoi de la commande RETR");
+      goto end_transfer;
+    }
+    if (resume) {
+      int code = ftp_read_reply(conn, buffer, buffer_size);
+      if (code < 0) {
+        goto end_transfer;
+      }
+      if (code != 350) {
+        ESP_LOGW(TAG, "REST refusé par le serveur, envoi du fichier complet");
+        range = RANGE_NONE;
+        range_offset = 0;
+        range_length = -1;
+      }
+    }
+
+    int code = ftp_read_reply(conn, buffer, buffer_size);
+    if (code < 0) {
+      ESP_LOGE(TAG, "Pas de réponse à la commande RETR");
       goto end_transfer;
     }
 
-    ftp_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (ftp_sock < 0) {
-      ESP_LOGE(TAG, "Échec de création du socket : %d", errno);
+    // Vérifier si le fichier existe
+    if (code != 150 && code != 125) {
+      ESP_LOGE(TAG, "Fichier non trouvé ou inaccessible: %s", buffer);
+      // La session de contrôle reste valide après un refus (ex: 550)
+      close(data_sock);
+      data_sock = -1;
+      reusable = code >= 400 && code != 421;
       goto end_transfer;
     }
+  }
+
+  if (range == RANGE_OK) {
+    set_partial_content(head, range_offset, range_length >= 0 ? range_offset + range_length - 1 : file_size - 1,
+                        file_size);
+  }
+
+  // Longueur du corps connue si SIZE a répondu (ou si la plage est entièrement bornée)
+  if (range_length >= 0) {
+    body_length = range_length;
+  } else if (file_size >= 0) {
+    body_length = file_size - range_offset;
+  }
+  fixed_length = body_length >= 0;
+
+  // Seuls les fichiers complets de taille connue, d'un type admis en cache, alimentent le cache
+  if (range == RANGE_NONE && file_size >= 0 && (head.mime_policy & MIME_CACHEABLE)) {
+    filling = proxy->file_cache_.create(ctx->remote_path, file_size, modified);
+  }
+
+  ESP_LOGI(TAG, "Téléchargement du fichier %s démarré", ctx->remote_path.c_str());
+
+  // Envoi des en-têtes: bruts avec Content-Length, ou délégués à httpd en mode chunked
+  if (fixed_length) {
+    std::string raw_head = format_fixed_length_head(head, body_length);
+    if (!send_all(ctx->req, raw_head.data(), raw_head.size())) {
+      ESP_LOGE(TAG, "Échec d'envoi des en-têtes au client");
+      goto end_transfer;
+    }
+    headers_sent = true;
+    // Les GET simultanés du même chemin et de la même plage se rattachent à ce transfert
+    if (proxy->coalescing_buffer_size_ > 0) {
+      group = proxy->open_flight(ctx, std::move(raw_head), range_offset, body_length);
+    }
+  } else {
+    apply_chunked_head(ctx->req, head);
+  }
+
+  // Boucle principale de transfert de données: lecture FTP et envoi HTTP se recouvrent
+  {
+    size_t total_bytes_transferred = 0;
+    size_t next_progress_log = 512 * 1024;
+
+    // Audio/vidéo: la lecture prend de l'avance pour absorber les pauses du serveur FTP et du Wi-Fi
+    bool read_ahead = proxy->read_ahead_size_ > 0 && (head.mime_policy & MIME_READ_AHEAD);
+
+    // Journalisation périodique pour suivre la progression
+    auto log_progress = [&]() {
+      if (total_bytes_transferred >= next_progress_log) { // Log tous les 512KB
+        ESP_LOGI(TAG, "Transfert en cours: %zu KB", total_bytes_transferred / 1024);
+        next_progress_log += 512 * 1024;
+      }
+    };
+
+    RelayResult relayed;
+#ifdef USE_HOST
+    // Corps brut de longueur connue, sans copie vers le cache ni lecture anticipée:
+    // splice() directement vers le socket du client
+    if (fixed_length && !filling && group == nullptr && !read_ahead) {
+      relayed = relay.run_to_socket(data_sock, httpd_req_to_sockfd(ctx->req), range_length, [&](size_t len) {
+        proxy_metrics().bytes_relayed += len;
+        total_bytes_transferred += len;
+        log_progress();
+      });
+      if (relayed.status == RELAY_SINK_ERROR) {
+        ESP_LOGE(TAG, "Échec d'envoi au client");
+      }
+    } else
+#endif
+    {
+      relayed = relay.run(data_sock, range_length, [&](const char* data, size_t len) {
+        if (!own_client_failed) {
+          bool sent = fixed_length ? send_all(ctx->req, data, len)
+                                   : httpd_resp_send_chunk(ctx->req, data, len) == ESP_OK;
+          if (sent) {
+            headers_sent = true;
+            proxy_metrics().bytes_relayed += len;
+          } else {
+            ESP_LOGE(TAG, "Échec d'envoi au client");
+            own_client_failed = true;
+            // Le flux continue tant que des clients rattachés le reçoivent
+            if (group == nullptr || group->client_count() == 0) {
+              return false;
+            }
+          }
+        }
+        if (group != nullptr) {
+          group->publish(data, len);
+        }
+        if (filling && total_bytes_transferred + len <= (size_t) filling->size) {
+          memcpy(filling->data + total_bytes_transferred, data, len);
+        }
+        total_bytes_transferred += len;
+        log_progress();
+        return true;
+      }, read_ahead);
+    }
+    if (relayed.first_data_us > 0) {
+      proxy_metrics().first_byte.record_us((uint32_t) (relayed.first_data_us - retr_start));
+    }
+
+    if (read_ahead && relayed.fill_samples > 0) {
+      uint32_t fill_percent = relayed.fill_sum * 100 / (relayed.fill_samples * relayed.window);
+      proxy->read_ahead_streams_++;
+      proxy->read_ahead_underruns_ += relayed.underruns;
+      proxy->read_ahead_fill_percent_ = fill_percent;
+      ESP_LOGI(TAG, "Lecture anticipée: %u sous-alimentations, remplissage moyen %u%% de %u buffers",
+               (unsigned) relayed.underruns, (unsigned) fill_percent, (unsigned) relayed.window);
+    }
+    
+    // Vérifier que le transfert s'est bien terminé
+    close(data_sock);
+    data_sock = -1;
+    
+    if (relayed.status == RELAY_LIMIT) {
+      // Fermeture anticipée du canal de données: le serveur répond 426/451 (ou 226 s'il avait
+      // déjà tout envoyé), parfois les deux. Un NOOP marque la fin de ces réponses.
+      reusable = ftp_resync(conn);
+      ESP_LOGI(TAG, "Plage transférée: %zu octets à partir de %lld",
+               total_bytes_transferred, (long long) range_offset);
+      success = true;
+    } else if (relayed.status == RELAY_EOF) {
+      // Attendre la confirmation du transfert complet
+      int code = ftp_read_reply(conn, buffer, buffer_size);
+      if (code > 0) {
+        if (code == 226 || code == 250) {
+          ESP_LOGI(TAG, "Transfert terminé avec succès: %zu KB (%zu MB)", 
+                  total_bytes_transferred / 1024,
+                  total_bytes_transferred / (1024 * 1024));
+          success = true;
+          reusable = true;
+        } else {
+          ESP_LOGW(TAG, "Fin de transfert incomplète ou inattendue: %s", buffer);
+        }
+      } else {
+        ESP_LOGW(TAG, "Pas de réponse de confirmation du transfert");
+      }
+    }
+
+    // Le fichier a changé de taille entre SIZE et RETR: Content-Length annoncé est faux
+    if (success && fixed_length && (int64_t) total_bytes_transferred != body_length) {
+      ESP_LOGW(TAG, "Taille reçue (%zu) différente du Content-Length annoncé (%lld)",
+               total_bytes_transferred, (long long) body_length);
+      proxy->invalidate_metadata(ctx->remote_path);
+      success = false;
+    }
+
+    group_complete = (relayed.status == RELAY_EOF || relayed.status == RELAY_LIMIT) &&
+                     (int64_t) total_bytes_transferred == body_length;
+    if (own_client_failed) {
+      success = false;
+    }
+
+    if (success && filling && (int64_t) total_bytes_transferred == filling->size) {
+      filling->validated = esp_timer_get_time();
+      proxy->file_cache_.insert(std::move(filling));
+      ESP_LOGD(TAG, "Cache: %u succès / %u échecs", proxy->file_cache_.hits(), proxy->file_cache_.misses());
+    }
+  }
+
+end_transfer:
+  // Nettoyage des ressources
+  if (data_sock != -1) close(data_sock);
+  // Rendre la connexion de contrôle au pool (ou la fermer si son état est incertain)
+  if (conn.sock != -1) {
+    proxy->release_ftp_connection(conn, reusable);
+  }
+  // Session FTP rendue: les clients rattachés reçoivent la fin de l'anneau
+  if (group != nullptr) {
+    proxy->close_flight(group, group_complete);
+  }
+  
+  // Terminer la réponse HTTP
+  if (!success) {
+    if (headers_sent) {
+      // Statut déjà envoyé: couper la connexion pour que le client détecte la troncature
+      httpd_sess_trigger_close(ctx->req->handle, httpd_req_to_sockfd(ctx->req));
+    } else {
+      uint32_t unavailable_ms = proxy->ftp_unavailable_for_ms();
+      if (unavailable_ms > 0) {
+        send_service_unavailable(ctx->req, unavailable_ms / 1000, "Serveur FTP injoignable");
+      } else {
+        httpd_resp_send_err(ctx->req, HTTPD_500_INTERNAL_SERVER_ERROR, "Erreur de transfert de fichier");
+      }
+    }
+  } else if (!response_done && !fixed_length) {
+    // Fin du chunk pour terminer la réponse
+    httpd_resp_send_chunk(ctx->req, NULL, 0);
+  }
+}
+
+// Clé d'un téléchargement partagé: même chemin et même en-tête Range
+static std::string flight_key(const FileTransferContext* ctx) {
+  std::string key = ctx->remote_path;
+  if (ctx->has_range) {
+    key += '\n';
+    key += std::to_string((long long) ctx->range_start);
+    key += '-';
+    key += std::to_string((long long) ctx->range_end);
+  }
+  return key;
+}
+
+bool FTPHTTPProxy::join_flight(FileTransferContext *ctx) {
+  // Une requête conditionnelle peut se conclure par un 304: elle suit son propre chemin
+  if (coalescing_buffer_size_ == 0 || !ctx->if_none_match.empty() || ctx->if_modified_since != 0) {
+    return false;
+  }
+  std::string key = flight_key(ctx);
+  bool joined = false;
+  xSemaphoreTake(flights_mutex_, portMAX_DELAY);
+  for (auto *group : flights_) {
+    if (group->key() == key && group->attach(ctx, httpd_req_to_sockfd(ctx->req))) {
+      joined = true;
+      break;
+    }
+  }
+  xSemaphoreGive(flights_mutex_);
+  if (joined) {
+    proxy_metrics().coalesced_requests++;
+    ESP_LOGI(TAG, "Requête rattachée au téléchargement en cours de %s", ctx->remote_path.c_str());
+  }
+  return joined;
+}
+
+FanOutGroup *FTPHTTPProxy::open_flight(FileTransferContext *ctx, std::string head, int64_t body_offset,
+                                       int64_t body_length) {
+  bool psram = relay_use_psram_ && heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0;
+  char *ring = (char *) heap_caps_malloc(coalescing_buffer_size_,
+                                         psram ? MALLOC_CAP_SPIRAM : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  if (ring == nullptr) {
+    ESP_LOGW(TAG, "Mémoire insuffisante pour partager le téléchargement de %s", ctx->remote_path.c_str());
+    return nullptr;
+  }
+  auto *group = new (std::nothrow) FanOutGroup(
+      flight_key(ctx), std::move(head), ring, coalescing_buffer_size_,
+      [this, body_offset, body_length](FileTransferContext *follower, FanOutOutcome outcome, int64_t sent) {
+        finish_follower(follower, outcome, sent, body_offset, body_length);
+      });
+  if (group == nullptr) {
+    heap_caps_free(ring);
+    return nullptr;
+  }
+  xSemaphoreTake(flights_mutex_, portMAX_DELAY);
+  flights_.push_back(group);
+  xSemaphoreGive(flights_mutex_);
+  return group;
+}
+
+void FTPHTTPProxy::close_flight(FanOutGroup *group, bool complete) {
+  // Retiré du registre d'abord: plus aucun rattachement possible pendant la vidange
+  xSemaphoreTake(flights_mutex_, portMAX_DELAY);
+  flights_.erase(std::remove(flights_.begin(), flights_.end(), group), flights_.end());
+  xSemaphoreGive(flights_mutex_);
+  group->finish(complete, 10000);
+  delete group;
+}
+
+void FTPHTTPProxy::finish_follower(FileTransferContext *ctx, FanOutOutcome outcome, int64_t sent,
+                                   int64_t body_offset, int64_t body_length) {
+  proxy_metrics().bytes_relayed += sent;
+  if (outcome == FAN_OUT_DETACHED) {
+    // Le client reprend là où il en est, sur sa propre session FTP
+    proxy_metrics().coalesce_detached++;
+    ctx->resume_offset = body_offset + sent;
+    ctx->resume_length = body_length - sent;
+    if (xQueueSend(job_queue_, &ctx, 0) == pdTRUE) {
+      return;
+    }
+    ESP_LOGW(TAG, "File de transferts pleine, client détaché abandonné: %s", ctx->remote_path.c_str());
+    outcome = FAN_OUT_FAILED;
+  }
+  if (outcome == FAN_OUT_FAILED) {
+    httpd_sess_trigger_close(ctx->req->handle, httpd_req_to_sockfd(ctx->req));
+  }
+  httpd_req_async_handler_complete(ctx->req);
+  delete ctx;
+}
+
+/* Suite du corps pour un client détaché d'un téléchargement partagé: les en-têtes sont partis,
+ * seuls les octets manquants sont relayés (REST obligatoire, sinon la connexion est coupée) */
+void FTPHTTPProxy::resume_transfer_task(FileTransferContext* ctx, RelayEngine &relay) {
+  FTPHTTPProxy* proxy = ctx->proxy;
+  FTPControlConnection conn;
+  int data_sock = -1;
+  bool success = false;
+  bool reusable = false;
+  char buffer[512];
+  std::string commands;
+  RelayResult relayed;
+
+  ESP_LOGI(TAG, "Reprise de %s à l'octet %lld (%lld octets)", ctx->remote_path.c_str(),
+           (long long) ctx->resume_offset, (long long) ctx->resume_length);
+  if (ctx->resume_length == 0) {
+    success = true;
+    goto end_resume;
+  }
+  if (!proxy->acquire_ftp_connection(conn)) {
+    goto end_resume;
+  }
+  data_sock = open_data_connection(conn, buffer, sizeof(buffer), proxy->connect_timeout_ms_);
+  if (data_sock < 0) {
+    goto end_resume;
+  }
 
-    // Configuration du socket pour être plus robuste
-    int flag = 1;
-    setsockopt(ftp_sock, SOL_SOCKET, SO_KEEPALIVE, &flag, sizeof(flag));
-    
-    // Augmenter la taille du buffer de réception
-    int rcvbuf = 16384;
-    setsockopt(ftp_sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
-
-    // Timeout pour les opérations socket
-    struct timeval timeout = {.tv_sec = 10, .tv_usec = 0};
-    setsockopt(ftp_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-    setsockopt(ftp_sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
-
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(21);
-    server_addr.sin_addr.s_addr = *((unsigned long *)ftp_host->h_addr);
-
-    if (connect(ftp_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) != 0) {
-      ESP_LOGE(TAG, "Échec de connexion FTP : %d", errno);
-      goto end_transfer;
+  commands = "REST " + std::to_string((long long) ctx->resume_offset) + "\r\nRETR " + ctx->remote_path + "\r\n";
+  if (!ftp_send(conn, commands.c_str())) {
+    goto end_resume;
+  }
+  if (ftp_read_reply(conn, buffer, sizeof(buffer)) != 350) {
+    // RETR part quand même depuis l'octet 0: session abandonnée
+    ESP_LOGW(TAG, "REST refusé, reprise impossible: %s", buffer);
+    goto end_resume;
+  }
+  {
+    int code = ftp_read_reply(conn, buffer, sizeof(buffer));
+    if (code != 150 && code != 125) {
+      ESP_LOGE(TAG, "Fichier non trouvé ou inaccessible: %s", buffer);
+      reusable = code >= 400 && code != 421;
+      goto end_resume;
     }
+  }
 
-    bytes_received = recv(ftp_sock, buffer, buffer_size - 1, 0);
-    if (bytes_received <= 0 || !strstr(buffer, "220 ")) {
-      ESP_LOGE(TAG, "Message de bienvenue FTP non reçu");
-      goto end_transfer;
+#ifdef USE_HOST
+  relayed = relay.run_to_socket(data_sock, httpd_req_to_sockfd(ctx->req), ctx->resume_length,
+                                [](size_t len) { proxy_metrics().bytes_relayed += len; });
+#else
+  relayed = relay.run(data_sock, ctx->resume_length, [&](const char* data, size_t len) {
+    if (!send_all(ctx->req, data, len)) {
+      return false;
     }
-    buffer[bytes_received] = '\0';
+    proxy_metrics().bytes_relayed += len;
+    return true;
+  });
+#endif
+  close(data_sock);
+  data_sock = -1;
+  success = (int64_t) relayed.bytes == ctx->resume_length &&
+            (relayed.status == RELAY_LIMIT || relayed.status == RELAY_EOF);
+  if (relayed.status == RELAY_LIMIT) {
+    reusable = ftp_resync(conn);
+  } else if (relayed.status == RELAY_EOF) {
+    int code = ftp_read_reply(conn, buffer, sizeof(buffer));
+    reusable = code == 226 || code == 250;
+  }
 
-    // Authentification
-    snprintf(buffer, buffer_size, "USER %s\r\n", ctx->username.c_str());
-    send(ftp_sock, buffer, strlen(buffer), 0);
-    bytes_received = recv(ftp_sock, buffer, buffer_size - 1, 0);
-    if (bytes_received <= 0) {
-      ESP_LOGE(TAG, "Échec de réception après USER");
-      goto end_transfer;
-    }
-    buffer[bytes_received] = '\0';
+end_resume:
+  if (data_sock != -1) close(data_sock);
+  if (conn.sock != -1) {
+    proxy->release_ftp_connection(conn, reusable);
+  }
+  // Statut déjà envoyé: seule la fermeture signale la troncature au client
+  if (!success) {
+    httpd_sess_trigger_close(ctx->req->handle, httpd_req_to_sockfd(ctx->req));
+  }
+}
 
-    snprintf(buffer, buffer_size, "PASS %s\r\n", ctx->password.c_str());
-    send(ftp_sock, buffer, strlen(buffer), 0);
-    bytes_received = recv(ftp_sock, buffer, buffer_size - 1, 0);
-    if (bytes_received <= 0) {
-      ESP_LOGE(TAG, "Échec de réception après PASS");
-      goto end_transfer;
-    }
-    buffer[bytes_received] = '\0';
-    if (!strstr(buffer, "230 ")) {
-      ESP_LOGE(TAG, "Authentification FTP échouée: %s", buffer);
-      goto end_transfer;
+// Échappe une chaîne pour l'insérer dans un littéral JSON
+static void append_json_string(std::string &out, const std::string &value) {
+  out += '"';
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += (char) c;
+    } else if (c < 0x20) {
+      char esc[8];
+      snprintf(esc, sizeof(esc), "\\u%04x", c);
+      out += esc;
+    } else {
+      out += (char) c;
     }
+  }
+  out += '"';
+}
 
-    // Mode binaire
-    send(ftp_sock, "TYPE I\r\n", 8, 0);
-    bytes_received = recv(ftp_sock, buffer, buffer_size - 1, 0);
-    if (bytes_received <= 0) {
-      ESP_LOGE(TAG, "Échec de réception après TYPE I");
-      goto end_transfer;
+// Décode les séquences %XX et '+' d'un paramètre de requête ('+' reste littéral dans un chemin)
+static std::string url_decode(const char* value, bool plus_as_space = true) {
+  std::string out;
+  for (const char* p = value; *p; p++) {
+    if (*p == '%' && isxdigit((unsigned char) p[1]) && isxdigit((unsigned char) p[2])) {
+      char hex[3] = {p[1], p[2], '\0'};
+      out += (char) strtol(hex, nullptr, 16);
+      p += 2;
+    } else if (*p == '+' && plus_as_space) {
+      out += ' ';
+    } else {
+      out += *p;
     }
-    buffer[bytes_received] = '\0';
   }
+  return out;
+}
 
-  // Configuration des headers HTTP
-  {
-    std::string extension = "";
-    size_t dot_pos = ctx->remote_path.find_last_of('.');
-    if (dot_pos != std::string::npos) {
-      extension = ctx->remote_path.substr(dot_pos);
-      std::transform(extension.begin(), extension.end(), extension.begin(), 
-                     [](unsigned char c){ return std::tolower(c); });
-    }
-
-    // Configuration du type MIME
-    if (extension == ".mp3") {
-      httpd_resp_set_type(ctx->req, "audio/mpeg");
-    } else if (extension == ".wav") {
-      httpd_resp_set_type(ctx->req, "audio/wav");
-    } else if (extension == ".ogg") {
-      httpd_resp_set_type(ctx->req, "audio/ogg");
-    } else if (extension == ".mp4") {
-      httpd_resp_set_type(ctx->req, "video/mp4");
-    } else if (extension == ".pdf") {
-      httpd_resp_set_type(ctx->req, "application/pdf");
-    } else if (extension == ".jpg" || extension == ".jpeg") {
-      httpd_resp_set_type(ctx->req, "image/jpeg");
-    } else if (extension == ".png") {
-      httpd_resp_set_type(ctx->req, "image/png");
-    } else if (extension == ".ico") {
-      httpd_resp_set_type(ctx->req, "image/x-icon");
-    } else {
-      // Type par défaut pour les fichiers inconnus
-      httpd_resp_set_type(ctx->req, "application/octet-stream");
-      
-      // Extraire le nom du fichier pour Content-Disposition
-      std::string filename = ctx->remote_path;
-      size_t slash_pos = ctx->remote_path.find_last_of('/');
-      if (slash_pos != std::string::npos) {
-        filename = ctx->remote_path.substr(slash_pos + 1);
-      }
-      
-      std::string header = "attachment; filename=\"" + filename + "\"";
-      httpd_resp_set_hdr(ctx->req, "Content-Disposition", header.c_str());
+// Chemin désigné par l'URI d'un téléchargement ou d'un envoi: sans la requête ni le '/' initial,
+// décodé. false si un caractère de contrôle décodé s'insérerait dans les commandes FTP.
+static bool request_path(const char* uri, std::string &path) {
+  std::string raw = uri;
+  size_t query = raw.find('?');
+  if (query != std::string::npos) {
+    raw.erase(query);
+  }
+  path = url_decode(raw.c_str() + (raw.empty() || raw[0] != '/' ? 0 : 1), false);
+  for (unsigned char c : path) {
+    if (c < 0x20 || c == 0x7f) {
+      return false;
     }
-    
-    // En-têtes pour permettre la mise en cache et les requêtes par plage
-    httpd_resp_set_hdr(ctx->req, "Accept-Ranges", "bytes");
   }
+  return true;
+}
 
-  // Mode passif
-  send(ftp_sock, "PASV\r\n", 6, 0);
-  bytes_received = recv(ftp_sock, buffer, buffer_size - 1, 0);
-  if (bytes_received <= 0 || !strstr(buffer, "227 ")) {
-    ESP_LOGE(TAG, "Erreur en mode passif");
-    goto end_transfer;
+bool FTPHTTPProxy::fetch_ftp_directory(const std::string &remote_dir, std::vector<DirEntry> &entries) {
+  FTPControlConnection conn;
+  if (!acquire_ftp_connection(conn)) {
+    ESP_LOGE(TAG, "Impossible d'obtenir une connexion FTP pour le listing");
+    return false;
   }
-  buffer[bytes_received] = '\0';
 
-  // Analyse de la réponse PASV
-  {
-    char *pasv_start = strchr(buffer, '(');
-    if (!pasv_start) {
-      ESP_LOGE(TAG, "Format PASV incorrect");
-      goto end_transfer;
+  char buffer[1024];
+  bool success = false;
+  bool reusable = false;
+
+  // MLSD d'abord (faits normalisés), LIST si le serveur ne le connaît pas
+  for (bool mlsd : {true, false}) {
+    int data_sock = open_data_connection(conn, buffer, sizeof(buffer), connect_timeout_ms_);
+    if (data_sock < 0) {
+      break;
     }
-    
-    int ip[4], port[2];
-    if (sscanf(pasv_start, "(%d,%d,%d,%d,%d,%d)", &ip[0], &ip[1], &ip[2], &ip[3], &port[0], &port[1]) != 6) {
-      ESP_LOGE(TAG, "Impossible de parser la réponse PASV");
-      goto end_transfer;
+
+    std::string cmd = mlsd ? "MLSD" : "LIST";
+    if (!remote_dir.empty()) {
+      cmd += " " + remote_dir;
     }
-    int data_port = port[0] * 256 + port[1];
-    
-    // Connexion au port de données
-    data_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (data_sock < 0) {
-      ESP_LOGE(TAG, "Échec de création du socket de données");
-      goto end_transfer;
+    cmd += "\r\n";
+    int code = ftp_command(conn, cmd.c_str(), buffer, sizeof(buffer));
+    if (code != 150 && code != 125) {
+      close(data_sock);
+      reusable = code > 0 && code != 421;
+      // 500/502/504: commande inconnue, on retente avec LIST
+      if (mlsd && (code == 500 || code == 502 || code == 504)) {
+        ESP_LOGD(TAG, "MLSD non supporté, repli sur LIST");
+        continue;
+      }
+      ESP_LOGE(TAG, "Listing de '%s' refusé: %s", remote_dir.c_str(), buffer);
+      break;
     }
-    
-    int flag = 1;
-    setsockopt(data_sock, SOL_SOCKET, SO_KEEPALIVE, &flag, sizeof(flag));
-    
-    int rcvbuf = 32768;
-    setsockopt(data_sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
-    
-    struct timeval data_timeout = {.tv_sec = 10, .tv_usec = 0};
-    setsockopt(data_sock, SOL_SOCKET, SO_RCVTIMEO, &data_timeout, sizeof(data_timeout));
-    
-    struct sockaddr_in data_addr;
-    memset(&data_addr, 0, sizeof(data_addr));
-    data_addr.sin_family = AF_INET;
-    data_addr.sin_port = htons(data_port);
-    // Construire l'adresse correctement avec htonl
-    data_addr.sin_addr.s_addr = (ip[0] << 24) | (ip[1] << 16) | (ip[2] << 8) | ip[3];
-    
-    if (connect(data_sock, (struct sockaddr *)&data_addr, sizeof(data_addr)) != 0) {
-      ESP_LOGE(TAG, "Échec de connexion au port de données: %d", errno);
-      goto end_transfer;
+
+    ListingParser parser(mlsd);
+    char chunk[1024];
+    int received;
+    while ((received = recv(data_sock, chunk, sizeof(chunk), 0)) > 0) {
+      parser.feed(chunk, received);
+    }
+    parser.finish();
+    close(data_sock);
+
+    code = ftp_command(conn, nullptr, buffer, sizeof(buffer));
+    if (received == 0 && (code == 226 || code == 250)) {
+      entries = std::move(parser.entries());
+      success = true;
+      reusable = true;
+      ESP_LOGI(TAG, "Listing de '%s' via %s: %u entrées", remote_dir.empty() ? "/" : remote_dir.c_str(),
+               mlsd ? "MLSD" : "LIST", (unsigned) entries.size());
+    } else {
+      ESP_LOGE(TAG, "Listing de '%s' incomplet: %s", remote_dir.c_str(), buffer);
     }
+    break;
   }
 
-  // Envoyer la commande RETR pour récupérer le fichier
-  snprintf(buffer, buffer_size, "RETR %s\r\n", ctx->remote_path.c_str());
-  send(ftp_sock, buffer, strlen(buffer), 0);
+  release_ftp_connection(conn, reusable);
+  return success;
+}
 
-  bytes_received = recv(ftp_sock, buffer, buffer_size - 1, 0);
-  if (bytes_received <= 0) {
-    ESP_LOGE(TAG, "Pas de réponse à la commande RETR");
-    goto end_transfer;
+std::shared_ptr<const std::vector<DirEntry>> FTPHTTPProxy::lookup_dir_cache(const std::string &remote_dir) {
+  std::shared_ptr<const std::vector<DirEntry>> entries;
+  if (listing_cache_ttl_ms_ == 0) {
+    return entries;
   }
-  buffer[bytes_received] = '\0';
-  
-  // Vérifier si le fichier existe
-  if (!strstr(buffer, "150 ") && !strstr(buffer, "125 ")) {
-    ESP_LOGE(TAG, "Fichier non trouvé ou inaccessible: %s", buffer);
-    goto end_transfer;
+  int64_t now = esp_timer_get_time();
+  xSemaphoreTake(dir_cache_mutex_, portMAX_DELAY);
+  auto it = dir_cache_.find(remote_dir);
+  if (it != dir_cache_.end() && (now - it->second.fetched) / 1000 < listing_cache_ttl_ms_) {
+    entries = it->second.entries;
   }
-  
-  ESP_LOGI(TAG, "Téléchargement du fichier %s démarré", ctx->remote_path.c_str());
+  xSemaphoreGive(dir_cache_mutex_);
+  return entries;
+}
 
-  // Boucle principale de transfert de données
-  {
-    size_t total_bytes_transferred = 0;
-    bool data_transfer_error = false;
-    
-    while (true) {
-      bytes_received = recv(data_sock, buffer, buffer_size, 0);
-      if (bytes_received <= 0) {
-        if (bytes_received < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-          ESP_LOGE(TAG, "Erreur de réception des données: %d", errno);
-          data_transfer_error = true;
-        }
-        break;
-      }
-      
-      // Mise à jour du total transféré
-      total_bytes_transferred += bytes_received;
-      
-      // Envoi du chunk au client HTTP
-      esp_err_t err = httpd_resp_send_chunk(ctx->req, buffer, bytes_received);
-      if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Échec d'envoi au client: %d", err);
-        data_transfer_error = true;
-        break;
-      }
-      
-      // Journalisation périodique pour suivre la progression
-      if (total_bytes_transferred % (512 * 1024) == 0) { // Log tous les 512KB
-        ESP_LOGI(TAG, "Transfert en cours: %zu KB", total_bytes_transferred / 1024);
-      }
-      
-      // Yield pour permettre à d'autres tâches de s'exécuter
-      vTaskDelay(pdMS_TO_TICKS(1));
-    }
-    
-    // Vérifier que le transfert s'est bien terminé
-    if (data_sock != -1) {
-      close(data_sock);
-      data_sock = -1;
-    }
-    
-    if (!data_transfer_error) {
-      // Attendre la confirmation du transfert complet
-      bytes_received = recv(ftp_sock, buffer, buffer_size - 1, 0);
-      if (bytes_received > 0) {
-        buffer[bytes_received] = '\0';
-        if (strstr(buffer, "226 ")) {
-          ESP_LOGI(TAG, "Transfert terminé avec succès: %zu KB (%zu MB)", 
-                  total_bytes_transferred / 1024,
-                  total_bytes_transferred / (1024 * 1024));
-          success = true;
-        } else {
-          ESP_LOGW(TAG, "Fin de transfert incomplète ou inattendue: %s", buffer);
-        }
-      } else {
-        ESP_LOGW(TAG, "Pas de réponse de confirmation du transfert");
+void FTPHTTPProxy::store_dir_cache(const std::string &remote_dir, std::shared_ptr<const std::vector<DirEntry>> entries) {
+  if (listing_cache_ttl_ms_ == 0) {
+    return;
+  }
+  xSemaphoreTake(dir_cache_mutex_, portMAX_DELAY);
+  // Borne le nombre de répertoires gardés: on retire le plus ancien
+  if (dir_cache_.size() >= MAX_CACHED_DIRS && dir_cache_.find(remote_dir) == dir_cache_.end()) {
+    auto oldest = dir_cache_.begin();
+    for (auto it = dir_cache_.begin(); it != dir_cache_.end(); ++it) {
+      if (it->second.fetched < oldest->second.fetched) {
+        oldest = it;
       }
     }
+    dir_cache_.erase(oldest);
   }
+  dir_cache_[remote_dir] = DirCacheEntry{esp_timer_get_time(), std::move(entries)};
+  xSemaphoreGive(dir_cache_mutex_);
+}
 
-end_transfer:
-  // Nettoyage des ressources
-  if (buffer) {
-    if (has_psram) {
-      heap_caps_free(buffer);
-    } else {
-      free(buffer);
+void FTPHTTPProxy::invalidate_dir_cache(const std::string &remote_dir) {
+  xSemaphoreTake(dir_cache_mutex_, portMAX_DELAY);
+  dir_cache_.erase(remote_dir);
+  xSemaphoreGive(dir_cache_mutex_);
+}
+
+bool FTPHTTPProxy::list_ftp_directory(const std::string &remote_dir, httpd_req_t *req) {
+  std::shared_ptr<const std::vector<DirEntry>> entries = lookup_dir_cache(remote_dir);
+  if (entries) {
+    ESP_LOGD(TAG, "Listing de '%s' servi depuis le cache", remote_dir.c_str());
+  } else {
+    auto fetched = std::make_shared<std::vector<DirEntry>>();
+    if (!fetch_ftp_directory(remote_dir, *fetched)) {
+      return false;
     }
+    entries = fetched;
+    store_dir_cache(remote_dir, entries);
   }
-  
-  if (data_sock != -1) close(data_sock);
-  if (ftp_sock != -1) {
-    send(ftp_sock, "QUIT\r\n", 6, 0);
-    close(ftp_sock);
-  }
-  
-  // Terminer la réponse HTTP
-  if (!success) {
-    httpd_resp_send_err(ctx->req, HTTPD_500_INTERNAL_SERVER_ERROR, "Erreur de transfert de fichier");
-  } else {
-    // Fin du chunk pour terminer la réponse
-    httpd_resp_send_chunk(ctx->req, NULL, 0);
+
+  // Le JSON est envoyé par morceaux au fil des entrées, jamais construit en entier
+  httpd_resp_set_type(req, "application/json");
+  std::string out;
+  out.reserve(1024);
+  out += '[';
+  bool first = true;
+  for (const auto &entry : *entries) {
+    std::string path = remote_dir.empty() ? entry.name : remote_dir + "/" + entry.name;
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+    out += "{\"name\":";
+    append_json_string(out, entry.name);
+    out += ",\"path\":";
+    append_json_string(out, path);
+    out += entry.is_dir ? ",\"type\":\"directory\"" : ",\"type\":\"file\"";
+    out += ",\"size\":";
+    out += std::to_string(entry.size);
+    out += ",\"modified\":";
+    out += std::to_string((long long) entry.modified);
+    out += ",\"shareable\":";
+    out += (!entry.is_dir && is_shareable(path)) ? "true}" : "false}";
+
+    if (out.size() >= 768) {
+      if (httpd_resp_send_chunk(req, out.data(), out.size()) != ESP_OK) {
+        return true;  // Client parti: la réponse a déjà commencé
+      }
+      out.clear();
+    }
   }
-  
-  // Libérer la mémoire du contexte
-  delete ctx;
-  
-  // Supprimer cette tâche
-  vTaskDelete(NULL);
+  out += ']';
+  httpd_resp_send_chunk(req, out.data(), out.size());
+  httpd_resp_send_chunk(req, NULL, 0);
+  return true;
 }
+
 esp_err_t FTPHTTPProxy::file_list_handler(httpd_req_t *req) {
   auto *proxy = (FTPHTTPProxy *)req->user_ctx;
   
@@ -674,19 +1747,28 @@ esp_err_t FTPHTTPProxy::file_list_handler(httpd_req_t *req) {
   
   if (query_len > 1) {
     query = (char*)malloc(query_len);
-    if (httpd_req_get_url_query_str(req, query, query_len) == ESP_OK) {
-      char param[32];
+    if (query && httpd_req_get_url_query_str(req, query, query_len) == ESP_OK) {
+      char param[256];
       if (httpd_query_key_value(query, "dir", param, sizeof(param)) == ESP_OK) {
-        dir_path = param;
+        dir_path = url_decode(param);
       }
     }
     free(query);
   }
+  // Chemin relatif au répertoire de connexion, sans '/' final
+  while (!dir_path.empty() && dir_path.back() == '/') {
+    dir_path.pop_back();
+  }
   
   ESP_LOGI(TAG, "Requête de liste de fichiers pour le répertoire: %s", 
           dir_path.empty() ? "racine" : dir_path.c_str());
   
   if (!proxy->list_ftp_directory(dir_path, req)) {
+    uint32_t unavailable_ms = proxy->ftp_unavailable_for_ms();
+    if (unavailable_ms > 0) {
+      send_service_unavailable(req, unavailable_ms / 1000, "Serveur FTP injoignable");
+      return ESP_OK;
+    }
     httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Échec de la récupération de la liste de fichiers");
     return ESP_FAIL;
   }
@@ -694,11 +1776,68 @@ esp_err_t FTPHTTPProxy::file_list_handler(httpd_req_t *req) {
   return ESP_OK;
 }
 
+// Extraction minimale d'un champ d'un objet JSON plat (corps des requêtes de l'interface)
+static const char* json_find_value(const char* json, const char* key) {
+  std::string pattern = std::string("\"") + key + "\"";
+  const char* p = strstr(json, pattern.c_str());
+  if (p == nullptr) {
+    return nullptr;
+  }
+  p += pattern.size();
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+  if (*p != ':') {
+    return nullptr;
+  }
+  p++;
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+  return p;
+}
+
+static bool json_get_string(const char* json, const char* key, std::string &out) {
+  const char* p = json_find_value(json, key);
+  if (p == nullptr || *p != '"') {
+    return false;
+  }
+  out.clear();
+  for (p++; *p && *p != '"'; p++) {
+    if (*p == '\\' && p[1]) {
+      p++;
+    }
+    out += *p;
+  }
+  return *p == '"';
+}
+
+static bool json_get_bool(const char* json, const char* key, bool &out) {
+  const char* p = json_find_value(json, key);
+  if (p == nullptr) {
+    return false;
+  }
+  if (strncmp(p, "true", 4) == 0) {
+    out = true;
+    return true;
+  }
+  if (strncmp(p, "false", 5) == 0) {
+    out = false;
+    return true;
+  }
+  return false;
+}
+
+static bool json_get_int(const char* json, const char* key, int &out) {
+  const char* p = json_find_value(json, key);
+  if (p == nullptr || (!isdigit((unsigned char) *p) && *p != '-')) {
+    return false;
+  }
+  out = atoi(p);
+  return true;
+}
+
 esp_err_t FTPHTTPProxy::toggle_shareable_handler(httpd_req_t *req) {
   auto *proxy = (FTPHTTPProxy *)req->user_ctx;
   
-  // Get the request body (path to toggle)
-  char buf[100];
+  // Corps: {"path": "...", "shareable": true|false}
+  char buf[512];
   int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
   if (ret <= 0) {
     httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty request");
@@ -706,23 +1845,21 @@ esp_err_t FTPHTTPProxy::toggle_shareable_handler(httpd_req_t *req) {
   }
   buf[ret] = '\0';
   
-  std::string path = buf;
-  // Find the file in proxy->ftp_files_ and toggle its shareable flag
-  bool found = false;
-  for (auto &file : proxy->ftp_files_) {
-    if (file.path == path) {
-      file.shareable = !file.shareable;
-      found = true;
-      break;
-    }
+  std::string path;
+  if (!json_get_string(buf, "path", path) || path.empty()) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing path");
+    return ESP_FAIL;
+  }
+  // Sans valeur explicite, on inverse l'état courant
+  bool shareable;
+  if (!json_get_bool(buf, "shareable", shareable)) {
+    shareable = !proxy->is_shareable(path);
   }
+  proxy->set_shareable(path, shareable);
   
   httpd_resp_set_type(req, "application/json");
-  if (found) {
-    httpd_resp_send(req, "{\"success\": true}", 16);
-  } else {
-    httpd_resp_send(req, "{\"success\": false}", 17);
-  }
+  httpd_resp_sendstr(req, shareable ? "{\"success\": true, \"shareable\": true}"
+                                    : "{\"success\": true, \"shareable\": false}");
   
   return ESP_OK;
 }
@@ -730,8 +1867,8 @@ esp_err_t FTPHTTPProxy::toggle_shareable_handler(httpd_req_t *req) {
 esp_err_t FTPHTTPProxy::share_create_handler(httpd_req_t *req) {
   auto *proxy = (FTPHTTPProxy *)req->user_ctx;
   
-  // Get request body (path and expiry)
-  char buf[100];
+  // Corps: {"path": "...", "expiry": heures}
+  char buf[512];
   int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
   if (ret <= 0) {
     httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty request");
@@ -739,27 +1876,26 @@ esp_err_t FTPHTTPProxy::share_create_handler(httpd_req_t *req) {
   }
   buf[ret] = '\0';
   
-  // Parse JSON (in a real implementation, use a proper JSON parser)
-  std::string path = buf; // Simplified - extract path from json
-  int expiry_hours = 24;  // Default 24 hours - extract from json
-  
-  // Generate a random token
-  std::string token = ""; // Generate a random token
-  for (int i = 0; i < 8; i++) {
-    token += 'a' + (esp_random() % 26);
+  std::string path;
+  if (!json_get_string(buf, "path", path) || path.empty()) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing path");
+    return ESP_FAIL;
+  }
+  int expiry_hours = 24;  // 24 heures par défaut
+  json_get_int(buf, "expiry", expiry_hours);
+  if (expiry_hours <= 0) {
+    expiry_hours = 24;
   }
   
-  // Create share link
-  int64_t expiry = esp_timer_get_time() / 1000000 + expiry_hours * 3600;
-  ShareLink share = {
-    .path = path,
-    .token = token,
-    .expiry = expiry
-  };
-  proxy->active_shares_.push_back(share);
+  std::string token = proxy->issue_share(path, expiry_hours);
+  if (token.empty()) {
+    httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "File not shareable");
+    return ESP_FAIL;
+  }
   
   // Send response
-  std::string response = "{\"token\": \"" + token + "\"}";
+  std::string response = "{\"token\": \"" + token + "\", \"link\": \"/share/" + token +
+                         "\", \"expiry\": " + std::to_string(expiry_hours) + "}";
   httpd_resp_set_type(req, "application/json");
   httpd_resp_send(req, response.c_str(), response.length());
   
@@ -777,43 +1913,46 @@ esp_err_t FTPHTTPProxy::share_access_handler(httpd_req_t *req) {
   }
 
   std::string token = uri.substr(7);  // Extrait le token après "/share/"
-  std::string target_path = "";
-  int64_t now = esp_timer_get_time() / 1000000;
-
-  for (const auto &share : proxy->active_shares_) {
-    if (share.token == token) {
-      // Vérifie si le lien a expiré
-      if (share.expiry < now) {
-        httpd_resp_send_err(req, HTTPD_410_GONE, "Share link expired");
-        return ESP_FAIL;
-      }
-
-      target_path = share.path;
-      break;
-    }
+  size_t query = token.find('?');
+  if (query != std::string::npos) {
+    token.erase(query);
   }
-  
-  if (target_path.empty()) {
+  std::string path;
+  bool expired;
+  if (!proxy->resolve_share(token, path, expired)) {
     httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Share not found");
     return ESP_FAIL;
   }
-  
-  // Redirect to file download (reuse http_req_handler)
-  // A proper implementation would set a new URI and call http_req_handler
-  httpd_resp_set_status(req, "307 Temporary Redirect");
-  httpd_resp_set_hdr(req, "Location", target_path.c_str());
-  httpd_resp_send(req, NULL, 0);
-  
+  // Vérifie si le lien a expiré
+  if (expired) {
+    httpd_resp_send_err(req, HTTPD_410_GONE, "Share link expired");
+    return ESP_FAIL;
+  }
+
+  // Servi sur place: pas d'aller-retour de redirection et le chemin réel n'est pas exposé
+  ESP_LOGI(TAG, "Accès via lien de partage: %s", token.c_str());
+  return start_download(req, proxy, path);
+}
+
+// POST /api/share/revoke: tous les liens émis deviennent invalides
+esp_err_t FTPHTTPProxy::share_revoke_handler(httpd_req_t *req) {
+  auto *proxy = (FTPHTTPProxy *)req->user_ctx;
+  if (!proxy->revoke_shares()) {
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Revocation not saved");
+    return ESP_FAIL;
+  }
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_sendstr(req, "{\"success\": true}");
   return ESP_OK;
 }
+
 // Code corrigé pour le http_req_handler
 esp_err_t FTPHTTPProxy::http_req_handler(httpd_req_t *req) {
   auto *proxy = (FTPHTTPProxy *)req->user_ctx;
-  std::string requested_path = req->uri;
-
-  // Suppression du premier slash
-  if (!requested_path.empty() && requested_path[0] == '/') {
-    requested_path.erase(0, 1);
+  std::string requested_path;
+  if (!request_path(req->uri, requested_path)) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Chemin invalide");
+    return ESP_FAIL;
   }
 
   ESP_LOGI(TAG, "Requête de téléchargement reçue: %s", requested_path.c_str());
@@ -826,32 +1965,21 @@ esp_err_t FTPHTTPProxy::http_req_handler(httpd_req_t *req) {
     return ESP_OK;
   }
   
-  // Vérifier si c'est un lien de partage valide
-  bool path_valid = false;
-  
-  // Format typique: /share/TOKEN
-  if (requested_path.compare(0, 6, "share/") == 0) {
-    std::string token = requested_path.substr(6);
-    
-    // Chercher le token dans les partages actifs
-    for (const auto &share : proxy->active_shares_) {
-      if (share.token == token) {
-        requested_path = share.path;
-        path_valid = true;
-        ESP_LOGI(TAG, "Accès via lien de partage: %s -> %s", token.c_str(), requested_path.c_str());
-        break;
-      }
-    }
-  } else {
-    // Vérifier si le fichier est dans la liste des fichiers connus
-    // Tous les fichiers connus sont accessibles directement
-    path_valid = true;
+  return start_download(req, proxy, requested_path);
+}
+
+// Lance le transfert d'un chemin déjà autorisé (URL directe ou lien de partage) via la file des workers
+esp_err_t FTPHTTPProxy::start_download(httpd_req_t *req, FTPHTTPProxy *proxy, std::string requested_path) {
+  if (!requested_path.empty() && requested_path[0] == '/') {
+    requested_path.erase(0, 1);
   }
-  
-  if (!path_valid) {
-    ESP_LOGW(TAG, "Chemin non autorisé: %s", requested_path.c_str());
-    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Fichier non trouvé ou accès non autorisé");
-    return ESP_FAIL;
+
+  // Serveur FTP injoignable: répondre tout de suite plutôt que d'occuper un worker
+  StorageBackend* backend = proxy->route(requested_path);
+  uint32_t unavailable_ms = backend->unavailable_for_ms();
+  if (unavailable_ms > 0) {
+    send_service_unavailable(req, unavailable_ms / 1000, "Serveur FTP injoignable");
+    return ESP_OK;
   }
 
   // Créer le contexte de transfert avec vérification de mémoire
@@ -864,39 +1992,202 @@ esp_err_t FTPHTTPProxy::http_req_handler(httpd_req_t *req) {
   
   // Configurer le contexte avec toutes les informations nécessaires
   ctx->remote_path = requested_path;
-  ctx->req = req;
-  ctx->ftp_server = proxy->ftp_server_;
-  ctx->username = proxy->username_;
-  ctx->password = proxy->password_;
-
-  // Créer une tâche dédiée pour le transfert de fichier pour éviter le blocage
-  BaseType_t task_created = xTaskCreatePinnedToCore(
-    file_transfer_task,           // Fonction de tâche
-    "file_transfer",              // Nom de tâche
-    8192,                         // Taille de la pile
-    ctx,                          // Paramètres de la tâche
-    tskIDLE_PRIORITY + 1,         // Priorité
-    NULL,                         // Handle (non nécessaire)
-    1                             // S'exécute sur le cœur 1 (laisse le cœur 0 pour l'interface WiFi)
-  );
-
-  if (task_created != pdPASS) {
-    ESP_LOGE(TAG, "Échec de création de la tâche de transfert");
+  ctx->proxy = proxy;
+  ctx->backend = backend;
+
+  // En-tête Range lu ici, tant que la requête appartient encore au thread httpd
+  char range_header[64];
+  if (httpd_req_get_hdr_value_str(req, "Range", range_header, sizeof(range_header)) == ESP_OK) {
+    ctx->has_range = parse_range_header(range_header, ctx->range_start, ctx->range_end);
+    ESP_LOGD(TAG, "En-tête Range: %s (%s)", range_header, ctx->has_range ? "accepté" : "ignoré");
+  }
+
+  // Validateurs des requêtes conditionnelles
+  char condition[128];
+  if (httpd_req_get_hdr_value_str(req, "If-None-Match", condition, sizeof(condition)) == ESP_OK) {
+    ctx->if_none_match = condition;
+  }
+  if (httpd_req_get_hdr_value_str(req, "If-Modified-Since", condition, sizeof(condition)) == ESP_OK &&
+      !parse_http_date(condition, ctx->if_modified_since)) {
+    ctx->if_modified_since = 0;
+  }
+
+  // Détacher la requête du thread httpd pour qu'elle reste valide dans le worker
+  if (httpd_req_async_handler_begin(req, &ctx->req) != ESP_OK) {
+    ESP_LOGE(TAG, "Échec de la prise en charge asynchrone de la requête");
+    delete ctx;
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Erreur serveur");
+    return ESP_FAIL;
+  }
+
+  // Même fichier déjà en cours de téléchargement pour un autre client: servi par ce transfert
+  if (backend->coalescable() && proxy->join_flight(ctx)) {
+    return ESP_OK;
+  }
+
+  // File d'attente pleine: demander au client de réessayer plutôt que d'échouer
+  if (xQueueSend(proxy->job_queue_, &ctx, 0) != pdTRUE) {
+    ESP_LOGW(TAG, "File de transferts pleine, requête refusée: %s", requested_path.c_str());
+    httpd_req_async_handler_complete(ctx->req);
+    delete ctx;
+    send_service_unavailable(req, 2, "Serveur occupé, réessayez plus tard");
+    return ESP_OK;
+  }
+
+  // Le worker va gérer le transfert et la réponse HTTP
+  return ESP_OK;
+}
+
+// PUT/POST /<chemin>[?append=1]: le corps est écrit par un worker sur le serveur FTP ou le mount local
+esp_err_t FTPHTTPProxy::upload_handler(httpd_req_t *req) {
+  auto *proxy = (FTPHTTPProxy *)req->user_ctx;
+  std::string requested_path;
+  if (!request_path(req->uri, requested_path) || requested_path.empty() || requested_path.back() == '/') {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Chemin de fichier requis");
+    return ESP_FAIL;
+  }
+
+  StorageBackend* backend = proxy->route(requested_path);
+  uint32_t unavailable_ms = backend->unavailable_for_ms();
+  if (unavailable_ms > 0) {
+    httpd_resp_set_hdr(req, "Connection", "close");
+    send_service_unavailable(req, unavailable_ms / 1000, "Serveur FTP injoignable");
+    return ESP_FAIL;
+  }
+
+  FileTransferContext* ctx = new (std::nothrow) FileTransferContext;
+  if (!ctx) {
+    ESP_LOGE(TAG, "Erreur d'allocation pour le contexte de transfert");
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Erreur mémoire");
+    return ESP_FAIL;
+  }
+  ctx->remote_path = requested_path;
+  ctx->proxy = proxy;
+  ctx->backend = backend;
+  ctx->upload = true;
+
+  char query[64];
+  char value[8];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+      httpd_query_key_value(query, "append", value, sizeof(value)) == ESP_OK) {
+    ctx->append = strcmp(value, "1") == 0 || strcmp(value, "true") == 0;
+  }
+
+  ESP_LOGI(TAG, "Requête d'envoi reçue: %s (%s)", requested_path.c_str(), ctx->append ? "ajout" : "création");
+
+  if (httpd_req_async_handler_begin(req, &ctx->req) != ESP_OK) {
+    ESP_LOGE(TAG, "Échec de la prise en charge asynchrone de la requête");
     delete ctx;
     httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Erreur serveur");
     return ESP_FAIL;
   }
 
-  // La tâche dédiée va gérer le transfert et la réponse HTTP
+  if (xQueueSend(proxy->job_queue_, &ctx, 0) != pdTRUE) {
+    ESP_LOGW(TAG, "File de transferts pleine, envoi refusé: %s", requested_path.c_str());
+    httpd_req_async_handler_complete(ctx->req);
+    delete ctx;
+    // Le corps n'a pas été lu: fermer la connexion après la réponse
+    httpd_resp_set_hdr(req, "Connection", "close");
+    send_service_unavailable(req, 2, "Serveur occupé, réessayez plus tard");
+    return ESP_FAIL;
+  }
+
   return ESP_OK;
 }
 
+// Compteurs et histogrammes au format texte Prometheus (version 0.0.4)
+esp_err_t FTPHTTPProxy::metrics_handler(httpd_req_t *req) {
+  auto *proxy = (FTPHTTPProxy *)req->user_ctx;
+  ProxyMetrics &metrics = proxy_metrics();
+  std::string out;
+  out.reserve(4096);
+  char line[160];
+
+  auto add = [&](const char *name, const char *type, const char *labels, uint32_t value) {
+    if (type != nullptr) {
+      snprintf(line, sizeof(line), "# TYPE %s %s\n", name, type);
+      out += line;
+    }
+    snprintf(line, sizeof(line), "%s%s %u\n", name, labels, (unsigned) value);
+    out += line;
+  };
+
+  add("ftp_proxy_active_transfers", "gauge", "", metrics.active_transfers);
+  add("ftp_proxy_transfers_total", "counter", "", metrics.transfers_total);
+  add("ftp_proxy_bytes_relayed_total", "counter", "", metrics.bytes_relayed);
+  add("ftp_proxy_bytes_uploaded_total", "counter", "", metrics.bytes_uploaded);
+  add("ftp_proxy_ftp_logins_total", "counter", "", metrics.ftp_logins);
+  add("ftp_proxy_coalesced_requests_total", "counter", "", metrics.coalesced_requests);
+  add("ftp_proxy_coalesce_detached_total", "counter", "", metrics.coalesce_detached);
+
+  out += "# TYPE ftp_proxy_stage_duration_seconds histogram\n";
+  metrics.dns.render(out, "ftp_proxy_stage_duration_seconds", "dns");
+  metrics.connect.render(out, "ftp_proxy_stage_duration_seconds", "connect");
+  metrics.login.render(out, "ftp_proxy_stage_duration_seconds", "login");
+  metrics.pasv.render(out, "ftp_proxy_stage_duration_seconds", "pasv");
+  metrics.first_byte.render(out, "ftp_proxy_stage_duration_seconds", "first_byte");
+  metrics.transfer.render(out, "ftp_proxy_stage_duration_seconds", "transfer");
+
+  out += "# TYPE ftp_proxy_ftp_errors_total counter\n";
+  metrics.render_ftp_errors(out);
+
+  // Files d'attente et pool de sessions
+  add("ftp_proxy_queue_depth", "gauge", "", uxQueueMessagesWaiting(proxy->job_queue_));
+  add("ftp_proxy_transfer_workers", "gauge", "", proxy->transfer_workers_);
+  size_t idle = 0;
+  if (xSemaphoreTake(proxy->pool_mutex_, pdMS_TO_TICKS(100)) == pdTRUE) {
+    idle = proxy->idle_connections_.size();
+    xSemaphoreGive(proxy->pool_mutex_);
+  }
+  uint32_t in_use = proxy->pool_size_ - uxSemaphoreGetCount(proxy->pool_slots_);
+  add("ftp_proxy_pool_connections", "gauge", "{state=\"busy\"}", in_use);
+  add("ftp_proxy_pool_connections", nullptr, "{state=\"idle\"}", idle);
+
+  // Mémoire: libre maintenant et plus bas niveau atteint depuis le démarrage
+  add("ftp_proxy_heap_free_bytes", "gauge", "{region=\"internal\"}", heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+  add("ftp_proxy_heap_free_bytes", nullptr, "{region=\"psram\"}", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+  add("ftp_proxy_heap_min_free_bytes", "gauge", "{region=\"internal\"}",
+      heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+  add("ftp_proxy_heap_min_free_bytes", nullptr, "{region=\"psram\"}",
+      heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM));
+
+  // Cache de fichiers et lecture anticipée
+  uint32_t hits = proxy->file_cache_.hits();
+  uint32_t misses = proxy->file_cache_.misses();
+  add("ftp_proxy_cache_hits_total", "counter", "", hits);
+  add("ftp_proxy_cache_misses_total", "counter", "", misses);
+  add("ftp_proxy_cache_bytes", "gauge", "", proxy->file_cache_.ram_used());
+  snprintf(line, sizeof(line), "# TYPE ftp_proxy_cache_hit_ratio gauge\nftp_proxy_cache_hit_ratio %.3f\n",
+           hits + misses > 0 ? (double) hits / (hits + misses) : 0.0);
+  out += line;
+  add("ftp_proxy_read_ahead_streams_total", "counter", "", proxy->read_ahead_streams_);
+  add("ftp_proxy_read_ahead_underruns_total", "counter", "", proxy->read_ahead_underruns_);
+  snprintf(line, sizeof(line), "# TYPE ftp_proxy_read_ahead_fill_ratio gauge\nftp_proxy_read_ahead_fill_ratio %.2f\n",
+           proxy->read_ahead_fill_percent_ / 100.0);
+  out += line;
+
+  httpd_resp_set_type(req, "text/plain; version=0.0.4");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  return httpd_resp_send(req, out.data(), out.size());
+}
+
 // Code pour gérer le favicon.ico dans le handler de fichiers statiques
 esp_err_t FTPHTTPProxy::static_files_handler(httpd_req_t *req) {
-  // Interface principale
+  // Interface principale, déjà compressée: le navigateur la garde en cache et revalide par ETag
   if (strcmp(req->uri, "/") == 0 || strcmp(req->uri, "/index.html") == 0) {
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, HTML_INDEX, strlen(HTML_INDEX));
+    httpd_resp_set_hdr(req, "ETag", INDEX_HTML_ETAG);
+    httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=86400");
+    char if_none_match[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strstr(if_none_match, INDEX_HTML_ETAG) != nullptr) {
+      httpd_resp_set_status(req, "304 Not Modified");
+      httpd_resp_send(req, nullptr, 0);
+      return ESP_OK;
+    }
+    httpd_resp_set_type(req, "text/html; charset=utf-8");
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    httpd_resp_send(req, (const char*) INDEX_HTML_GZ, INDEX_HTML_GZ_SIZE);
     return ESP_OK;
   }
   
@@ -931,7 +2222,7 @@ void FTPHTTPProxy::setup_http_server() {
   // Optimisations pour ESP-IDF 5.1.5
   config.recv_wait_timeout = 30;    // 30 secondes
   config.send_wait_timeout = 30;    // 30 secondes
-  config.max_uri_handlers = 8;        
+  config.max_uri_handlers = 12;
   config.max_resp_headers = 16;
   config.stack_size = 8192;         // Taille de pile suffisante
   config.lru_purge_enable = true;   // Activer la purge LRU
@@ -976,6 +2267,14 @@ void FTPHTTPProxy::setup_http_server() {
   };
   ESP_ERROR_CHECK_WITHOUT_ABORT(httpd_register_uri_handler(server_, &uri_share_api));
   
+  const httpd_uri_t uri_share_revoke = {
+    .uri       = "/api/share/revoke",
+    .method    = HTTP_POST,
+    .handler   = share_revoke_handler,
+    .user_ctx  = this
+  };
+  ESP_ERROR_CHECK_WITHOUT_ABORT(httpd_register_uri_handler(server_, &uri_share_revoke));
+  
   const httpd_uri_t uri_share_access = {
     .uri       = "/share/*",
     .method    = HTTP_GET,
@@ -984,6 +2283,14 @@ void FTPHTTPProxy::setup_http_server() {
   };
   ESP_ERROR_CHECK_WITHOUT_ABORT(httpd_register_uri_handler(server_, &uri_share_access));
   
+  const httpd_uri_t uri_metrics = {
+    .uri       = "/api/metrics",
+    .method    = HTTP_GET,
+    .handler   = metrics_handler,
+    .user_ctx  = this
+  };
+  ESP_ERROR_CHECK_WITHOUT_ABORT(httpd_register_uri_handler(server_, &uri_metrics));
+
   const httpd_uri_t uri_download = {
     .uri       = "/*",
     .method    = HTTP_GET,
@@ -992,6 +2299,23 @@ void FTPHTTPProxy::setup_http_server() {
   };
   ESP_ERROR_CHECK_WITHOUT_ABORT(httpd_register_uri_handler(server_, &uri_download));
 
+  // Envois vers le serveur FTP; enregistrés après les API pour que POST /api/* garde la priorité
+  const httpd_uri_t uri_upload_put = {
+    .uri       = "/*",
+    .method    = HTTP_PUT,
+    .handler   = upload_handler,
+    .user_ctx  = this
+  };
+  ESP_ERROR_CHECK_WITHOUT_ABORT(httpd_register_uri_handler(server_, &uri_upload_put));
+
+  const httpd_uri_t uri_upload_post = {
+    .uri       = "/*",
+    .method    = HTTP_POST,
+    .handler   = upload_handler,
+    .user_ctx  = this
+  };
+  ESP_ERROR_CHECK_WITHOUT_ABORT(httpd_register_uri_handler(server_, &uri_upload_post));
+
   ESP_LOGI(TAG, "Serveur HTTP démarré avec succès sur le port %d", local_port_);
   ESP_LOGI(TAG, "Interface utilisateur accessible à http://[ip-esp]:%d/", local_port_);
 }
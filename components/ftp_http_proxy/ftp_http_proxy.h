@@ -1,33 +1,139 @@
 #pragma once
 
 #include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
 #include <esp_http_server.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "fan_out.h"
+#include "file_cache.h"
+#include "ftp_client.h"
+#include "ftp_listing.h"
+#include "local_storage.h"
+#include "mime_types.h"
+#include "open_hash_map.h"
+#include "share_store.h"
+#include "share_token.h"
+#include "storage_backend.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <queue>
 #include <string>
 #include <vector>
 
 namespace esphome {
 namespace ftp_http_proxy {
 
+class FTPHTTPProxy;
+class RelayEngine;
+
 struct FileTransferContext {
   std::string remote_path;
   httpd_req_t* req;
-  std::string ftp_server;
-  std::string username;
-  std::string password;
+  FTPHTTPProxy* proxy;
+  StorageBackend* backend;  // Choisi d'après le préfixe du chemin
+
+  // Plage demandée via l'en-tête Range (plage unique)
+  bool has_range{false};
+  int64_t range_start{0};  // -1: plage suffixe, range_end contient alors la longueur
+  int64_t range_end{-1};   // -1: jusqu'à la fin du fichier
+
+  // Requête conditionnelle (If-None-Match / If-Modified-Since)
+  std::string if_none_match;
+  time_t if_modified_since{0};
+
+  // Envoi PUT/POST vers le serveur FTP: STOR, ou APPE pour compléter un fichier existant
+  bool upload{false};
+  bool append{false};
+
+  // Client détaché d'un téléchargement partagé: en-têtes déjà envoyés, le corps reprend
+  // à l'octet resume_offset du fichier pour resume_length octets
+  int64_t resume_offset{0};
+  int64_t resume_length{-1};  // -1: requête ordinaire
+};
+
+// Connexion de contrôle FTP déjà authentifiée (USER/PASS/TYPE I faits)
+struct FTPControlConnection : public FtpControl {
+  int64_t last_used{0};  // Horodatage esp_timer (µs) du dernier usage
+};
+
+// Serveur FTP: backend des chemins hors de tout mount local
+class FtpStorage : public StorageBackend {
+ public:
+  explicit FtpStorage(FTPHTTPProxy *proxy) : proxy_(proxy) {}
+
+  const char *name() const override { return "ftp"; }
+  uint32_t unavailable_for_ms() const override;
+  bool coalescable() const override { return true; }
+  void download(FileTransferContext *ctx, RelayEngine &relay) override;
+  void upload(FileTransferContext *ctx) override;
+
+ protected:
+  FTPHTTPProxy *proxy_;
 };
 
 class FTPHTTPProxy : public Component {
+  friend class FtpStorage;
+
  public:
   void set_ftp_server(const std::string &server) { ftp_server_ = server; }
+  void set_ftp_port(int port) { ftp_port_ = port; }
   void set_username(const std::string &username) { username_ = username; }
   void set_password(const std::string &password) { password_ = password; }
   void set_local_port(int port) { local_port_ = port; }
+  void set_connect_timeout(uint32_t timeout_ms) { connect_timeout_ms_ = timeout_ms; }
+  void set_use_epsv(bool use_epsv) { use_epsv_ = use_epsv; }
+  void set_dns_refresh_interval(uint32_t interval_ms) { dns_refresh_ms_ = interval_ms; }
+  void set_pool_size(int size) { pool_size_ = size; }
+  void set_idle_timeout(uint32_t timeout_ms) { idle_timeout_ms_ = timeout_ms; }
+  void set_transfer_workers(int workers) { transfer_workers_ = workers; }
+  void set_transfer_queue_size(int size) { transfer_queue_size_ = size; }
+  void set_relay_buffer_count(int count) { relay_buffer_count_ = count; }
+  void set_relay_buffer_size(int size) { relay_buffer_size_ = size; }
+  void set_relay_use_psram(bool use_psram) { relay_use_psram_ = use_psram; }
+  void set_read_ahead_size(uint32_t size) { read_ahead_size_ = size; }
+  void set_listing_cache_ttl(uint32_t ttl_ms) { listing_cache_ttl_ms_ = ttl_ms; }
+  void set_cache_size(uint32_t size) { cache_size_ = size; }
+  void set_cache_max_file_size(uint32_t size) { cache_max_file_size_ = size; }
+  void set_cache_revalidate_interval(uint32_t interval_ms) { cache_revalidate_ms_ = interval_ms; }
+  void set_cache_directory(const std::string &directory) { cache_directory_ = directory; }
+  void set_cache_directory_size(uint32_t size) { cache_directory_size_ = size; }
+  void set_metadata_cache_ttl(uint32_t ttl_ms) { metadata_cache_ttl_ms_ = ttl_ms; }
+  void set_segment_connections(int connections) { segment_connections_ = connections; }
+  void set_segment_size(uint32_t size) { segment_size_ = size; }
+  void set_segment_min_file_size(uint32_t size) { segment_min_file_size_ = size; }
+  void set_coalescing_buffer_size(uint32_t size) { coalescing_buffer_size_ = size; }
+  void set_signed_share_tokens(bool signed_tokens) { signed_share_tokens_ = signed_tokens; }
+  void set_store_partition(const std::string &label) { store_partition_ = label; }
+  void set_store_flush_interval(uint32_t interval_ms) { store_flush_ms_ = interval_ms; }
+  // Fichiers sous <prefix>/ servis depuis le répertoire VFS root au lieu du serveur FTP
+  void add_local_mount(const std::string &prefix, const std::string &root) {
+    local_mounts_.emplace_back(new LocalStorage(prefix, root));
+  }
+#ifdef USE_SENSOR
+  void set_active_transfers_sensor(sensor::Sensor *sensor) { active_transfers_sensor_ = sensor; }
+  void set_bytes_relayed_sensor(sensor::Sensor *sensor) { bytes_relayed_sensor_ = sensor; }
+  void set_queue_depth_sensor(sensor::Sensor *sensor) { queue_depth_sensor_ = sensor; }
+  void set_ftp_errors_sensor(sensor::Sensor *sensor) { ftp_errors_sensor_ = sensor; }
+  void set_cache_hit_ratio_sensor(sensor::Sensor *sensor) { cache_hit_ratio_sensor_ = sensor; }
+  void set_psram_free_sensor(sensor::Sensor *sensor) { psram_free_sensor_ = sensor; }
+  void set_internal_free_sensor(sensor::Sensor *sensor) { internal_free_sensor_ = sensor; }
+#endif
   
   bool is_shareable(const std::string &path);
+  void set_shareable(const std::string &path, bool shareable);
   void create_share_link(const std::string &path, int expiry_hours);
+  // Invalide tous les liens émis (signés et aléatoires)
+  bool revoke_shares();
   
   void setup() override;
   void loop() override;
+  void on_shutdown() override;
   void setup_http_server();
 
  protected:
@@ -35,20 +141,155 @@ class FTPHTTPProxy : public Component {
   static esp_err_t file_list_handler(httpd_req_t *req);
   static esp_err_t share_create_handler(httpd_req_t *req);
   static esp_err_t share_access_handler(httpd_req_t *req);
+  static esp_err_t share_revoke_handler(httpd_req_t *req);
+  static esp_err_t start_download(httpd_req_t *req, FTPHTTPProxy *proxy, std::string requested_path);
   static esp_err_t static_files_handler(httpd_req_t *req);
   static esp_err_t toggle_shareable_handler(httpd_req_t *req);
+  static esp_err_t upload_handler(httpd_req_t *req);
+  static esp_err_t metrics_handler(httpd_req_t *req);
   
-  static void file_transfer_task(void* param);
-  bool connect_to_ftp(int& sock, const char* server, const char* username, const char* password);
+  static void transfer_worker_task(void* param);
+  static void file_transfer_task(FileTransferContext* ctx, RelayEngine &relay);
+  static void upload_transfer_task(FileTransferContext* ctx);
+  static void resume_transfer_task(FileTransferContext* ctx, RelayEngine &relay);
+  // record_failures: false pour une session facultative, dont l'échec n'ouvre pas le disjoncteur
+  bool connect_to_ftp(FtpControl &ctrl, bool record_failures = true);
+
+  // Adresse du serveur FTP résolue une fois, puis rafraîchie par une tâche de fond
+  static void dns_refresh_task(void* param);
+  static void share_store_task(void* param);
+  bool refresh_server_address();
+  bool get_server_address(struct sockaddr_storage &addr, socklen_t &addr_len);
+
+  // Disjoncteur: après des échecs de connexion répétés, les requêtes échouent aussitôt en 503
+  uint32_t ftp_unavailable_for_ms() const;
+  void record_ftp_reachable(bool reachable);
+
+  // Pool de connexions de contrôle partagé entre les téléchargements
+  // refused != nullptr: session facultative, un échec d'ouverture y est signalé au lieu d'être
+  // compté par le disjoncteur
+  bool acquire_ftp_connection(FTPControlConnection &conn, TickType_t wait = pdMS_TO_TICKS(10000),
+                              bool *refused = nullptr);
+  // Session supplémentaire d'un téléchargement segmenté: sans attente, et un refus du serveur
+  // (limite de sessions par IP) réduit le nombre de sessions au lieu de compter comme une panne
+  bool acquire_segment_lane(FTPControlConnection &conn, size_t lanes_held);
+  void release_ftp_connection(FTPControlConnection &conn, bool reusable);
+  void evict_idle_ftp_connections();
   bool list_ftp_directory(const std::string &remote_dir, httpd_req_t *req);
+  bool fetch_ftp_directory(const std::string &remote_dir, std::vector<DirEntry> &entries);
+
+  // Cache des listings par répertoire, avec durée de validité
+  std::shared_ptr<const std::vector<DirEntry>> lookup_dir_cache(const std::string &remote_dir);
+  void store_dir_cache(const std::string &remote_dir, std::shared_ptr<const std::vector<DirEntry>> entries);
+  void invalidate_dir_cache(const std::string &remote_dir);
+
+  // Cache SIZE/MDTM par chemin: les requêtes conditionnelles sont résolues sans FTP
+  bool lookup_metadata(const std::string &path, int64_t &size, time_t &modified);
+  void store_metadata(const std::string &path, int64_t size, time_t modified);
+  void invalidate_metadata(const std::string &path);
 
   std::string ftp_server_;
+  int ftp_port_{21};
   std::string username_;
   std::string password_;
   int local_port_{8080};
   int sock_{-1};
   httpd_handle_t server_{nullptr};
   bool delayed_setup_{false};
+
+  uint32_t connect_timeout_ms_{5000};
+  bool use_epsv_{true};  // false: PASV directement (serveurs qui répondent mal à EPSV)
+  uint32_t dns_refresh_ms_{300000};
+  struct sockaddr_storage server_addr_ {};
+  socklen_t server_addr_len_{0};  // 0: pas encore résolue
+  SemaphoreHandle_t dns_mutex_{nullptr};
+
+  static const uint32_t BREAKER_THRESHOLD = 2;     // Échecs consécutifs avant ouverture
+  static const uint32_t BREAKER_OPEN_MS = 10000;   // Durée pendant laquelle les requêtes sont refusées
+  std::atomic<uint32_t> consecutive_failures_{0};
+  std::atomic<uint32_t> breaker_open_until_{0};    // millis()
+
+  int pool_size_{2};
+  uint32_t idle_timeout_ms_{60000};
+  std::vector<FTPControlConnection> idle_connections_;
+  SemaphoreHandle_t pool_mutex_{nullptr};
+  SemaphoreHandle_t pool_slots_{nullptr};  // Borne le nombre total de sessions FTP
+
+  int transfer_workers_{2};
+  int transfer_queue_size_{4};
+  QueueHandle_t job_queue_{nullptr};  // FileTransferContext* en attente d'un worker
+
+  // Buffers du relais FTP -> HTTP, par worker
+  int relay_buffer_count_{2};
+  int relay_buffer_size_{8192};
+  bool relay_use_psram_{true};
+
+  // Lecture anticipée des fichiers audio/vidéo: fenêtre de buffers d'avance sur l'envoi (0: désactivée)
+  uint32_t read_ahead_size_{0};
+  std::atomic<uint32_t> read_ahead_streams_{0};
+  std::atomic<uint32_t> read_ahead_underruns_{0};
+  std::atomic<uint32_t> read_ahead_fill_percent_{0};  // Remplissage moyen du dernier flux
+
+#ifdef USE_SENSOR
+  // Capteurs ESPHome alimentés depuis les compteurs de /api/metrics
+  static const uint32_t SENSOR_PUBLISH_INTERVAL_MS = 30000;
+  void publish_sensors();
+  uint32_t last_sensor_publish_{0};
+  sensor::Sensor *active_transfers_sensor_{nullptr};
+  sensor::Sensor *bytes_relayed_sensor_{nullptr};
+  sensor::Sensor *queue_depth_sensor_{nullptr};
+  sensor::Sensor *ftp_errors_sensor_{nullptr};
+  sensor::Sensor *cache_hit_ratio_sensor_{nullptr};
+  sensor::Sensor *psram_free_sensor_{nullptr};
+  sensor::Sensor *internal_free_sensor_{nullptr};
+#endif
+
+  // Téléchargements partagés: les GET simultanés d'un même chemin et d'une même plage
+  // se rattachent au transfert en cours (0: désactivé)
+  bool join_flight(FileTransferContext *ctx);
+  FanOutGroup *open_flight(FileTransferContext *ctx, std::string head, int64_t body_offset, int64_t body_length);
+  void close_flight(FanOutGroup *group, bool complete);
+  void finish_follower(FileTransferContext *ctx, FanOutOutcome outcome, int64_t sent, int64_t body_offset,
+                       int64_t body_length);
+  uint32_t coalescing_buffer_size_{0};
+  std::vector<FanOutGroup *> flights_;  // Quelques entrées au plus (une par worker)
+  SemaphoreHandle_t flights_mutex_{nullptr};
+
+  // Téléchargement segmenté des gros fichiers sur plusieurs sessions FTP (1: désactivé)
+  int segment_connections_{1};
+  uint32_t segment_size_{256 * 1024};
+  uint32_t segment_min_file_size_{4 * 1024 * 1024};
+  // Après un refus, sessions par téléchargement plafonnées au nombre obtenu, pendant un temps
+  static const uint32_t SEGMENT_CAP_MS = 60000;
+  std::atomic<uint32_t> segment_lane_cap_{0};    // 0: aucun plafond
+  std::atomic<uint32_t> segment_cap_until_{0};  // millis()
+
+  struct DirCacheEntry {
+    int64_t fetched;  // Horodatage esp_timer (µs)
+    std::shared_ptr<const std::vector<DirEntry>> entries;
+  };
+  static const size_t MAX_CACHED_DIRS = 16;
+  uint32_t listing_cache_ttl_ms_{30000};
+  std::map<std::string, DirCacheEntry> dir_cache_;
+  SemaphoreHandle_t dir_cache_mutex_{nullptr};
+
+  // Cache de fichiers complets (PSRAM, puis partition montée en option)
+  FileCache file_cache_;
+  uint32_t cache_size_{0};  // 0: cache désactivé
+  uint32_t cache_max_file_size_{512 * 1024};
+  uint32_t cache_revalidate_ms_{10000};
+  std::string cache_directory_;
+  uint32_t cache_directory_size_{0};
+
+  struct FileMetadata {
+    int64_t size;
+    time_t modified;
+    int64_t fetched;  // Horodatage esp_timer (µs)
+  };
+  static const size_t MAX_CACHED_METADATA = 256;
+  uint32_t metadata_cache_ttl_ms_{10000};
+  OpenHashMap<std::string, FileMetadata, StringHash> metadata_cache_;
+  SemaphoreHandle_t metadata_mutex_{nullptr};
   
   // Structure pour le partage de fichiers
   struct ShareLink {
@@ -62,9 +303,50 @@ class FTPHTTPProxy : public Component {
     bool shareable;
   };
   
-  // Stockage des fichiers et paramètres de partage en mémoire
-  std::vector<FileEntry> ftp_files_;
-  std::vector<ShareLink> active_shares_;
+  // Échéance d'un lien, ordonnée dans un tas min pour n'examiner que les liens expirés
+  struct ShareExpiry {
+    int64_t expiry;
+    std::string token;
+    bool operator>(const ShareExpiry &other) const { return expiry > other.expiry; }
+  };
+
+  void add_share(const ShareLink &share);
+  bool find_share(const std::string &token, ShareLink &share);
+  // Token pour un fichier partageable (signé si possible); vide si le fichier n'est pas partageable
+  std::string issue_share(const std::string &path, int expiry_hours);
+  // Chemin désigné par un token signé ou aléatoire; expired: lien reconnu mais échu
+  bool resolve_share(const std::string &token, std::string &path, bool &expired);
+  // Chemin partageable d'un path_id (changements en RAM puis image de la partition)
+  bool path_for_id(uint32_t path_id, std::string &path);
+  // Écrit les changements accumulés dans la partition
+  void flush_share_store();
+  void expire_shares();
+
+  // Changements de partage en RAM, indexés par chemin et par token; ils priment sur la partition
+  // et la quittent une fois écrits dans son image
+  OpenHashMap<std::string, FileEntry, StringHash> ftp_files_;
+  OpenHashMap<std::string, ShareLink, StringHash> active_shares_;
+  std::priority_queue<ShareExpiry, std::vector<ShareExpiry>, std::greater<ShareExpiry>> share_expiries_;
+  SemaphoreHandle_t shares_mutex_{nullptr};  // Partagé entre loop() et les handlers httpd
+
+  // Tokens signés: aucune entrée par lien, seulement path_id -> chemin pour les fichiers partageables
+  bool signed_share_tokens_{false};
+  ShareTokenSigner share_signer_;
+  OpenHashMap<uint32_t, std::string, IntHash> share_paths_;
+
+  // Partition des partages (optionnelle); les écritures sont regroupées toutes les store_flush_ms_
+  std::string store_partition_;
+  uint32_t store_flush_ms_{30000};
+  ShareStore share_store_;
+  bool store_dirty_{false};
+  bool shares_await_clock_{false};  // Liens aléatoires gardés en RAM faute d'heure Unix
+  uint32_t shares_revoked_{0};  // Révocations demandées
+  uint32_t store_revoked_{0};   // Révocations écrites dans l'image
+
+  // Backend d'un chemin demandé: premier mount local dont le préfixe correspond, sinon FTP
+  StorageBackend *route(const std::string &path);
+  FtpStorage ftp_storage_{this};
+  std::vector<std::unique_ptr<LocalStorage>> local_mounts_;
 };
 
 }  // namespace ftp_http_proxy
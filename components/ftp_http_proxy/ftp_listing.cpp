@@ -0,0 +1,232 @@
+#include "ftp_listing.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned) (y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t) doe - 719468;
+}
+
+bool parse_ftp_timestamp(const char *value, time_t &out) {
+  int year, month, day, hour, minute, second;
+  if (sscanf(value, "%4d%2d%2d%2d%2d%2d", &year, &month, &day, &hour, &minute, &second) != 6) {
+    return false;
+  }
+  if (month < 1 || month > 12 || day < 1 || day > 31) {
+    return false;
+  }
+  out = (time_t) (days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second);
+  return true;
+}
+
+void ListingParser::feed(const char *data, size_t len) {
+  const char *end = data + len;
+  while (data < end) {
+    const char *nl = (const char *) memchr(data, '\n', end - data);
+    if (nl == nullptr) {
+      partial_.append(data, end - data);
+      return;
+    }
+    if (partial_.empty()) {
+      parse_line(data, nl - data);
+    } else {
+      partial_.append(data, nl - data);
+      parse_line(partial_.data(), partial_.size());
+      partial_.clear();
+    }
+    data = nl + 1;
+  }
+}
+
+void ListingParser::finish() {
+  if (!partial_.empty()) {
+    parse_line(partial_.data(), partial_.size());
+    partial_.clear();
+  }
+}
+
+void ListingParser::parse_line(const char *line, size_t len) {
+  if (len > 0 && line[len - 1] == '\r') {
+    len--;
+  }
+  if (len == 0) {
+    return;
+  }
+  DirEntry entry;
+  bool ok = mlsd_ ? parse_mlsd_line(line, len, entry) : parse_list_line(line, len, entry);
+  if (ok && entry.name != "." && entry.name != "..") {
+    entries_.push_back(std::move(entry));
+  }
+}
+
+// "type=file;size=1234;modify=20240101120000; nom du fichier.mp3"
+bool parse_mlsd_line(const char *line, size_t len, DirEntry &entry) {
+  const char *end = line + len;
+  const char *space = (const char *) memchr(line, ' ', len);
+  if (space == nullptr || space + 1 >= end) {
+    return false;
+  }
+  entry.name.assign(space + 1, end - space - 1);
+
+  bool has_type = false;
+  const char *fact = line;
+  while (fact < space) {
+    const char *semi = (const char *) memchr(fact, ';', space - fact);
+    const char *fact_end = semi ? semi : space;
+    const char *eq = (const char *) memchr(fact, '=', fact_end - fact);
+    if (eq != nullptr) {
+      size_t key_len = eq - fact;
+      std::string value(eq + 1, fact_end - eq - 1);
+      if (key_len == 4 && strncasecmp(fact, "type", 4) == 0) {
+        // cdir/pdir désignent le répertoire courant et le parent
+        if (strcasecmp(value.c_str(), "cdir") == 0 || strcasecmp(value.c_str(), "pdir") == 0) {
+          return false;
+        }
+        entry.is_dir = strcasecmp(value.c_str(), "dir") == 0;
+        has_type = true;
+      } else if (key_len == 4 && strncasecmp(fact, "size", 4) == 0) {
+        entry.size = strtoll(value.c_str(), nullptr, 10);
+      } else if (key_len == 6 && strncasecmp(fact, "modify", 6) == 0) {
+        parse_ftp_timestamp(value.c_str(), entry.modified);
+      }
+    }
+    fact = fact_end + 1;
+  }
+  return has_type;
+}
+
+static int month_from_name(const char *name) {
+  static const char *const MONTHS[] = {"jan", "feb", "mar", "apr", "may", "jun",
+                                       "jul", "aug", "sep", "oct", "nov", "dec"};
+  for (int i = 0; i < 12; i++) {
+    if (strncasecmp(name, MONTHS[i], 3) == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+// Découpe les n premiers champs séparés par des espaces; retourne le reste de la ligne
+static const char *split_fields(const char *line, const char *end, const char **fields, size_t *lens, int n) {
+  const char *p = line;
+  for (int i = 0; i < n; i++) {
+    while (p < end && *p == ' ') {
+      p++;
+    }
+    if (p >= end) {
+      return nullptr;
+    }
+    fields[i] = p;
+    while (p < end && *p != ' ') {
+      p++;
+    }
+    lens[i] = p - fields[i];
+  }
+  // Un seul séparateur avant le nom: les noms peuvent commencer par des espaces
+  if (p < end && *p == ' ') {
+    p++;
+  }
+  return p < end ? p : nullptr;
+}
+
+static bool parse_unix_list_line(const char *line, const char *end, DirEntry &entry) {
+  // drwxr-xr-x   2 user  group     4096 Jan  1 12:00 nom
+  const char *f[8];
+  size_t l[8];
+  const char *name = split_fields(line, end, f, l, 8);
+  if (name == nullptr) {
+    return false;
+  }
+  entry.is_dir = line[0] == 'd';
+  entry.size = entry.is_dir ? -1 : strtoll(f[4], nullptr, 10);
+  entry.name.assign(name, end - name);
+  if (line[0] == 'l') {
+    // Lien symbolique: "nom -> cible"
+    size_t arrow = entry.name.find(" -> ");
+    if (arrow != std::string::npos) {
+      entry.name.resize(arrow);
+    }
+  }
+
+  int month = month_from_name(f[5]);
+  int day = atoi(f[6]);
+  if (month > 0 && day > 0) {
+    int year, hour = 0, minute = 0;
+    if (memchr(f[7], ':', l[7]) != nullptr) {
+      // Format "HH:MM": fichier des 6 derniers mois, année courante si l'horloge est réglée
+      sscanf(f[7], "%d:%d", &hour, &minute);
+      time_t now = time(nullptr);
+      struct tm tm_now;
+      gmtime_r(&now, &tm_now);
+      year = tm_now.tm_year + 1900;
+      if (year < 2020) {
+        return true;
+      }
+    } else {
+      year = atoi(f[7]);
+    }
+    entry.modified = (time_t) (days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60);
+  }
+  return true;
+}
+
+static bool parse_dos_list_line(const char *line, const char *end, DirEntry &entry) {
+  // 01-15-24  10:30AM       <DIR>          nom
+  // 01-15-24  10:30AM              1234 nom
+  const char *f[3];
+  size_t l[3];
+  const char *name = split_fields(line, end, f, l, 3);
+  if (name == nullptr) {
+    return false;
+  }
+  while (name < end && *name == ' ') {
+    name++;
+  }
+  if (name >= end) {
+    return false;
+  }
+  entry.name.assign(name, end - name);
+  entry.is_dir = l[2] == 5 && strncasecmp(f[2], "<DIR>", 5) == 0;
+  entry.size = entry.is_dir ? -1 : strtoll(f[2], nullptr, 10);
+
+  int month, day, year, hour, minute;
+  char ampm[3] = "";
+  if (sscanf(f[0], "%d-%d-%d", &month, &day, &year) == 3 && sscanf(f[1], "%d:%d%2s", &hour, &minute, ampm) >= 2 &&
+      month >= 1 && month <= 12 && day >= 1 && day <= 31) {
+    if (year < 100) {
+      year += year < 70 ? 2000 : 1900;
+    }
+    if (strcasecmp(ampm, "PM") == 0 && hour < 12) {
+      hour += 12;
+    } else if (strcasecmp(ampm, "AM") == 0 && hour == 12) {
+      hour = 0;
+    }
+    entry.modified = (time_t) (days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60);
+  }
+  return true;
+}
+
+bool parse_list_line(const char *line, size_t len, DirEntry &entry) {
+  const char *end = line + len;
+  if (isdigit((unsigned char) line[0])) {
+    return parse_dos_list_line(line, end, entry);
+  }
+  // Ignore "total 123" et les lignes non reconnues
+  if (strchr("-dlbcps", line[0]) == nullptr || len < 10) {
+    return false;
+  }
+  return parse_unix_list_line(line, end, entry);
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
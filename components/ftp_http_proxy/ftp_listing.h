@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+struct DirEntry {
+  std::string name;
+  bool is_dir{false};
+  int64_t size{-1};     // -1: inconnue
+  time_t modified{0};   // 0: inconnue (UTC)
+};
+
+/* Analyse incrémentale d'un listing FTP reçu sur le canal de données.
+ * MLSD (RFC 3659) est privilégié; LIST est interprété au format Unix (ls -l) ou DOS/IIS. */
+class ListingParser {
+ public:
+  explicit ListingParser(bool mlsd) : mlsd_(mlsd) {}
+
+  // Accepte des fragments arbitraires: les lignes coupées entre deux recv sont reconstituées
+  void feed(const char *data, size_t len);
+  // Traite une éventuelle dernière ligne sans fin de ligne
+  void finish();
+
+  std::vector<DirEntry> &entries() { return entries_; }
+
+ protected:
+  void parse_line(const char *line, size_t len);
+
+  bool mlsd_;
+  std::string partial_;
+  std::vector<DirEntry> entries_;
+};
+
+bool parse_mlsd_line(const char *line, size_t len, DirEntry &entry);
+bool parse_list_line(const char *line, size_t len, DirEntry &entry);
+
+// Nombre de jours depuis le 01/01/1970 (calendrier grégorien proleptique), sans dépendre de timegm
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d);
+// Horodatage FTP "YYYYMMDDHHMMSS[.sss]" en UTC (MDTM, fait modify= de MLSD)
+bool parse_ftp_timestamp(const char *value, time_t &out);
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
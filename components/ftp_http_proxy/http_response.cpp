@@ -0,0 +1,335 @@
+#include "http_response.h"
+#include "ftp_http_proxy.h"
+#include "ftp_listing.h"
+#include "metrics.h"
+#include "open_hash_map.h"
+#include "storage_backend.h"
+#include "esphome/core/log.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const char *TAG = "ftp_proxy";
+
+// Analyse un en-tête "Range: bytes=..." à plage unique.
+// Les plages multiples sont ignorées: on sert alors le fichier complet (RFC 7233 l'autorise).
+bool parse_range_header(const char* value, int64_t &start, int64_t &end) {
+  if (strncmp(value, "bytes=", 6) != 0 || strchr(value, ',') != nullptr) {
+    return false;
+  }
+  const char* spec = value + 6;
+  char* next = nullptr;
+
+  if (*spec == '-') {
+    // Plage suffixe: les N derniers octets
+    int64_t suffix = strtoll(spec + 1, &next, 10);
+    if (next == spec + 1 || suffix <= 0) {
+      return false;
+    }
+    start = -1;
+    end = suffix;
+    return true;
+  }
+
+  start = strtoll(spec, &next, 10);
+  if (next == spec || *next != '-' || start < 0) {
+    return false;
+  }
+  spec = next + 1;
+  if (*spec == '\0') {
+    end = -1;  // Jusqu'à la fin du fichier
+    return true;
+  }
+  end = strtoll(spec, &next, 10);
+  return next != spec && end >= start;
+}
+
+// Format IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT"
+void format_http_date(time_t t, char* out, size_t out_size) {
+  struct tm tm_utc;
+  gmtime_r(&t, &tm_utc);
+  strftime(out, out_size, "%a, %d %b %Y %H:%M:%S GMT", &tm_utc);
+}
+
+// Type MIME et politique d'après l'extension; les types non affichables sont proposés en téléchargement
+void set_content_type(HttpResponseHead &head, const std::string &path) {
+  const MimeType &mime = lookup_mime_type(path.c_str());
+  head.content_type = mime.type;
+  head.mime_policy = mime.policy;
+  if (!(mime.policy & MIME_INLINE)) {
+    size_t slash_pos = path.find_last_of('/');
+    const char* filename = path.c_str() + (slash_pos == std::string::npos ? 0 : slash_pos + 1);
+    snprintf(head.content_disposition, sizeof(head.content_disposition), "attachment; filename=\"%s\"", filename);
+  }
+}
+
+void send_range_not_satisfiable(httpd_req_t* req, HttpResponseHead &head, int64_t file_size) {
+  snprintf(head.content_range, sizeof(head.content_range), "bytes */%lld", (long long) file_size);
+  httpd_resp_set_status(req, "416 Range Not Satisfiable");
+  httpd_resp_set_hdr(req, "Content-Range", head.content_range);
+  httpd_resp_send(req, NULL, 0);
+}
+
+// 503 avec Retry-After: file pleine ou serveur FTP injoignable
+void send_service_unavailable(httpd_req_t* req, uint32_t retry_after_s, const char* message) {
+  char retry_after[12];
+  snprintf(retry_after, sizeof(retry_after), "%u", (unsigned) std::max<uint32_t>(retry_after_s, 1));
+  httpd_resp_set_status(req, "503 Service Unavailable");
+  httpd_resp_set_type(req, "text/plain");
+  httpd_resp_set_hdr(req, "Retry-After", retry_after);
+  httpd_resp_sendstr(req, message);
+}
+
+// httpd_send peut n'envoyer qu'une partie du buffer
+bool send_all(httpd_req_t* req, const char* data, size_t len) {
+  while (len > 0) {
+    int sent = httpd_send(req, data, len);
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    len -= sent;
+  }
+  return true;
+}
+
+// En-têtes bruts d'une réponse de longueur connue (aussi envoyés tels quels aux clients rattachés)
+std::string format_fixed_length_head(const HttpResponseHead &head, int64_t content_length) {
+  std::string out;
+  out.reserve(256);
+  out += "HTTP/1.1 ";
+  out += head.status;
+  out += "\r\nContent-Type: ";
+  out += head.content_type;
+  out += "\r\nContent-Length: ";
+  out += std::to_string(content_length);
+  out += "\r\nAccept-Ranges: bytes\r\n";
+  if (head.content_range[0] != '\0') {
+    out += "Content-Range: ";
+    out += head.content_range;
+    out += "\r\n";
+  }
+  if (head.last_modified[0] != '\0') {
+    out += "Last-Modified: ";
+    out += head.last_modified;
+    out += "\r\n";
+  }
+  if (head.etag[0] != '\0') {
+    out += "ETag: ";
+    out += head.etag;
+    out += "\r\n";
+  }
+  if (head.content_disposition[0] != '\0') {
+    out += "Content-Disposition: ";
+    out += head.content_disposition;
+    out += "\r\n";
+  }
+  out += "\r\n";
+  return out;
+}
+
+bool send_fixed_length_head(httpd_req_t* req, const HttpResponseHead &head, int64_t content_length) {
+  std::string out = format_fixed_length_head(head, content_length);
+  return send_all(req, out.data(), out.size());
+}
+
+// Les valeurs pointées par head doivent rester valides jusqu'au premier chunk
+void apply_chunked_head(httpd_req_t* req, const HttpResponseHead &head) {
+  httpd_resp_set_status(req, head.status);
+  httpd_resp_set_type(req, head.content_type);
+  httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+  if (head.content_range[0] != '\0') {
+    httpd_resp_set_hdr(req, "Content-Range", head.content_range);
+  }
+  if (head.last_modified[0] != '\0') {
+    httpd_resp_set_hdr(req, "Last-Modified", head.last_modified);
+  }
+  if (head.etag[0] != '\0') {
+    httpd_resp_set_hdr(req, "ETag", head.etag);
+  }
+  if (head.content_disposition[0] != '\0') {
+    httpd_resp_set_hdr(req, "Content-Disposition", head.content_disposition);
+  }
+}
+
+// ETag fort dérivé du chemin, de la taille et de la date MDTM; sans MDTM, seul Last-Modified manque
+void set_validators(HttpResponseHead &head, const std::string &path, int64_t size, time_t modified) {
+  head.last_modified[0] = '\0';
+  head.etag[0] = '\0';
+  if (modified != 0) {
+    format_http_date(modified, head.last_modified, sizeof(head.last_modified));
+  }
+  if (size >= 0 && modified != 0) {
+    snprintf(head.etag, sizeof(head.etag), "\"%08x-%llx-%llx\"", (unsigned) StringHash()(path),
+             (unsigned long long) size, (unsigned long long) modified);
+  }
+}
+
+// Date HTTP au format IMF-fixdate (seul format émis par les navigateurs actuels)
+bool parse_http_date(const char* value, time_t &out) {
+  static const char* const MONTHS = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char month_name[4];
+  int day, year, hour, minute, second;
+  if (sscanf(value, "%*3s, %d %3s %d %d:%d:%d", &day, month_name, &year, &hour, &minute, &second) != 6) {
+    return false;
+  }
+  const char* pos = strstr(MONTHS, month_name);
+  if (pos == nullptr || (pos - MONTHS) % 3 != 0) {
+    return false;
+  }
+  unsigned month = (pos - MONTHS) / 3 + 1;
+  out = (time_t) (days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second);
+  return true;
+}
+
+// Évalue If-None-Match (prioritaire) puis If-Modified-Since (RFC 7232)
+bool is_not_modified(const FileTransferContext* ctx, const HttpResponseHead &head, time_t modified) {
+  if (!ctx->if_none_match.empty()) {
+    if (head.etag[0] == '\0') {
+      return false;
+    }
+    if (ctx->if_none_match == "*") {
+      return true;
+    }
+    // Liste d'ETags séparés par des virgules; comparaison faible (préfixe W/ ignoré)
+    size_t start = 0;
+    while (start < ctx->if_none_match.size()) {
+      size_t end = ctx->if_none_match.find(',', start);
+      if (end == std::string::npos) {
+        end = ctx->if_none_match.size();
+      }
+      std::string tag = ctx->if_none_match.substr(start, end - start);
+      size_t first = tag.find_first_not_of(" \t");
+      if (first != std::string::npos) {
+        tag = tag.substr(first);
+        if (tag.compare(0, 2, "W/") == 0) {
+          tag = tag.substr(2);
+        }
+        tag = tag.substr(0, tag.find_last_not_of(" \t") + 1);
+        if (tag == head.etag) {
+          return true;
+        }
+      }
+      start = end + 1;
+    }
+    return false;
+  }
+  return ctx->if_modified_since != 0 && modified != 0 && modified <= ctx->if_modified_since;
+}
+
+bool send_not_modified(httpd_req_t* req, const HttpResponseHead &head) {
+  std::string out = "HTTP/1.1 304 Not Modified\r\n";
+  if (head.etag[0] != '\0') {
+    out += "ETag: ";
+    out += head.etag;
+    out += "\r\n";
+  }
+  if (head.last_modified[0] != '\0') {
+    out += "Last-Modified: ";
+    out += head.last_modified;
+    out += "\r\n";
+  }
+  out += "\r\n";
+  return send_all(req, out.data(), out.size());
+}
+
+void set_partial_content(HttpResponseHead &head, int64_t first, int64_t last, int64_t file_size) {
+  if (file_size >= 0) {
+    snprintf(head.content_range, sizeof(head.content_range), "bytes %lld-%lld/%lld", (long long) first,
+             (long long) last, (long long) file_size);
+  } else {
+    snprintf(head.content_range, sizeof(head.content_range), "bytes %lld-%lld/*", (long long) first,
+             (long long) last);
+  }
+  head.status = "206 Partial Content";
+}
+
+// Convertit la plage demandée en (offset, longueur). file_size vaut -1 si SIZE n'est pas supporté;
+// longueur -1 signifie "jusqu'à la fin du fichier".
+RangeResult resolve_range(const FileTransferContext* ctx, int64_t file_size,
+                          int64_t &offset, int64_t &length) {
+  offset = 0;
+  length = -1;
+  if (!ctx->has_range) {
+    return RANGE_NONE;
+  }
+
+  int64_t start = ctx->range_start;
+  int64_t end = ctx->range_end;
+  if (start < 0) {
+    if (file_size < 0) {
+      return RANGE_NONE;
+    }
+    start = end >= file_size ? 0 : file_size - end;
+    end = file_size - 1;
+  } else if (end < 0 || (file_size >= 0 && end >= file_size)) {
+    if (file_size < 0) {
+      return RANGE_NONE;
+    }
+    end = file_size - 1;
+  }
+
+  if (file_size >= 0 && start >= file_size) {
+    return RANGE_UNSATISFIABLE;
+  }
+
+  offset = start;
+  // Une plage qui s'arrête au dernier octet se lit jusqu'à EOF, sans coupure anticipée
+  length = (file_size >= 0 && end == file_size - 1) ? -1 : end - start + 1;
+  return RANGE_OK;
+}
+
+bool receive_upload_body(httpd_req_t* req, char* buffer, size_t buffer_size, const UploadSink &sink, size_t &bytes) {
+  size_t remaining = req->content_len - bytes;
+  // Chaque bloc reçu du client est écrit en entier par sink avant le suivant
+  while (remaining > 0) {
+    int received = httpd_req_recv(req, buffer, std::min(remaining, buffer_size));
+    if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+      continue;
+    }
+    if (received <= 0) {
+      ESP_LOGE(TAG, "Réception du corps interrompue après %u octets", (unsigned) bytes);
+      return false;
+    }
+    if (!sink(buffer, received)) {
+      return false;
+    }
+    remaining -= received;
+    bytes += received;
+    proxy_metrics().bytes_uploaded += received;
+  }
+  return true;
+}
+
+void finish_upload(FileTransferContext* ctx, bool success, size_t bytes, int64_t start_time,
+                   const char* failure_message) {
+  httpd_req_t* req = ctx->req;
+  if (!success) {
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, failure_message);
+    if (bytes < req->content_len) {
+      // Corps non consommé: la connexion client ne peut pas servir d'autre requête
+      httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
+    }
+    return;
+  }
+
+  int64_t elapsed_ms = std::max<int64_t>((esp_timer_get_time() - start_time) / 1000, 1);
+  unsigned kbps = (unsigned) (bytes * 1000 / 1024 / elapsed_ms);
+  ESP_LOGI(TAG, "Envoi terminé (%s): %s, %u octets en %lld ms (%u Ko/s)", ctx->backend->name(),
+           ctx->remote_path.c_str(), (unsigned) bytes, (long long) elapsed_ms, kbps);
+
+  char json[160];
+  snprintf(json, sizeof(json), "{\"success\": true, \"bytes\": %u, \"duration_ms\": %lld, \"kbps\": %u}",
+           (unsigned) bytes, (long long) elapsed_ms, kbps);
+  httpd_resp_set_status(req, ctx->append ? "200 OK" : "201 Created");
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_sendstr(req, json);
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <esp_http_server.h>
+#include "mime_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+struct FileTransferContext;
+
+// En-têtes de la réponse d'un téléchargement, envoyés soit bruts (Content-Length connu),
+// soit via httpd en mode chunked
+struct HttpResponseHead {
+  const char* status = "200 OK";
+  const char* content_type = "application/octet-stream";
+  uint8_t mime_policy = MIME_DEFAULT.policy;
+  char content_disposition[288] = "";  // Nom de fichier FTP (255 octets max) compris
+  char content_range[64] = "";
+  char last_modified[32] = "";
+  char etag[48] = "";
+};
+
+enum RangeResult { RANGE_NONE, RANGE_OK, RANGE_UNSATISFIABLE };
+
+// Analyse un en-tête "Range: bytes=..." à plage unique.
+// Les plages multiples sont ignorées: on sert alors le fichier complet (RFC 7233 l'autorise).
+bool parse_range_header(const char* value, int64_t &start, int64_t &end);
+
+// Convertit la plage demandée en (offset, longueur). file_size vaut -1 si la taille est inconnue;
+// longueur -1 signifie "jusqu'à la fin du fichier".
+RangeResult resolve_range(const FileTransferContext* ctx, int64_t file_size, int64_t &offset, int64_t &length);
+void set_partial_content(HttpResponseHead &head, int64_t first, int64_t last, int64_t file_size);
+
+// Format IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT"
+void format_http_date(time_t t, char* out, size_t out_size);
+bool parse_http_date(const char* value, time_t &out);
+
+// Type MIME et politique d'après l'extension; les types non affichables sont proposés en téléchargement
+void set_content_type(HttpResponseHead &head, const std::string &path);
+// ETag fort dérivé du chemin, de la taille et de la date de modification
+void set_validators(HttpResponseHead &head, const std::string &path, int64_t size, time_t modified);
+// Évalue If-None-Match (prioritaire) puis If-Modified-Since (RFC 7232)
+bool is_not_modified(const FileTransferContext* ctx, const HttpResponseHead &head, time_t modified);
+
+bool send_all(httpd_req_t* req, const char* data, size_t len);
+// En-têtes bruts d'une réponse de longueur connue (aussi envoyés tels quels aux clients rattachés)
+std::string format_fixed_length_head(const HttpResponseHead &head, int64_t content_length);
+bool send_fixed_length_head(httpd_req_t* req, const HttpResponseHead &head, int64_t content_length);
+// Les valeurs pointées par head doivent rester valides jusqu'au premier chunk
+void apply_chunked_head(httpd_req_t* req, const HttpResponseHead &head);
+bool send_not_modified(httpd_req_t* req, const HttpResponseHead &head);
+void send_range_not_satisfiable(httpd_req_t* req, HttpResponseHead &head, int64_t file_size);
+// 503 avec Retry-After: file pleine ou serveur FTP injoignable
+void send_service_unavailable(httpd_req_t* req, uint32_t retry_after_s, const char* message);
+
+// Destination du corps d'un envoi PUT/POST; retourne false pour interrompre la réception
+using UploadSink = std::function<bool(const char* data, size_t len)>;
+
+// Lit le corps de la requête par blocs de buffer_size et les passe à sink dans l'ordre.
+// bytes: octets reçus et acceptés; false si la réception ou sink échoue.
+bool receive_upload_body(httpd_req_t* req, char* buffer, size_t buffer_size, const UploadSink &sink, size_t &bytes);
+
+// Réponse d'un envoi, commune aux backends. Succès: JSON {success, bytes, duration_ms, kbps} en 201
+// (200 pour un ajout). Échec: 500 avec message, connexion fermée si le corps n'a pas été lu en entier.
+void finish_upload(FileTransferContext* ctx, bool success, size_t bytes, int64_t start_time,
+                   const char* failure_message);
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,153 @@
+#include "local_storage.h"
+#include "ftp_http_proxy.h"
+#include "http_response.h"
+#include "metrics.h"
+#include "relay_engine.h"
+#include "esphome/core/log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const char *TAG = "ftp_proxy.local";
+
+// Blocs écrits sur la carte SD: multiple de la taille d'un secteur et d'un cluster FAT courant
+static const size_t UPLOAD_CHUNK_SIZE = 4096;
+
+bool LocalStorage::matches(const std::string &path) const {
+  return path.compare(0, prefix_.size(), prefix_) == 0 &&
+         (path.size() == prefix_.size() || path[prefix_.size()] == '/');
+}
+
+bool LocalStorage::resolve(const std::string &path, std::string &local) const {
+  std::string relative = path.substr(prefix_.size());
+  // Aucun segment ".." : la requête ne doit pas remonter au-dessus de la racine du mount
+  for (size_t start = 0; start <= relative.size();) {
+    size_t end = relative.find('/', start);
+    if (end == std::string::npos) {
+      end = relative.size();
+    }
+    if (relative.compare(start, end - start, "..") == 0) {
+      return false;
+    }
+    start = end + 1;
+  }
+  local = root_ + relative;
+  return true;
+}
+
+void LocalStorage::download(FileTransferContext *ctx, RelayEngine &relay) {
+  httpd_req_t *req = ctx->req;
+  std::string local;
+  struct stat st;
+  if (!resolve(ctx->remote_path, local) || stat(local.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    ESP_LOGW(TAG, "Fichier local introuvable: %s", ctx->remote_path.c_str());
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Fichier non trouvé");
+    return;
+  }
+
+  HttpResponseHead head;
+  set_content_type(head, ctx->remote_path);
+  set_validators(head, ctx->remote_path, st.st_size, st.st_mtime);
+  if (is_not_modified(ctx, head, st.st_mtime)) {
+    send_not_modified(req, head);
+    return;
+  }
+
+  int64_t offset, length;
+  RangeResult range = resolve_range(ctx, st.st_size, offset, length);
+  if (range == RANGE_UNSATISFIABLE) {
+    send_range_not_satisfiable(req, head, st.st_size);
+    return;
+  }
+  if (length < 0) {
+    length = st.st_size - offset;
+  }
+  if (range == RANGE_OK) {
+    set_partial_content(head, offset, offset + length - 1, st.st_size);
+  }
+
+  int fd = open(local.c_str(), O_RDONLY);
+  if (fd < 0) {
+    ESP_LOGE(TAG, "Ouverture de %s impossible: %d", local.c_str(), errno);
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Lecture du fichier impossible");
+    return;
+  }
+  // Plage: positionnement direct, sans rien lire de ce qui précède
+  if (offset > 0 && lseek(fd, offset, SEEK_SET) != offset) {
+    ESP_LOGE(TAG, "Positionnement à %lld impossible dans %s", (long long) offset, local.c_str());
+    close(fd);
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Lecture du fichier impossible");
+    return;
+  }
+
+  int64_t start_time = esp_timer_get_time();
+  if (!send_fixed_length_head(req, head, length)) {
+    close(fd);
+    httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
+    return;
+  }
+  RelayResult result = relay.run_file_to_socket(fd, offset, httpd_req_to_sockfd(req), length,
+                                                (head.mime_policy & MIME_READ_AHEAD) != 0,
+                                                [](size_t len) { proxy_metrics().bytes_relayed += len; });
+  close(fd);
+
+  if ((int64_t) result.bytes != length) {
+    // Content-Length déjà annoncé: seule la fermeture signale au client un corps incomplet
+    ESP_LOGW(TAG, "Envoi de %s interrompu après %u/%lld octets (%s)", ctx->remote_path.c_str(),
+             (unsigned) result.bytes, (long long) length,
+             result.status == RELAY_SINK_ERROR ? "client déconnecté" : "erreur de lecture");
+    httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
+    return;
+  }
+
+  int64_t elapsed_ms = std::max<int64_t>((esp_timer_get_time() - start_time) / 1000, 1);
+  ESP_LOGI(TAG, "Servi depuis %s: %s, %lld octets en %lld ms (%u Ko/s)", root_.c_str(), ctx->remote_path.c_str(),
+           (long long) length, (long long) elapsed_ms, (unsigned) (length * 1000 / 1024 / elapsed_ms));
+}
+
+void LocalStorage::upload(FileTransferContext *ctx) {
+  size_t total_bytes = 0;
+  int64_t start_time = esp_timer_get_time();
+  bool success = false;
+  int fd = -1;
+
+  std::string local;
+  char *chunk = (char *) heap_caps_malloc(UPLOAD_CHUNK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (chunk == nullptr) {
+    ESP_LOGE(TAG, "Échec d'allocation du buffer d'écriture");
+  } else if (!resolve(ctx->remote_path, local)) {
+    ESP_LOGW(TAG, "Chemin hors du mount refusé: %s", ctx->remote_path.c_str());
+  } else if ((fd = open(local.c_str(), O_WRONLY | O_CREAT | (ctx->append ? O_APPEND : O_TRUNC), 0644)) < 0) {
+    ESP_LOGE(TAG, "Création de %s impossible: %d", local.c_str(), errno);
+  } else {
+    success = receive_upload_body(ctx->req, chunk, UPLOAD_CHUNK_SIZE, [&](const char *data, size_t len) {
+      for (size_t offset = 0; offset < len;) {
+        ssize_t written = write(fd, data + offset, len - offset);
+        if (written <= 0) {
+          ESP_LOGE(TAG, "Erreur d'écriture dans %s: %d", local.c_str(), errno);
+          return false;
+        }
+        offset += written;
+      }
+      return true;
+    }, total_bytes);
+    // Données encore en tampon dans le pilote: l'échec de close() est un échec d'écriture
+    if (close(fd) != 0) {
+      success = false;
+    }
+  }
+  heap_caps_free(chunk);
+
+  finish_upload(ctx, success, total_bytes, start_time, "Échec de l'écriture du fichier local");
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
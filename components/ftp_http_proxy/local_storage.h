@@ -0,0 +1,35 @@
+#pragma once
+
+#include "storage_backend.h"
+#include <string>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+/* Fichiers d'un système de fichiers monté dans le VFS (carte SD, LittleFS), servis sous un
+ * préfixe d'URL: "<prefix>/a/b.mp4" correspond à "<root>/a/b.mp4". Aucun échange réseau hors
+ * du client; une plage demandée se résout par un simple lseek(). */
+class LocalStorage : public StorageBackend {
+ public:
+  // prefix sans '/' initial ni final ("sd"), root sans '/' final ("/sdcard")
+  LocalStorage(const std::string &prefix, const std::string &root) : prefix_(prefix), root_(root) {}
+
+  const char *name() const override { return "local"; }
+  const std::string &prefix() const { return prefix_; }
+  const std::string &root() const { return root_; }
+  // Le chemin demandé (sans '/' initial) est sous ce mount
+  bool matches(const std::string &path) const;
+
+  void download(FileTransferContext *ctx, RelayEngine &relay) override;
+  void upload(FileTransferContext *ctx) override;
+
+ protected:
+  // Chemin VFS d'une requête; false si elle sort de la racine ("..")
+  bool resolve(const std::string &path, std::string &local) const;
+
+  std::string prefix_;
+  std::string root_;
+};
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
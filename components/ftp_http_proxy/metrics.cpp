@@ -0,0 +1,68 @@
+#include "metrics.h"
+#include <cstdio>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+const uint32_t LatencyHistogram::BUCKET_BOUNDS_MS[BUCKET_COUNT] = {1,   5,    10,   25,   50,   100,
+                                                                   250, 500, 1000, 2500, 5000, 10000};
+
+void LatencyHistogram::record_us(uint32_t duration_us) {
+  uint32_t duration_ms = duration_us / 1000;
+  size_t bucket = 0;
+  while (bucket < BUCKET_COUNT && duration_ms > BUCKET_BOUNDS_MS[bucket]) {
+    bucket++;
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_ms_.fetch_add(duration_ms, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::render(std::string &out, const char *name, const char *stage) const {
+  char line[128];
+  uint32_t cumulative = 0;
+  for (size_t i = 0; i <= BUCKET_COUNT; i++) {
+    cumulative += buckets_[i].load(std::memory_order_relaxed);
+    if (i < BUCKET_COUNT) {
+      snprintf(line, sizeof(line), "%s_bucket{stage=\"%s\",le=\"%u.%03u\"} %u\n", name, stage,
+               (unsigned) (BUCKET_BOUNDS_MS[i] / 1000), (unsigned) (BUCKET_BOUNDS_MS[i] % 1000), (unsigned) cumulative);
+    } else {
+      snprintf(line, sizeof(line), "%s_bucket{stage=\"%s\",le=\"+Inf\"} %u\n", name, stage, (unsigned) cumulative);
+    }
+    out += line;
+  }
+  uint32_t sum_ms = sum_ms_.load(std::memory_order_relaxed);
+  snprintf(line, sizeof(line), "%s_sum{stage=\"%s\"} %u.%03u\n", name, stage, (unsigned) (sum_ms / 1000),
+           (unsigned) (sum_ms % 1000));
+  out += line;
+  snprintf(line, sizeof(line), "%s_count{stage=\"%s\"} %u\n", name, stage,
+           (unsigned) count_.load(std::memory_order_relaxed));
+  out += line;
+}
+
+void ProxyMetrics::record_ftp_error(int code) {
+  if (code < 400 || code >= 600) {
+    return;
+  }
+  ftp_errors_[code - 400].fetch_add(1, std::memory_order_relaxed);
+  ftp_errors_total.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ProxyMetrics::render_ftp_errors(std::string &out) const {
+  char line[80];
+  for (int i = 0; i < 200; i++) {
+    uint32_t count = ftp_errors_[i].load(std::memory_order_relaxed);
+    if (count > 0) {
+      snprintf(line, sizeof(line), "ftp_proxy_ftp_errors_total{code=\"%d\"} %u\n", i + 400, (unsigned) count);
+      out += line;
+    }
+  }
+}
+
+ProxyMetrics &proxy_metrics() {
+  static ProxyMetrics metrics;
+  return metrics;
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+/* Histogramme de latences à seaux fixes. Compteurs atomiques uniquement: un enregistrement
+ * coûte deux ou trois incréments, sans verrou, depuis n'importe quelle tâche. */
+class LatencyHistogram {
+ public:
+  static const size_t BUCKET_COUNT = 12;
+  static const uint32_t BUCKET_BOUNDS_MS[BUCKET_COUNT];
+
+  void record_us(uint32_t duration_us);
+  // Ajoute les lignes _bucket/_sum/_count au format texte Prometheus
+  void render(std::string &out, const char *name, const char *stage) const;
+
+ protected:
+  std::atomic<uint32_t> buckets_[BUCKET_COUNT + 1]{};  // Dernier seau: au-delà de la dernière borne
+  std::atomic<uint32_t> sum_ms_{0};
+  std::atomic<uint32_t> count_{0};
+};
+
+/* Compteurs du proxy. Les compteurs d'octets sont sur 32 bits (atomiques sans verrou sur ESP32)
+ * et reviennent à zéro après 4 Gio, ce que rate() de Prometheus traite comme une remise à zéro. */
+struct ProxyMetrics {
+  std::atomic<uint32_t> active_transfers{0};
+  std::atomic<uint32_t> transfers_total{0};
+  std::atomic<uint32_t> bytes_relayed{0};
+  std::atomic<uint32_t> bytes_uploaded{0};
+  std::atomic<uint32_t> ftp_errors_total{0};
+  std::atomic<uint32_t> ftp_logins{0};  // Sessions FTP ouvertes (hors réutilisation du pool)
+  std::atomic<uint32_t> coalesced_requests{0};  // Requêtes servies par le téléchargement d'un autre client
+  std::atomic<uint32_t> coalesce_detached{0};   // Clients trop lents repassés sur leur propre téléchargement
+
+  // Étapes d'un transfert
+  LatencyHistogram dns;
+  LatencyHistogram connect;
+  LatencyHistogram login;
+  LatencyHistogram pasv;
+  LatencyHistogram first_byte;  // RETR envoyé -> premier octet transmis au client
+  LatencyHistogram transfer;    // Durée totale de la requête dans le worker
+
+  void record_ftp_error(int code);
+  // Lignes ftp_proxy_ftp_errors_total{code="..."} pour les codes déjà rencontrés
+  void render_ftp_errors(std::string &out) const;
+
+ protected:
+  // Réponses 4xx et 5xx, indexées par code - 400
+  std::atomic<uint32_t> ftp_errors_[200]{};
+};
+
+// Instance unique, partagée par le client FTP, les workers et le handler /api/metrics
+ProxyMetrics &proxy_metrics();
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,24 @@
+#include "mime_types.h"
+#include <cstring>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+const MimeType &lookup_mime_type(const char *path) {
+  const char *dot = strrchr(path, '.');
+  const char *slash = strrchr(path, '/');
+  if (dot == nullptr || (slash != nullptr && dot < slash)) {
+    return MIME_DEFAULT;
+  }
+  const char *ext = dot + 1;
+  const char *end = ext + strlen(ext);
+
+  const MimeType *found = find_mime_type(MIME_TYPES_EXTRA, MIME_TYPES_EXTRA_COUNT, ext, end);
+  if (found == nullptr) {
+    found = find_mime_type(MIME_TABLE, MIME_TABLE_SIZE, ext, end);
+  }
+  return found != nullptr ? *found : MIME_DEFAULT;
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
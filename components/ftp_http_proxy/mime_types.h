@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+// Politique de service associée à un type
+enum MimePolicy : uint8_t {
+  MIME_INLINE = 1 << 0,      // Affiché par le navigateur; sinon Content-Disposition: attachment
+  MIME_CACHEABLE = 1 << 1,   // Peut entrer dans le cache de fichiers en RAM
+  MIME_READ_AHEAD = 1 << 2,  // Flux audio/vidéo: lecture anticipée (read_ahead_size)
+};
+
+struct MimeType {
+  const char *extension;  // Sans le point, en minuscules
+  const char *type;
+  uint8_t policy;
+};
+
+// Extensions inconnues: proposées en téléchargement
+constexpr MimeType MIME_DEFAULT = {"", "application/octet-stream", MIME_CACHEABLE};
+
+/* Table intégrée, triée par extension pour une recherche dichotomique (vérifié à la compilation).
+ * Le HTML et le SVG restent en téléchargement: affichés inline, ils exécuteraient leurs scripts
+ * avec l'origine du proxy. */
+constexpr MimeType MIME_TABLE[] = {
+    {"7z", "application/x-7z-compressed", 0},
+    {"aac", "audio/aac", MIME_INLINE | MIME_CACHEABLE | MIME_READ_AHEAD},
+    {"avi", "video/x-msvideo", MIME_INLINE | MIME_READ_AHEAD},
+    {"bmp", "image/bmp", MIME_INLINE | MIME_CACHEABLE},
+    {"css", "text/css", MIME_INLINE | MIME_CACHEABLE},
+    {"csv", "text/csv", MIME_INLINE | MIME_CACHEABLE},
+    {"doc", "application/msword", MIME_CACHEABLE},
+    {"docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document", MIME_CACHEABLE},
+    {"epub", "application/epub+zip", MIME_CACHEABLE},
+    {"flac", "audio/flac", MIME_INLINE | MIME_CACHEABLE | MIME_READ_AHEAD},
+    {"gif", "image/gif", MIME_INLINE | MIME_CACHEABLE},
+    {"gz", "application/gzip", 0},
+    {"htm", "text/html", MIME_CACHEABLE},
+    {"html", "text/html", MIME_CACHEABLE},
+    {"ico", "image/x-icon", MIME_INLINE | MIME_CACHEABLE},
+    {"jpeg", "image/jpeg", MIME_INLINE | MIME_CACHEABLE},
+    {"jpg", "image/jpeg", MIME_INLINE | MIME_CACHEABLE},
+    {"json", "application/json", MIME_INLINE | MIME_CACHEABLE},
+    {"m4a", "audio/mp4", MIME_INLINE | MIME_CACHEABLE | MIME_READ_AHEAD},
+    {"m4v", "video/mp4", MIME_INLINE | MIME_READ_AHEAD},
+    {"mkv", "video/x-matroska", MIME_INLINE | MIME_READ_AHEAD},
+    {"mov", "video/quicktime", MIME_INLINE | MIME_READ_AHEAD},
+    {"mp3", "audio/mpeg", MIME_INLINE | MIME_CACHEABLE | MIME_READ_AHEAD},
+    {"mp4", "video/mp4", MIME_INLINE | MIME_READ_AHEAD},
+    {"odp", "application/vnd.oasis.opendocument.presentation", MIME_CACHEABLE},
+    {"ods", "application/vnd.oasis.opendocument.spreadsheet", MIME_CACHEABLE},
+    {"odt", "application/vnd.oasis.opendocument.text", MIME_CACHEABLE},
+    {"ogg", "audio/ogg", MIME_INLINE | MIME_CACHEABLE | MIME_READ_AHEAD},
+    {"opus", "audio/ogg", MIME_INLINE | MIME_CACHEABLE | MIME_READ_AHEAD},
+    {"pdf", "application/pdf", MIME_INLINE | MIME_CACHEABLE},
+    {"png", "image/png", MIME_INLINE | MIME_CACHEABLE},
+    {"ppt", "application/vnd.ms-powerpoint", MIME_CACHEABLE},
+    {"pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation", MIME_CACHEABLE},
+    {"rar", "application/vnd.rar", 0},
+    {"svg", "image/svg+xml", MIME_CACHEABLE},
+    {"tar", "application/x-tar", 0},
+    {"txt", "text/plain", MIME_INLINE | MIME_CACHEABLE},
+    {"wav", "audio/wav", MIME_INLINE | MIME_CACHEABLE | MIME_READ_AHEAD},
+    {"webm", "video/webm", MIME_INLINE | MIME_READ_AHEAD},
+    {"webp", "image/webp", MIME_INLINE | MIME_CACHEABLE},
+    {"xls", "application/vnd.ms-excel", MIME_CACHEABLE},
+    {"xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet", MIME_CACHEABLE},
+    {"xml", "application/xml", MIME_CACHEABLE},
+    {"zip", "application/zip", 0},
+};
+constexpr size_t MIME_TABLE_SIZE = sizeof(MIME_TABLE) / sizeof(MIME_TABLE[0]);
+
+// Types ajoutés par la configuration (mime_types:), générés triés par __init__.py.
+// Ils sont consultés avant la table intégrée et peuvent donc en remplacer une entrée.
+extern const MimeType MIME_TYPES_EXTRA[];
+extern const size_t MIME_TYPES_EXTRA_COUNT;
+
+constexpr char mime_lower(char c) { return (c >= 'A' && c <= 'Z') ? (char) (c - 'A' + 'a') : c; }
+
+// Compare l'extension d'un chemin [ext, end) (casse ignorée) à une extension de la table
+constexpr int mime_compare(const char *ext, const char *end, const char *key) {
+  for (; ext != end && *key != '\0'; ext++, key++) {
+    char c = mime_lower(*ext);
+    if (c != *key) {
+      return (unsigned char) c < (unsigned char) *key ? -1 : 1;
+    }
+  }
+  if (ext != end) {
+    return 1;
+  }
+  return *key == '\0' ? 0 : -1;
+}
+
+constexpr size_t mime_length(const char *s) {
+  size_t len = 0;
+  while (s[len] != '\0') {
+    len++;
+  }
+  return len;
+}
+
+// Recherche dichotomique dans une table triée; nullptr si l'extension est absente
+constexpr const MimeType *find_mime_type(const MimeType *table, size_t count, const char *ext, const char *end) {
+  size_t low = 0;
+  size_t high = count;
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    int cmp = mime_compare(ext, end, table[mid].extension);
+    if (cmp == 0) {
+      return &table[mid];
+    }
+    if (cmp < 0) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return nullptr;
+}
+
+constexpr bool mime_table_sorted(const MimeType *table, size_t count) {
+  for (size_t i = 1; i < count; i++) {
+    const char *prev = table[i - 1].extension;
+    if (mime_compare(prev, prev + mime_length(prev), table[i].extension) >= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(mime_table_sorted(MIME_TABLE, MIME_TABLE_SIZE), "MIME_TABLE doit rester triée par extension");
+
+// Type d'un chemin d'après son extension (après le dernier '.' du dernier segment), sans allocation
+const MimeType &lookup_mime_type(const char *path);
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
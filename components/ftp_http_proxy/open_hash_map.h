@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+// FNV-1a 32 bits: rapide et suffisant pour des chemins et des tokens
+struct StringHash {
+  uint32_t operator()(const std::string &key) const {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : key) {
+      h = (h ^ c) * 16777619u;
+    }
+    return h;
+  }
+};
+
+// Finaliseur de murmur3 pour les clés entières
+struct IntHash {
+  uint32_t operator()(uint32_t key) const {
+    key ^= key >> 16;
+    key *= 0x85ebca6bu;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35u;
+    key ^= key >> 16;
+    return key;
+  }
+};
+
+/* Table de hachage à adressage ouvert (sondage linéaire, capacité en puissance de 2).
+ * Les entrées sont stockées dans un seul tableau: pas d'allocation par élément. */
+template<typename K, typename V, typename Hash> class OpenHashMap {
+ public:
+  V *find(const K &key) {
+    if (slots_.empty()) {
+      return nullptr;
+    }
+    size_t index = probe(key);
+    return slots_[index].state == FULL ? &slots_[index].value : nullptr;
+  }
+
+  // Insère ou remplace la valeur associée à key
+  V &insert(const K &key, V value) {
+    if ((size_ + deleted_ + 1) * 10 > slots_.size() * 7) {
+      rehash(size_ * 2 >= slots_.size() ? slots_.size() * 2 : slots_.size());
+    }
+    size_t index = probe(key);
+    Slot &slot = slots_[index];
+    if (slot.state != FULL) {
+      if (slot.state == DELETED) {
+        deleted_--;
+      }
+      slot.key = key;
+      slot.state = FULL;
+      size_++;
+    }
+    slot.value = std::move(value);
+    return slot.value;
+  }
+
+  bool erase(const K &key) {
+    if (slots_.empty()) {
+      return false;
+    }
+    size_t index = probe(key);
+    if (slots_[index].state != FULL) {
+      return false;
+    }
+    slots_[index].state = DELETED;
+    slots_[index].key = K();
+    slots_[index].value = V();
+    size_--;
+    deleted_++;
+    return true;
+  }
+
+  size_t size() const { return size_; }
+
+  void clear() {
+    slots_.clear();
+    size_ = 0;
+    deleted_ = 0;
+  }
+
+  template<typename F> void for_each(F f) {
+    for (auto &slot : slots_) {
+      if (slot.state == FULL) {
+        f(slot.key, slot.value);
+      }
+    }
+  }
+
+ protected:
+  enum SlotState : uint8_t { EMPTY, FULL, DELETED };
+  struct Slot {
+    K key{};
+    V value{};
+    SlotState state{EMPTY};
+  };
+
+  // Retourne l'emplacement de key, sinon le premier emplacement libre rencontré
+  size_t probe(const K &key) const {
+    size_t mask = slots_.size() - 1;
+    size_t index = Hash()(key) & mask;
+    size_t first_deleted = SIZE_MAX;
+    while (true) {
+      const Slot &slot = slots_[index];
+      if (slot.state == EMPTY) {
+        return first_deleted != SIZE_MAX ? first_deleted : index;
+      }
+      if (slot.state == DELETED) {
+        if (first_deleted == SIZE_MAX) {
+          first_deleted = index;
+        }
+      } else if (slot.key == key) {
+        return index;
+      }
+      index = (index + 1) & mask;
+    }
+  }
+
+  void rehash(size_t capacity) {
+    if (capacity < 16) {
+      capacity = 16;
+    }
+    std::vector<Slot> old;
+    old.swap(slots_);
+    slots_.resize(capacity);
+    size_ = 0;
+    deleted_ = 0;
+    for (auto &slot : old) {
+      if (slot.state == FULL) {
+        size_t index = probe(slot.key);
+        slots_[index].key = std::move(slot.key);
+        slots_[index].value = std::move(slot.value);
+        slots_[index].state = FULL;
+        size_++;
+      }
+    }
+  }
+
+  std::vector<Slot> slots_;
+  size_t size_{0};
+  size_t deleted_{0};
+};
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
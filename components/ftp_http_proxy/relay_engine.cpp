@@ -0,0 +1,378 @@
+#include "relay_engine.h"
+#include "esphome/core/log.h"
+#ifdef USE_HOST
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#else
+#include <lwip/sockets.h>
+#include <unistd.h>
+#endif
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const char *TAG = "ftp_proxy.relay";
+
+// Codes de fin transmis dans Block::len par la tâche de lecture
+static const int BLOCK_EOF = 0;
+static const int BLOCK_ERROR = -1;
+static const int BLOCK_LIMIT = -2;
+static const int BLOCK_ABORTED = -3;
+
+// Ne céder le CPU que si aucune attente bloquante n'a eu lieu depuis une fraction
+// du délai du watchdog des tâches. Chaque attente effective (file vide, socket sans
+// données) a laissé tourner la tâche de repos et repart de zéro.
+#ifdef CONFIG_ESP_TASK_WDT_TIMEOUT_S
+static const int64_t YIELD_BUDGET_US = CONFIG_ESP_TASK_WDT_TIMEOUT_S * 1000000LL / 4;
+#else
+static const int64_t YIELD_BUDGET_US = 1000000LL;
+#endif
+
+bool RelayEngine::init(const char *name, size_t buffer_count, size_t buffer_size, bool use_psram,
+                       size_t read_ahead_count) {
+  buffer_count_ = buffer_count;
+  total_buffer_count_ = std::max(buffer_count, read_ahead_count);
+  buffer_size_ = buffer_size;
+
+  free_blocks_ = xQueueCreate(total_buffer_count_, sizeof(Block));
+  full_blocks_ = xQueueCreate(total_buffer_count_, sizeof(Block));
+  if (free_blocks_ == nullptr || full_blocks_ == nullptr) {
+    ESP_LOGE(TAG, "Échec de création des files du relais");
+    return false;
+  }
+
+  bool psram = use_psram && heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0;
+  uint32_t caps = psram ? MALLOC_CAP_SPIRAM : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  for (size_t i = 0; i < total_buffer_count_; i++) {
+    Block block = {(char *) heap_caps_malloc(buffer_size, caps), 0};
+    if (block.data == nullptr) {
+      ESP_LOGE(TAG, "Échec d'allocation du buffer de relais %u", (unsigned) i);
+      return false;
+    }
+    xQueueSend(free_blocks_, &block, 0);
+  }
+
+  BaseType_t task_created = xTaskCreatePinnedToCore(reader_task, name, 4096, this, tskIDLE_PRIORITY + 1,
+                                                    &reader_, tskNO_AFFINITY);
+  if (task_created != pdPASS) {
+    ESP_LOGE(TAG, "Échec de création de la tâche de lecture %s", name);
+    return false;
+  }
+
+  ESP_LOGD(TAG, "Relais %s: %u buffers de %u octets en %s (%u en lecture anticipée)", name, (unsigned) buffer_count,
+           (unsigned) buffer_size, psram ? "PSRAM" : "RAM interne", (unsigned) total_buffer_count_);
+  return true;
+}
+
+void RelayEngine::maybe_yield(int64_t &last_yield_us) {
+  int64_t now = esp_timer_get_time();
+  if (now - last_yield_us >= YIELD_BUDGET_US) {
+    vTaskDelay(1);
+    last_yield_us = esp_timer_get_time();
+  }
+}
+
+void RelayEngine::reader_task(void *param) {
+  auto *engine = (RelayEngine *) param;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    engine->read_job();
+  }
+}
+
+void RelayEngine::read_job() {
+  int64_t remaining = limit_;
+  int64_t last_yield = esp_timer_get_time();
+  Block block;
+
+  while (true) {
+    if (xQueueReceive(free_blocks_, &block, 0) != pdTRUE) {
+      xQueueReceive(free_blocks_, &block, portMAX_DELAY);
+      last_yield = esp_timer_get_time();
+    }
+    if (abort_) {
+      block.len = BLOCK_ABORTED;
+      break;
+    }
+    if (remaining == 0) {
+      block.len = BLOCK_LIMIT;
+      break;
+    }
+
+    size_t capacity = buffer_size_;
+    if (source_file_ && first_capacity_ > 0) {
+      capacity = first_capacity_;
+      first_capacity_ = 0;
+    }
+    if (remaining > 0 && remaining < (int64_t) capacity) {
+      capacity = (size_t) remaining;
+    }
+
+    if (source_file_) {
+      // Lecture du VFS: bloquante et complète sauf en fin de fichier
+      int got = read(source_sock_, block.data, capacity);
+      if (got <= 0) {
+        if (got < 0) {
+          ESP_LOGE(TAG, "Erreur de lecture du fichier: %d", errno);
+        }
+        block.len = got < 0 ? BLOCK_ERROR : (abort_ ? BLOCK_ABORTED : BLOCK_EOF);
+        break;
+      }
+      block.len = got;
+      if (remaining > 0) {
+        remaining -= got;
+      }
+      xQueueSend(full_blocks_, &block, portMAX_DELAY);
+      maybe_yield(last_yield);
+      continue;
+    }
+
+    // Première lecture bloquante s'il n'y a encore rien à lire, puis compléter le buffer avec
+    // ce qui est déjà arrivé
+    int received = recv(source_sock_, block.data, capacity, MSG_DONTWAIT);
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      received = recv(source_sock_, block.data, capacity, 0);
+      last_yield = esp_timer_get_time();
+    }
+    if (received <= 0) {
+      if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && !abort_) {
+        ESP_LOGE(TAG, "Erreur de réception des données: %d", errno);
+        block.len = BLOCK_ERROR;
+      } else {
+        block.len = abort_ ? BLOCK_ABORTED : BLOCK_EOF;
+      }
+      break;
+    }
+    size_t filled = received;
+    while (filled < capacity) {
+      received = recv(source_sock_, block.data + filled, capacity - filled, MSG_DONTWAIT);
+      if (received <= 0) {
+        break;
+      }
+      filled += received;
+    }
+
+    block.len = (int) filled;
+    if (remaining > 0) {
+      remaining -= filled;
+    }
+    xQueueSend(full_blocks_, &block, portMAX_DELAY);
+    maybe_yield(last_yield);
+  }
+
+  // Marqueur de fin: le consommateur sait que la tâche de lecture est à nouveau libre
+  xQueueSend(full_blocks_, &block, portMAX_DELAY);
+}
+
+RelayResult RelayEngine::run(int source_sock, int64_t limit, const RelaySink &sink, bool read_ahead) {
+  source_file_ = false;
+  return relay(source_sock, limit, sink, read_ahead);
+}
+
+RelayResult RelayEngine::relay(int source_sock, int64_t limit, const RelaySink &sink, bool read_ahead) {
+  RelayResult result = {RELAY_EOF, 0, 0, 0, 0, read_ahead ? total_buffer_count_ : buffer_count_, 0};
+
+  // Hors lecture anticipée, les buffers supplémentaires sont mis de côté: la tâche de lecture
+  // ne prend pas plus d'avance qu'avec un relais classique
+  std::vector<Block> parked;
+  Block block;
+  while (total_buffer_count_ - parked.size() > result.window &&
+         xQueueReceive(free_blocks_, &block, 0) == pdTRUE) {
+    parked.push_back(block);
+  }
+
+  source_sock_ = source_sock;
+  limit_ = limit;
+  abort_ = false;
+  xTaskNotifyGive(reader_);
+
+  bool sink_failed = false;
+  int64_t last_yield = esp_timer_get_time();
+
+  while (true) {
+    bool starved = xQueueReceive(full_blocks_, &block, 0) != pdTRUE;
+    if (starved) {
+      xQueueReceive(full_blocks_, &block, portMAX_DELAY);
+      last_yield = esp_timer_get_time();
+    }
+    if (block.len <= 0) {
+      if (!sink_failed) {
+        result.status = block.len == BLOCK_LIMIT   ? RELAY_LIMIT
+                        : block.len == BLOCK_ERROR ? RELAY_SOURCE_ERROR
+                                                   : RELAY_EOF;
+      }
+      xQueueSend(free_blocks_, &block, 0);
+      break;
+    }
+
+    if (!sink_failed) {
+      // Remplissage vu par l'envoi: le buffer en main plus ceux déjà prêts derrière lui
+      if (starved && result.bytes > 0) {
+        result.underruns++;
+      }
+      result.fill_sum += uxQueueMessagesWaiting(full_blocks_) + 1;
+      result.fill_samples++;
+      if (result.bytes == 0) {
+        result.first_data_us = esp_timer_get_time();
+      }
+
+      if (sink(block.data, block.len)) {
+        result.bytes += block.len;
+      } else {
+        // Débloquer la lecture en cours puis vider les buffers jusqu'au marqueur de fin
+        sink_failed = true;
+        result.status = RELAY_SINK_ERROR;
+        abort_ = true;
+        if (!source_file_) {
+          shutdown(source_sock, SHUT_RD);
+        }
+      }
+    }
+    xQueueSend(free_blocks_, &block, 0);
+    maybe_yield(last_yield);
+  }
+
+  for (auto &spare : parked) {
+    xQueueSend(free_blocks_, &spare, 0);
+  }
+  return result;
+}
+
+#ifdef USE_HOST
+// Capacité par défaut d'un tube Linux: chaque splice() déplace au plus cette quantité
+static const size_t SPLICE_CHUNK = 65536;
+
+// Les pages reçues passent du socket source au tube puis au socket destination dans le noyau
+static RelayResult splice_relay(int source_sock, int dest_sock, int64_t limit, const RelayProgress &progress) {
+  RelayResult result = {RELAY_EOF, 0, 0, 0, 0, 0, 0};
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) {
+    ESP_LOGE(TAG, "Échec de création du tube: %d", errno);
+    result.status = RELAY_SOURCE_ERROR;
+    return result;
+  }
+
+  while (limit < 0 || (int64_t) result.bytes < limit) {
+    size_t wanted = SPLICE_CHUNK;
+    if (limit >= 0) {
+      wanted = (size_t) std::min<int64_t>(wanted, limit - (int64_t) result.bytes);
+    }
+    ssize_t pending = splice(source_sock, nullptr, pipe_fds[1], nullptr, wanted, SPLICE_F_MOVE | SPLICE_F_MORE);
+    if (pending <= 0) {
+      if (pending < 0) {
+        ESP_LOGE(TAG, "Erreur de réception des données: %d", errno);
+        result.status = RELAY_SOURCE_ERROR;
+      }
+      break;
+    }
+    if (result.bytes == 0) {
+      result.first_data_us = esp_timer_get_time();
+    }
+    while (pending > 0) {
+      ssize_t sent = splice(pipe_fds[0], nullptr, dest_sock, nullptr, pending, SPLICE_F_MOVE | SPLICE_F_MORE);
+      if (sent <= 0) {
+        result.status = RELAY_SINK_ERROR;
+        shutdown(source_sock, SHUT_RD);
+        goto done;
+      }
+      pending -= sent;
+      result.bytes += sent;
+      if (progress) {
+        progress(sent);
+      }
+    }
+  }
+  if (limit >= 0 && (int64_t) result.bytes == limit) {
+    result.status = RELAY_LIMIT;
+  }
+
+done:
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  return result;
+}
+#endif
+
+#ifdef USE_HOST
+// Le noyau lit le fichier et l'envoie sur le socket sans passer par l'espace utilisateur
+static RelayResult sendfile_relay(int file_fd, int64_t offset, int dest_sock, int64_t limit,
+                                  const RelayProgress &progress) {
+  RelayResult result = {RELAY_EOF, 0, 0, 0, 0, 0, 0};
+  off_t position = offset;
+  while (limit < 0 || (int64_t) result.bytes < limit) {
+    size_t wanted = SPLICE_CHUNK;
+    if (limit >= 0) {
+      wanted = (size_t) std::min<int64_t>(wanted, limit - (int64_t) result.bytes);
+    }
+    ssize_t sent = sendfile(dest_sock, file_fd, &position, wanted);
+    if (sent <= 0) {
+      if (sent < 0) {
+        result.status = errno == EPIPE || errno == ECONNRESET ? RELAY_SINK_ERROR : RELAY_SOURCE_ERROR;
+      }
+      break;
+    }
+    if (result.bytes == 0) {
+      result.first_data_us = esp_timer_get_time();
+    }
+    result.bytes += sent;
+    if (progress) {
+      progress(sent);
+    }
+  }
+  if (limit >= 0 && (int64_t) result.bytes == limit) {
+    result.status = RELAY_LIMIT;
+  }
+  return result;
+}
+#else
+// Envoi brut sur un socket prêt à recevoir le corps
+static RelaySink socket_sink(int dest_sock, const RelayProgress &progress) {
+  return [dest_sock, &progress](const char *data, size_t len) {
+    while (len > 0) {
+      int sent = send(dest_sock, data, len, 0);
+      if (sent <= 0) {
+        return false;
+      }
+      if (progress) {
+        progress(sent);
+      }
+      data += sent;
+      len -= sent;
+    }
+    return true;
+  };
+}
+#endif
+
+#ifdef USE_HOST
+RelayResult RelayEngine::run_to_socket(int source_sock, int dest_sock, int64_t limit, const RelayProgress &progress) {
+  return splice_relay(source_sock, dest_sock, limit, progress);
+}
+#endif
+
+RelayResult RelayEngine::run_file_to_socket(int file_fd, int64_t offset, int dest_sock, int64_t limit,
+                                            bool read_ahead, const RelayProgress &progress) {
+#ifdef USE_HOST
+  (void) read_ahead;
+  return sendfile_relay(file_fd, offset, dest_sock, limit, progress);
+#else
+  // Les lectures suivantes commencent sur un multiple de la taille des buffers (et donc des
+  // secteurs FAT/SD): le pilote peut lire directement dans le buffer, sans tampon intermédiaire
+  source_file_ = true;
+  first_capacity_ = buffer_size_ - (size_t) (offset % (int64_t) buffer_size_);
+  RelayResult result = relay(file_fd, limit, socket_sink(dest_sock, progress), read_ahead);
+  source_file_ = false;
+  return result;
+#endif
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
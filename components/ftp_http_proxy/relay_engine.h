@@ -0,0 +1,91 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+// Destination des données relayées; retourne false pour interrompre le relais
+using RelaySink = std::function<bool(const char *data, size_t len)>;
+// Octets remis à la destination par un relais direct, bloc par bloc (métriques en direct)
+using RelayProgress = std::function<void(size_t len)>;
+
+enum RelayStatus {
+  RELAY_EOF,           // La source a fermé la connexion (fin de fichier)
+  RELAY_LIMIT,         // Le nombre d'octets demandé a été atteint
+  RELAY_SOURCE_ERROR,  // Erreur de réception sur la source
+  RELAY_SINK_ERROR,    // La destination a refusé les données (client déconnecté)
+};
+
+struct RelayResult {
+  RelayStatus status;
+  size_t bytes;
+  uint32_t underruns;     // Attentes de l'envoi faute de données, une fois le flux démarré
+  uint32_t fill_sum;      // Somme des buffers pleins observés à chaque envoi
+  uint32_t fill_samples;  // Nombre d'observations (fill_sum / fill_samples: remplissage moyen)
+  size_t window;          // Buffers utilisables pendant ce relais
+  int64_t first_data_us;  // Horodatage esp_timer du premier envoi (0: aucune donnée)
+};
+
+/* Relais producteur/consommateur entre un socket source et une destination.
+ * Une tâche de lecture permanente remplit les buffers libres pendant que
+ * l'appelant envoie les buffers pleins: réception et envoi se recouvrent. */
+class RelayEngine {
+ public:
+  // read_ahead_count: buffers disponibles en mode lecture anticipée (0 ou <= buffer_count: aucun en plus)
+  bool init(const char *name, size_t buffer_count, size_t buffer_size, bool use_psram, size_t read_ahead_count = 0);
+
+  // Relaie au plus `limit` octets (-1: jusqu'à EOF) depuis source_sock vers sink.
+  // read_ahead: la lecture peut prendre jusqu'à read_ahead_count buffers d'avance sur l'envoi.
+  RelayResult run(int source_sock, int64_t limit, const RelaySink &sink, bool read_ahead = false);
+
+#ifdef USE_HOST
+  // Hôte Linux uniquement: relais direct vers un socket prêt à recevoir le corps brut (en-têtes
+  // envoyés, Content-Length), par splice() à travers un tube, sans copie en espace utilisateur
+  // (bench_relay). Ni buffers ni lecture anticipée: underruns et remplissage restent à 0.
+  // lwIP n'a pas d'équivalent entre deux sockets: sur ESP-IDF, les appelants passent par run().
+  RelayResult run_to_socket(int source_sock, int dest_sock, int64_t limit, const RelayProgress &progress = nullptr);
+#endif
+
+  // Relais d'un fichier local (descripteur VFS déjà positionné à offset) vers un socket.
+  // ESP-IDF: lectures de la taille d'un buffer, alignées sur cette taille après la première,
+  // recouvertes par l'envoi du buffer précédent. Hôte Linux: sendfile(), sans copie ni lecture
+  // anticipée (read_ahead ignoré).
+  RelayResult run_file_to_socket(int file_fd, int64_t offset, int dest_sock, int64_t limit, bool read_ahead = false,
+                                 const RelayProgress &progress = nullptr);
+
+  size_t buffer_size() const { return buffer_size_; }
+
+ protected:
+  struct Block {
+    char *data;
+    int len;  // > 0: données, sinon code de fin (voir relay_engine.cpp)
+  };
+
+  RelayResult relay(int source, int64_t limit, const RelaySink &sink, bool read_ahead);
+  static void reader_task(void *param);
+  void read_job();
+  void maybe_yield(int64_t &last_yield_us);
+
+  size_t buffer_count_{0};      // Buffers utilisés par un relais normal
+  size_t total_buffer_count_{0};  // Buffers alloués, fenêtre de lecture anticipée comprise
+  size_t buffer_size_{0};
+  QueueHandle_t free_blocks_{nullptr};
+  QueueHandle_t full_blocks_{nullptr};
+  TaskHandle_t reader_{nullptr};
+
+  // Travail en cours, publié avant de réveiller la tâche de lecture
+  int source_sock_{-1};
+  bool source_file_{false};    // Source lue par read() (fichier) plutôt que recv() (socket)
+  size_t first_capacity_{0};   // Fichier: première lecture raccourcie pour aligner les suivantes
+  int64_t limit_{-1};
+  volatile bool abort_{false};
+};
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
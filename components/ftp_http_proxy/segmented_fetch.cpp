@@ -0,0 +1,215 @@
+#include "segmented_fetch.h"
+#include "esphome/core/log.h"
+#include <lwip/sockets.h>
+#include "esp_heap_caps.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const char *TAG = "ftp_proxy.segments";
+
+SegmentedFetch::~SegmentedFetch() {
+  for (auto &lane : lanes_) {
+    heap_caps_free(lane.buffer);
+  }
+}
+
+bool SegmentedFetch::init(size_t lanes, size_t segment_size, bool use_psram, uint32_t connect_timeout_ms) {
+  segment_size_ = segment_size;
+  connect_timeout_ms_ = connect_timeout_ms;
+  lanes_.resize(lanes);
+
+  bool psram = use_psram && heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0;
+  uint32_t caps = psram ? MALLOC_CAP_SPIRAM : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  for (auto &lane : lanes_) {
+    lane.buffer = (char *) heap_caps_malloc(segment_size, caps);
+    if (lane.buffer == nullptr) {
+      ESP_LOGW(TAG, "Mémoire insuffisante pour %u segments de %u octets", (unsigned) lanes, (unsigned) segment_size);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SegmentedFetch::start_segment(Lane &lane, const std::string &path, int64_t offset, size_t length) {
+  char reply[256];
+  lane.length = length;
+  lane.filled = 0;
+  lane.flushed = 0;
+
+  lane.data_sock = open_data_connection(*lane.ctrl, reply, sizeof(reply), connect_timeout_ms_);
+  if (lane.data_sock < 0) {
+    return false;
+  }
+  lane.busy = true;
+
+  // REST et RETR enchaînés; si REST est refusé, le RETR parti depuis l'octet 0 rend la voie inutilisable
+  std::string commands = "REST " + std::to_string((long long) offset) + "\r\nRETR " + path + "\r\n";
+  if (!ftp_send(*lane.ctrl, commands.c_str())) {
+    return false;
+  }
+  if (ftp_read_reply(*lane.ctrl, reply, sizeof(reply)) != 350) {
+    ESP_LOGW(TAG, "REST refusé sur la voie (socket %d)", lane.ctrl->sock);
+    return false;
+  }
+
+  int code = ftp_read_reply(*lane.ctrl, reply, sizeof(reply));
+  if (code != 150 && code != 125) {
+    ESP_LOGW(TAG, "RETR refusé pour le segment à %lld: %s", (long long) offset, reply);
+    return false;
+  }
+  return true;
+}
+
+// Le canal de données est fermé dès que le segment est complet: le serveur répond 226 ou 426/451
+// selon qu'il avait déjà tout envoyé. Un NOOP sert de marqueur pour consommer ces réponses.
+void SegmentedFetch::finish_segment(Lane &lane) {
+  if (lane.data_sock != -1) {
+    close(lane.data_sock);
+    lane.data_sock = -1;
+  }
+  lane.busy = false;
+
+  if (!ftp_resync(*lane.ctrl)) {
+    lane.reusable = false;
+  }
+}
+
+void SegmentedFetch::abort_lanes() {
+  for (auto &lane : lanes_) {
+    if (lane.data_sock != -1) {
+      close(lane.data_sock);
+      lane.data_sock = -1;
+    }
+    // Réponse du transfert interrompu non lue: la session n'est pas dans un état connu
+    if (lane.busy) {
+      lane.reusable = false;
+      lane.busy = false;
+    }
+  }
+}
+
+size_t SegmentedFetch::segment_length(int64_t segment) const {
+  int64_t start = segment * (int64_t) segment_size_;
+  return (size_t) std::min<int64_t>(segment_size_, length_ - start);
+}
+
+size_t SegmentedFetch::start(const std::vector<FtpControl *> &ctrls, const std::string &path, int64_t offset,
+                             int64_t length) {
+  path_ = path;
+  offset_ = offset;
+  length_ = length;
+  next_segment_ = 0;
+  const int64_t total_segments = (length + segment_size_ - 1) / segment_size_;
+
+  for (size_t i = 0; i < lanes_.size(); i++) {
+    Lane &lane = lanes_[i];
+    lane.ctrl = ctrls[i];
+    lane.reusable = true;
+    if (next_segment_ >= total_segments) {
+      break;
+    }
+    if (start_segment(lane, path_, offset_ + next_segment_ * (int64_t) segment_size_, segment_length(next_segment_))) {
+      lane.active = true;
+      active_.push_back(&lane);
+      next_segment_++;
+      continue;
+    }
+    // Voie refusée (canal de données, REST ou RETR): son segment passe à la voie suivante
+    ESP_LOGW(TAG, "Voie écartée (socket %d)", lane.ctrl->sock);
+    finish_segment(lane);
+  }
+  return active_.size();
+}
+
+void SegmentedFetch::cancel() {
+  for (auto *lane : active_) {
+    finish_segment(*lane);
+    lane->active = false;
+  }
+  active_.clear();
+}
+
+SegmentedResult SegmentedFetch::run(const RelaySink &sink) {
+  SegmentedResult result = {false, false, 0};
+  const size_t lane_count = active_.size();
+  const int64_t total_segments = (length_ + segment_size_ - 1) / segment_size_;
+  int64_t head_segment = 0;
+
+  while (head_segment < total_segments) {
+    Lane &head = *active_[head_segment % lane_count];
+
+    // Le segment de tête part vers le client au fil de sa réception
+    if (head.filled > head.flushed) {
+      if (!sink(head.buffer + head.flushed, head.filled - head.flushed)) {
+        result.sink_failed = true;
+        abort_lanes();
+        return result;
+      }
+      result.bytes += head.filled - head.flushed;
+      head.flushed = head.filled;
+    }
+
+    if (head.flushed == head.length) {
+      finish_segment(head);
+      head_segment++;
+      // La voie libérée reprend le premier segment non attribué (s + N)
+      if (next_segment_ < total_segments) {
+        if (!start_segment(head, path_, offset_ + next_segment_ * (int64_t) segment_size_,
+                           segment_length(next_segment_))) {
+          abort_lanes();
+          return result;
+        }
+        next_segment_++;
+      }
+      continue;
+    }
+
+    // Attendre des données sur n'importe quelle voie dont le segment n'est pas complet
+    fd_set readable;
+    FD_ZERO(&readable);
+    int max_fd = -1;
+    for (auto *lane : active_) {
+      if (lane->data_sock != -1 && lane->filled < lane->length) {
+        FD_SET(lane->data_sock, &readable);
+        max_fd = std::max(max_fd, lane->data_sock);
+      }
+    }
+    struct timeval timeout = {.tv_sec = 10, .tv_usec = 0};
+    int ready = select(max_fd + 1, &readable, nullptr, nullptr, &timeout);
+    if (ready <= 0) {
+      ESP_LOGE(TAG, "Délai dépassé en attente des segments (%d)", errno);
+      abort_lanes();
+      return result;
+    }
+
+    for (auto *lane : active_) {
+      if (lane->data_sock == -1 || !FD_ISSET(lane->data_sock, &readable)) {
+        continue;
+      }
+      int received = recv(lane->data_sock, lane->buffer + lane->filled, lane->length - lane->filled, 0);
+      if (received <= 0) {
+        ESP_LOGE(TAG, "Segment interrompu après %u/%u octets: %d", (unsigned) lane->filled, (unsigned) lane->length,
+                 errno);
+        abort_lanes();
+        return result;
+      }
+      lane->filled += received;
+      // Segment complet: libérer le canal de données sans attendre son tour d'envoi
+      if (lane->filled == lane->length) {
+        close(lane->data_sock);
+        lane->data_sock = -1;
+      }
+    }
+  }
+
+  result.success = true;
+  return result;
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
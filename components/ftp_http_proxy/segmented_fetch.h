@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ftp_client.h"
+#include "relay_engine.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+struct SegmentedResult {
+  bool success;
+  bool sink_failed;  // Le client a refusé les données
+  size_t bytes;
+};
+
+/* Récupération d'un fichier en segments de taille fixe, sur plusieurs sessions FTP en parallèle.
+ * Le segment s est lu par la voie active s % N dans son propre buffer (anneau de N buffers): les segments
+ * suivants se remplissent pendant que le segment de tête est envoyé, dans l'ordre, au client.
+ * start() ouvre les premiers segments avant tout envoi au client, pour pouvoir encore se replier
+ * sur un flux unique si trop de sessions refusent le transfert. */
+class SegmentedFetch {
+ public:
+  ~SegmentedFetch();
+
+  // Alloue un buffer de segment par voie; false si la mémoire manque (repli sur un seul flux)
+  bool init(size_t lanes, size_t segment_size, bool use_psram, uint32_t connect_timeout_ms);
+
+  // ctrls: une session de contrôle authentifiée par voie (ctrls.size() == lanes). Démarre un premier
+  // segment sur chaque voie; celles qui échouent sont écartées. Retourne le nombre de voies actives.
+  size_t start(const std::vector<FtpControl *> &ctrls, const std::string &path, int64_t offset, int64_t length);
+  // Abandon après start() (repli sur un flux unique): les sessions sont resynchronisées
+  void cancel();
+  SegmentedResult run(const RelaySink &sink);
+
+  // Voie écartée par start(): sa session peut être rendue au pool sans attendre run()
+  bool lane_active(size_t lane) const { return lane < lanes_.size() && lanes_[lane].active; }
+  // État de la session de contrôle de chaque voie après start() ou run() (intacte si jamais démarrée)
+  bool lane_reusable(size_t lane) const { return lane >= lanes_.size() || lanes_[lane].reusable; }
+
+ protected:
+  struct Lane {
+    FtpControl *ctrl{nullptr};
+    int data_sock{-1};
+    char *buffer{nullptr};
+    size_t length{0};   // Taille du segment en cours
+    size_t filled{0};   // Octets reçus
+    size_t flushed{0};  // Octets déjà transmis au client
+    bool busy{false};   // Transfert commencé, réponse finale pas encore lue
+    bool active{false};
+    bool reusable{true};
+  };
+
+  bool start_segment(Lane &lane, const std::string &path, int64_t offset, size_t length);
+  void finish_segment(Lane &lane);
+  void abort_lanes();
+
+  size_t segment_length(int64_t segment) const;
+
+  std::vector<Lane> lanes_;
+  std::vector<Lane *> active_;  // Voies démarrées, dans l'ordre d'attribution des segments
+  std::string path_;
+  int64_t offset_{0};
+  int64_t length_{0};
+  int64_t next_segment_{0};
+  size_t segment_size_{0};
+  uint32_t connect_timeout_ms_{10000};
+};
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,57 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+    UNIT_PERCENT,
+)
+
+from . import FTPHTTPProxy
+
+DEPENDENCIES = ['ftp_http_proxy']
+
+CONF_FTP_HTTP_PROXY_ID = 'ftp_http_proxy_id'
+CONF_ACTIVE_TRANSFERS = 'active_transfers'
+CONF_BYTES_RELAYED = 'bytes_relayed'
+CONF_QUEUE_DEPTH = 'queue_depth'
+CONF_FTP_ERRORS = 'ftp_errors'
+CONF_CACHE_HIT_RATIO = 'cache_hit_ratio'
+CONF_PSRAM_FREE = 'psram_free'
+CONF_INTERNAL_FREE = 'internal_free'
+
+CONFIG_SCHEMA = cv.Schema({
+    cv.GenerateID(CONF_FTP_HTTP_PROXY_ID): cv.use_id(FTPHTTPProxy),
+    cv.Optional(CONF_ACTIVE_TRANSFERS): sensor.sensor_schema(
+        accuracy_decimals=0, state_class=STATE_CLASS_MEASUREMENT),
+    cv.Optional(CONF_BYTES_RELAYED): sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES, accuracy_decimals=0, state_class=STATE_CLASS_TOTAL_INCREASING),
+    cv.Optional(CONF_QUEUE_DEPTH): sensor.sensor_schema(
+        accuracy_decimals=0, state_class=STATE_CLASS_MEASUREMENT),
+    cv.Optional(CONF_FTP_ERRORS): sensor.sensor_schema(
+        accuracy_decimals=0, state_class=STATE_CLASS_TOTAL_INCREASING),
+    cv.Optional(CONF_CACHE_HIT_RATIO): sensor.sensor_schema(
+        unit_of_measurement=UNIT_PERCENT, accuracy_decimals=1, state_class=STATE_CLASS_MEASUREMENT),
+    cv.Optional(CONF_PSRAM_FREE): sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES, accuracy_decimals=0, state_class=STATE_CLASS_MEASUREMENT),
+    cv.Optional(CONF_INTERNAL_FREE): sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES, accuracy_decimals=0, state_class=STATE_CLASS_MEASUREMENT),
+})
+
+SENSORS = [
+    (CONF_ACTIVE_TRANSFERS, 'set_active_transfers_sensor'),
+    (CONF_BYTES_RELAYED, 'set_bytes_relayed_sensor'),
+    (CONF_QUEUE_DEPTH, 'set_queue_depth_sensor'),
+    (CONF_FTP_ERRORS, 'set_ftp_errors_sensor'),
+    (CONF_CACHE_HIT_RATIO, 'set_cache_hit_ratio_sensor'),
+    (CONF_PSRAM_FREE, 'set_psram_free_sensor'),
+    (CONF_INTERNAL_FREE, 'set_internal_free_sensor'),
+]
+
+async def to_code(config):
+    proxy = await cg.get_variable(config[CONF_FTP_HTTP_PROXY_ID])
+    for key, setter in SENSORS:
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(proxy, setter)(sens))
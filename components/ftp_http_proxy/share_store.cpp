@@ -0,0 +1,340 @@
+#include "share_store.h"
+#include "share_token.h"
+#include "esphome/core/log.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const char *TAG = "ftp_proxy.store";
+
+static const uint32_t STORE_MAGIC = 0x46535332;  // "FSS2"
+static const uint32_t SECTOR_SIZE = 4096;
+static const uint8_t FLAG_SHAREABLE = 1 << 0;
+
+size_t ShareStore::image_size(const Header &header) const {
+  return sizeof(Header) + (size_t) header.file_count * sizeof(FileRecord) +
+         (size_t) header.share_count * sizeof(ShareRecord) + header.pool_size;
+}
+
+const ShareStore::FileRecord *ShareStore::files() const {
+  return (const FileRecord *) (image_ + sizeof(Header));
+}
+
+const ShareStore::ShareRecord *ShareStore::shares() const {
+  return (const ShareRecord *) (image_ + sizeof(Header) + file_count_ * sizeof(FileRecord));
+}
+
+const char *ShareStore::pool() const {
+  return (const char *) (image_ + sizeof(Header) + file_count_ * sizeof(FileRecord) +
+                         share_count_ * sizeof(ShareRecord));
+}
+
+bool ShareStore::path_equals(const FileRecord &record, const std::string &path) const {
+  return record.path_length == path.size() && memcmp(pool() + record.path_offset, path.data(), path.size()) == 0;
+}
+
+bool ShareStore::read_header(uint32_t slot, Header &header) {
+  if (esp_partition_read(partition_, slot * slot_size_, &header, sizeof(header)) != ESP_OK) {
+    return false;
+  }
+  return header.magic == STORE_MAGIC &&
+         header.crc == esp_rom_crc32_le(0, (const uint8_t *) &header, offsetof(Header, crc)) &&
+         image_size(header) <= slot_size_;
+}
+
+bool ShareStore::map_slot(uint32_t slot, const Header &header) {
+  const void *mapped;
+  esp_partition_mmap_handle_t handle;
+  esp_err_t err = esp_partition_mmap(partition_, slot * slot_size_, image_size(header), ESP_PARTITION_MMAP_DATA,
+                                     &mapped, &handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Projection de l'image impossible (%d)", err);
+    return false;
+  }
+  // Enregistrements déchirés ou altérés: l'en-tête seul ne le révèle pas
+  const uint8_t *body = (const uint8_t *) mapped + sizeof(Header);
+  if (esp_rom_crc32_le(0, body, image_size(header) - sizeof(Header)) != header.body_crc) {
+    ESP_LOGW(TAG, "Image %u de l'emplacement %u altérée, ignorée", (unsigned) header.sequence, (unsigned) slot);
+    esp_partition_munmap(handle);
+    return false;
+  }
+
+  xSemaphoreTake(view_mutex_, portMAX_DELAY);
+  bool had_image = image_ != nullptr;
+  esp_partition_mmap_handle_t previous = mmap_handle_;
+  image_ = (const uint8_t *) mapped;
+  mmap_handle_ = handle;
+  slot_ = slot;
+  sequence_ = header.sequence;
+  file_count_ = header.file_count;
+  share_count_ = header.share_count;
+  xSemaphoreGive(view_mutex_);
+
+  if (had_image) {
+    esp_partition_munmap(previous);
+  }
+  return true;
+}
+
+bool ShareStore::open(const std::string &label) {
+  const esp_partition_t *partition =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label.c_str());
+  if (partition == nullptr) {
+    ESP_LOGE(TAG, "Partition '%s' introuvable", label.c_str());
+    return false;
+  }
+  view_mutex_ = xSemaphoreCreateMutex();
+  write_mutex_ = xSemaphoreCreateMutex();
+  if (view_mutex_ == nullptr || write_mutex_ == nullptr) {
+    return false;
+  }
+  partition_ = partition;
+  slot_size_ = (partition->size / 2) / SECTOR_SIZE * SECTOR_SIZE;
+
+  // Les enregistrements restent en flash: seuls les en-têtes sont lus, puis l'image retenue est
+  // parcourue une fois par le CRC. L'image la plus récente d'abord, l'autre si elle est altérée.
+  Header headers[2];
+  bool valid[2] = {read_header(0, headers[0]), read_header(1, headers[1])};
+  uint32_t newest = valid[0] && valid[1] ? ((int32_t) (headers[1].sequence - headers[0].sequence) > 0 ? 1 : 0)
+                                         : (valid[1] ? 1 : 0);
+  for (uint32_t slot : {newest, 1 - newest}) {
+    if (valid[slot] && map_slot(slot, headers[slot])) {
+      break;
+    }
+  }
+  return true;
+}
+
+bool ShareStore::find_file(const std::string &path, bool &shareable) {
+  uint32_t path_id = share_path_id(path);
+  bool found = false;
+  if (partition_ == nullptr) {
+    return false;
+  }
+  xSemaphoreTake(view_mutex_, portMAX_DELAY);
+  if (image_ != nullptr) {
+    const FileRecord *begin = files();
+    const FileRecord *end = begin + file_count_;
+    const FileRecord *it = std::lower_bound(
+        begin, end, path_id, [](const FileRecord &record, uint32_t id) { return record.path_id < id; });
+    for (; it != end && it->path_id == path_id; ++it) {
+      if (path_equals(*it, path)) {
+        shareable = (it->flags & FLAG_SHAREABLE) != 0;
+        found = true;
+        break;
+      }
+    }
+  }
+  xSemaphoreGive(view_mutex_);
+  return found;
+}
+
+bool ShareStore::find_path(uint32_t path_id, std::string &path) {
+  bool found = false;
+  if (partition_ == nullptr) {
+    return false;
+  }
+  xSemaphoreTake(view_mutex_, portMAX_DELAY);
+  if (image_ != nullptr) {
+    const FileRecord *begin = files();
+    const FileRecord *end = begin + file_count_;
+    const FileRecord *it = std::lower_bound(
+        begin, end, path_id, [](const FileRecord &record, uint32_t id) { return record.path_id < id; });
+    for (; it != end && it->path_id == path_id; ++it) {
+      if (it->flags & FLAG_SHAREABLE) {
+        path.assign(pool() + it->path_offset, it->path_length);
+        found = true;
+        break;
+      }
+    }
+  }
+  xSemaphoreGive(view_mutex_);
+  return found;
+}
+
+bool ShareStore::find_share(uint32_t token, std::string &path, uint32_t &expiry) {
+  bool found = false;
+  if (partition_ == nullptr) {
+    return false;
+  }
+  xSemaphoreTake(view_mutex_, portMAX_DELAY);
+  if (image_ != nullptr) {
+    const ShareRecord *begin = shares();
+    const ShareRecord *end = begin + share_count_;
+    const ShareRecord *it = std::lower_bound(
+        begin, end, token, [](const ShareRecord &record, uint32_t value) { return record.token < value; });
+    if (it != end && it->token == token) {
+      const FileRecord &file = files()[it->file_index];
+      path.assign(pool() + file.path_offset, file.path_length);
+      expiry = it->expiry;
+      found = true;
+    }
+  }
+  xSemaphoreGive(view_mutex_);
+  return found;
+}
+
+namespace {
+
+struct MergedFile {
+  uint32_t path_id;
+  std::string path;
+  uint8_t flags;
+  uint8_t priority;  // 2: changement, 1: image, 0: fichier désigné par un lien uniquement
+  bool referenced;
+};
+
+struct MergedShare {
+  uint32_t token;
+  std::string path;
+  uint32_t expiry;
+  uint8_t priority;
+};
+
+bool file_less(const MergedFile &a, const MergedFile &b) {
+  if (a.path_id != b.path_id)
+    return a.path_id < b.path_id;
+  return a.path < b.path;
+}
+
+}  // namespace
+
+bool ShareStore::commit(const std::vector<StoredFile> &changed_files, const std::vector<StoredShare> &changed_shares,
+                        bool drop_shares, uint32_t now) {
+  if (partition_ == nullptr) {
+    return false;
+  }
+  xSemaphoreTake(write_mutex_, portMAX_DELAY);
+
+  // L'image n'est remplacée que sous write_mutex_: lecture directe sans view_mutex_
+  std::vector<MergedFile> merged;
+  std::vector<MergedShare> links;
+  merged.reserve(file_count_ + changed_files.size() + changed_shares.size());
+  for (uint32_t i = 0; image_ != nullptr && i < file_count_; i++) {
+    const FileRecord &record = files()[i];
+    merged.push_back({record.path_id, std::string(pool() + record.path_offset, record.path_length), record.flags,
+                      1, false});
+  }
+  for (uint32_t i = 0; image_ != nullptr && !drop_shares && i < share_count_; i++) {
+    const ShareRecord &record = shares()[i];
+    const FileRecord &file = files()[record.file_index];
+    links.push_back({record.token, std::string(pool() + file.path_offset, file.path_length), record.expiry, 1});
+  }
+  for (const auto &file : changed_files) {
+    merged.push_back({share_path_id(file.path), file.path, (uint8_t) (file.shareable ? FLAG_SHAREABLE : 0), 2,
+                      false});
+  }
+  for (const auto &share : changed_shares) {
+    links.push_back({share.token, share.path, share.expiry, 2});
+  }
+
+  // Un seul enregistrement par token puis par chemin, la source la plus récente l'emporte
+  std::sort(links.begin(), links.end(), [](const MergedShare &a, const MergedShare &b) {
+    return a.token != b.token ? a.token < b.token : a.priority > b.priority;
+  });
+  links.erase(std::unique(links.begin(), links.end(),
+                          [](const MergedShare &a, const MergedShare &b) { return a.token == b.token; }),
+              links.end());
+  links.erase(std::remove_if(links.begin(), links.end(),
+                             [now](const MergedShare &link) { return now != 0 && link.expiry < now; }),
+              links.end());
+  for (const auto &link : links) {
+    merged.push_back({share_path_id(link.path), link.path, 0, 0, false});
+  }
+  std::sort(merged.begin(), merged.end(), [](const MergedFile &a, const MergedFile &b) {
+    return file_less(a, b) || (!file_less(b, a) && a.priority > b.priority);
+  });
+  merged.erase(std::unique(merged.begin(), merged.end(),
+                           [](const MergedFile &a, const MergedFile &b) { return !file_less(a, b) && !file_less(b, a); }),
+               merged.end());
+
+  // Compactage: un fichier non partageable n'est gardé que si un lien le désigne
+  auto locate = [&merged](const std::string &path) {
+    MergedFile key{share_path_id(path), path, 0, 0, false};
+    return std::lower_bound(merged.begin(), merged.end(), key, file_less);
+  };
+  for (const auto &link : links) {
+    locate(link.path)->referenced = true;
+  }
+  merged.erase(std::remove_if(merged.begin(), merged.end(),
+                              [](const MergedFile &file) { return file.flags == 0 && !file.referenced; }),
+               merged.end());
+
+  Header header{};
+  header.magic = STORE_MAGIC;
+  header.sequence = sequence_ + 1;
+  header.file_count = merged.size();
+  header.share_count = links.size();
+  for (const auto &file : merged) {
+    header.pool_size += file.path.size();
+  }
+  size_t total = image_size(header);
+  if (total > slot_size_) {
+    ESP_LOGE(TAG, "Image de %u octets trop grande pour la partition (%u par emplacement)", (unsigned) total,
+             (unsigned) slot_size_);
+    xSemaphoreGive(write_mutex_);
+    return false;
+  }
+
+  uint32_t caps = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0 ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT;
+  uint8_t *buffer = (uint8_t *) heap_caps_malloc(total, caps);
+  if (buffer == nullptr) {
+    ESP_LOGE(TAG, "Mémoire insuffisante pour une image de %u octets", (unsigned) total);
+    xSemaphoreGive(write_mutex_);
+    return false;
+  }
+  auto *file_records = (FileRecord *) (buffer + sizeof(Header));
+  auto *share_records = (ShareRecord *) (file_records + merged.size());
+  char *paths = (char *) (share_records + links.size());
+  uint32_t offset = 0;
+  for (size_t i = 0; i < merged.size(); i++) {
+    uint16_t length = merged[i].path.size();
+    file_records[i] = {merged[i].path_id, offset, length, merged[i].flags, 0};
+    memcpy(paths + offset, merged[i].path.data(), length);
+    offset += length;
+  }
+  for (size_t i = 0; i < links.size(); i++) {
+    share_records[i] = {links[i].token, (uint32_t) (locate(links[i].path) - merged.begin()), links[i].expiry};
+  }
+  header.body_crc = esp_rom_crc32_le(0, buffer + sizeof(Header), total - sizeof(Header));
+  header.crc = esp_rom_crc32_le(0, (const uint8_t *) &header, offsetof(Header, crc));
+  memcpy(buffer, &header, sizeof(header));
+
+  // Changements annulés entre deux écritures (partage activé puis retiré): rien à écrire
+  if (image_ != nullptr && file_count_ == header.file_count && share_count_ == header.share_count &&
+      memcmp(image_ + sizeof(Header), buffer + sizeof(Header), total - sizeof(Header)) == 0) {
+    heap_caps_free(buffer);
+    xSemaphoreGive(write_mutex_);
+    return true;
+  }
+
+  // En-tête écrit en dernier: une image incomplète n'est jamais retenue à l'ouverture
+  uint32_t slot = image_ != nullptr ? 1 - slot_ : 0;
+  uint32_t base = slot * slot_size_;
+  esp_err_t err = esp_partition_erase_range(partition_, base, (total + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE);
+  if (err == ESP_OK) {
+    err = esp_partition_write(partition_, base + sizeof(Header), buffer + sizeof(Header), total - sizeof(Header));
+  }
+  if (err == ESP_OK) {
+    err = esp_partition_write(partition_, base, buffer, sizeof(Header));
+  }
+  heap_caps_free(buffer);
+
+  bool ok = err == ESP_OK && map_slot(slot, header);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Écriture de l'image impossible (%d)", err);
+  } else {
+    ESP_LOGD(TAG, "Image %u écrite: %u fichiers, %u liens, %u octets", (unsigned) header.sequence,
+             (unsigned) header.file_count, (unsigned) header.share_count, (unsigned) total);
+  }
+  xSemaphoreGive(write_mutex_);
+  return ok;
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+// Changements en attente d'écriture, fusionnés avec l'image courante par commit()
+struct StoredFile {
+  std::string path;
+  bool shareable;
+};
+
+struct StoredShare {
+  uint32_t token;  // Token aléatoire de 8 chiffres hexadécimaux
+  std::string path;
+  uint32_t expiry;  // Heure Unix
+};
+
+/* Fichiers partageables et liens aléatoires conservés sur une partition de données.
+ * L'image est compacte et à enregistrements fixes: en-tête, fichiers triés par path_id,
+ * liens triés par token, puis les chemins stockés une seule fois (un lien désigne un fichier
+ * par son index). Elle est projetée en mémoire (mmap) et consultée par dichotomie: rien n'est
+ * chargé au démarrage au-delà de l'en-tête.
+ * La partition est coupée en deux emplacements écrits en alternance, l'en-tête en dernier,
+ * pour qu'une coupure pendant l'écriture laisse l'image précédente intacte. Le contenu est
+ * vérifié par CRC à l'ouverture: un emplacement altéré cède la place à l'autre. */
+class ShareStore {
+ public:
+  // Monte l'image la plus récente de la partition (nom du partition.csv)
+  bool open(const std::string &label);
+  bool ready() const { return partition_ != nullptr; }
+
+  bool find_file(const std::string &path, bool &shareable);
+  // Premier fichier partageable de ce path_id
+  bool find_path(uint32_t path_id, std::string &path);
+  bool find_share(uint32_t token, std::string &path, uint32_t &expiry);
+
+  /* Écrit une nouvelle image: image courante + changements (prioritaires). Sont écartés les
+   * liens échus avant now (heure Unix, 0: inconnue), tous ceux de l'image si drop_shares,
+   * et les fichiers non partageables qu'aucun lien ne désigne. Aucune écriture si l'image
+   * ne change pas. */
+  bool commit(const std::vector<StoredFile> &files, const std::vector<StoredShare> &shares, bool drop_shares,
+              uint32_t now);
+
+  uint32_t file_count() const { return file_count_; }
+  uint32_t share_count() const { return share_count_; }
+
+ protected:
+  struct Header {
+    uint32_t magic;
+    uint32_t sequence;  // L'emplacement de plus haute séquence est le plus récent
+    uint32_t file_count;
+    uint32_t share_count;
+    uint32_t pool_size;
+    uint32_t body_crc;  // CRC32 des enregistrements et des chemins qui suivent l'en-tête
+    uint32_t crc;       // CRC32 des champs précédents
+  };
+  struct FileRecord {
+    uint32_t path_id;
+    uint32_t path_offset;  // Dans la zone des chemins
+    uint16_t path_length;
+    uint8_t flags;
+    uint8_t reserved;
+  };
+  struct ShareRecord {
+    uint32_t token;
+    uint32_t file_index;
+    uint32_t expiry;
+  };
+
+  bool read_header(uint32_t slot, Header &header);
+  // Projette l'emplacement et le retient si le contenu correspond à body_crc
+  bool map_slot(uint32_t slot, const Header &header);
+  size_t image_size(const Header &header) const;
+
+  // Accès à l'image projetée; view_mutex_ tenu par l'appelant
+  const FileRecord *files() const;
+  const ShareRecord *shares() const;
+  const char *pool() const;
+  bool path_equals(const FileRecord &record, const std::string &path) const;
+
+  const esp_partition_t *partition_{nullptr};
+  uint32_t slot_size_{0};
+  uint32_t slot_{0};
+  uint32_t sequence_{0};
+  uint32_t file_count_{0};
+  uint32_t share_count_{0};
+  const uint8_t *image_{nullptr};  // nullptr: aucune image valide
+  esp_partition_mmap_handle_t mmap_handle_{};
+
+  SemaphoreHandle_t view_mutex_{nullptr};   // Recherches contre remplacement de l'image
+  SemaphoreHandle_t write_mutex_{nullptr};  // Un seul commit à la fois
+};
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
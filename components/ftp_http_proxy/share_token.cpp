@@ -0,0 +1,175 @@
+#include "share_token.h"
+#include "open_hash_map.h"
+#include "esphome/core/log.h"
+#include "esp_random.h"
+#include "mbedtls/md.h"
+#include "nvs.h"
+#include <cstring>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const char *TAG = "ftp_proxy.share";
+
+static const char *NVS_NAMESPACE = "ftp_proxy";
+static const char *NVS_KEY = "share_key";
+static const char *NVS_GENERATION = "share_gen";
+
+static const char BASE64URL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+uint32_t share_path_id(const std::string &path) { return StringHash()(path); }
+
+static void put_u32(uint8_t *out, uint32_t value) {
+  out[0] = value;
+  out[1] = value >> 8;
+  out[2] = value >> 16;
+  out[3] = value >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *in) {
+  return (uint32_t) in[0] | ((uint32_t) in[1] << 8) | ((uint32_t) in[2] << 16) | ((uint32_t) in[3] << 24);
+}
+
+static int base64url_value(char c) {
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 26;
+  if (c >= '0' && c <= '9')
+    return c - '0' + 52;
+  if (c == '-')
+    return 62;
+  if (c == '_')
+    return 63;
+  return -1;
+}
+
+bool ShareTokenSigner::init() {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Ouverture NVS impossible (%d): tokens signés désactivés", err);
+    return false;
+  }
+
+  size_t key_size = sizeof(key_);
+  err = nvs_get_blob(handle, NVS_KEY, key_, &key_size);
+  if (err != ESP_OK || key_size != sizeof(key_)) {
+    // Premier démarrage: clé propre à l'appareil
+    esp_fill_random(key_, sizeof(key_));
+    err = nvs_set_blob(handle, NVS_KEY, key_, sizeof(key_));
+    if (err == ESP_OK) {
+      err = nvs_commit(handle);
+    }
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Enregistrement de la clé de partage impossible (%d)", err);
+      nvs_close(handle);
+      return false;
+    }
+    ESP_LOGI(TAG, "Nouvelle clé de partage générée");
+  }
+
+  uint32_t generation = 0;
+  nvs_get_u32(handle, NVS_GENERATION, &generation);
+  generation_.store(generation);
+  nvs_close(handle);
+
+  ready_ = true;
+  ESP_LOGD(TAG, "Tokens signés actifs, génération %u", (unsigned) generation);
+  return true;
+}
+
+void ShareTokenSigner::compute_mac(uint32_t path_id, uint32_t expiry, const std::string &path, uint8_t *mac) const {
+  uint8_t header[12];
+  put_u32(header, path_id);
+  put_u32(header + 4, expiry);
+  put_u32(header + 8, generation_.load());
+
+  mbedtls_md_context_t ctx;
+  mbedtls_md_init(&ctx);
+  mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+  mbedtls_md_hmac_starts(&ctx, key_, sizeof(key_));
+  mbedtls_md_hmac_update(&ctx, header, sizeof(header));
+  mbedtls_md_hmac_update(&ctx, (const uint8_t *) path.data(), path.size());
+  uint8_t full[32];
+  mbedtls_md_hmac_finish(&ctx, full);
+  mbedtls_md_free(&ctx);
+  memcpy(mac, full, SHARE_MAC_SIZE);
+}
+
+std::string ShareTokenSigner::sign(const std::string &path, uint32_t expiry) const {
+  uint8_t raw[SHARE_TOKEN_BYTES];
+  uint32_t path_id = share_path_id(path);
+  put_u32(raw, path_id);
+  put_u32(raw + 4, expiry);
+  compute_mac(path_id, expiry, path, raw + 8);
+
+  // 24 octets: 8 groupes de 3 octets, sans remplissage
+  std::string token;
+  token.reserve(SHARE_TOKEN_LENGTH);
+  for (size_t i = 0; i < SHARE_TOKEN_BYTES; i += 3) {
+    uint32_t group = ((uint32_t) raw[i] << 16) | ((uint32_t) raw[i + 1] << 8) | raw[i + 2];
+    token += BASE64URL[(group >> 18) & 0x3f];
+    token += BASE64URL[(group >> 12) & 0x3f];
+    token += BASE64URL[(group >> 6) & 0x3f];
+    token += BASE64URL[group & 0x3f];
+  }
+  return token;
+}
+
+bool ShareTokenSigner::decode(const std::string &token, SignedShare &share) {
+  if (token.size() != SHARE_TOKEN_LENGTH) {
+    return false;
+  }
+  uint8_t raw[SHARE_TOKEN_BYTES];
+  for (size_t i = 0, o = 0; i < SHARE_TOKEN_LENGTH; i += 4, o += 3) {
+    uint32_t group = 0;
+    for (size_t j = 0; j < 4; j++) {
+      int value = base64url_value(token[i + j]);
+      if (value < 0) {
+        return false;
+      }
+      group = (group << 6) | value;
+    }
+    raw[o] = group >> 16;
+    raw[o + 1] = group >> 8;
+    raw[o + 2] = group;
+  }
+  share.path_id = get_u32(raw);
+  share.expiry = get_u32(raw + 4);
+  memcpy(share.mac, raw + 8, SHARE_MAC_SIZE);
+  return true;
+}
+
+bool ShareTokenSigner::verify(const SignedShare &share, const std::string &path) const {
+  uint8_t expected[SHARE_MAC_SIZE];
+  compute_mac(share.path_id, share.expiry, path, expected);
+  uint8_t diff = 0;
+  for (size_t i = 0; i < SHARE_MAC_SIZE; i++) {
+    diff |= expected[i] ^ share.mac[i];
+  }
+  return diff == 0;
+}
+
+bool ShareTokenSigner::revoke() {
+  uint32_t generation = generation_.load() + 1;
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err == ESP_OK) {
+    err = nvs_set_u32(handle, NVS_GENERATION, generation);
+    if (err == ESP_OK) {
+      err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Enregistrement de la génération impossible (%d)", err);
+    return false;
+  }
+  generation_.store(generation);
+  ESP_LOGI(TAG, "Liens de partage révoqués, génération %u", (unsigned) generation);
+  return true;
+}
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
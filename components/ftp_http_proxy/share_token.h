@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+static const size_t SHARE_KEY_SIZE = 32;   // Clé HMAC-SHA256 de l'appareil
+static const size_t SHARE_MAC_SIZE = 16;   // HMAC tronqué à 128 bits
+static const size_t SHARE_TOKEN_BYTES = 4 + 4 + SHARE_MAC_SIZE;
+static const size_t SHARE_TOKEN_LENGTH = 32;  // SHARE_TOKEN_BYTES en base64url sans remplissage
+
+// Identifiant stable d'un chemin, porté par le token à la place du chemin lui-même
+uint32_t share_path_id(const std::string &path);
+
+// Contenu d'un token signé, avant vérification du MAC
+struct SignedShare {
+  uint32_t path_id;
+  uint32_t expiry;  // Heure Unix d'expiration
+  uint8_t mac[SHARE_MAC_SIZE];
+};
+
+/* Tokens de partage sans état: base64url(path_id | expiry | HMAC-SHA256(clé, path_id | expiry |
+ * génération | chemin)). La validation ne consulte aucune table de partages; seule la correspondance
+ * path_id -> chemin des fichiers partageables est gardée par le proxy.
+ * La clé et le compteur de génération sont conservés en NVS: incrémenter la génération révoque
+ * d'un coup tous les tokens émis. */
+class ShareTokenSigner {
+ public:
+  // Charge la clé et la génération depuis NVS, ou crée la clé au premier démarrage
+  bool init();
+  bool ready() const { return ready_; }
+
+  std::string sign(const std::string &path, uint32_t expiry) const;
+
+  // false si le token n'a pas le format d'un token signé
+  static bool decode(const std::string &token, SignedShare &share);
+
+  // Comparaison du MAC en temps constant
+  bool verify(const SignedShare &share, const std::string &path) const;
+
+  // Invalide tous les tokens émis; false si la nouvelle génération n'a pas pu être enregistrée
+  bool revoke();
+  uint32_t generation() const { return generation_.load(); }
+
+ protected:
+  void compute_mac(uint32_t path_id, uint32_t expiry, const std::string &path, uint8_t *mac) const;
+
+  uint8_t key_[SHARE_KEY_SIZE];
+  std::atomic<uint32_t> generation_{0};
+  bool ready_{false};
+};
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace ftp_http_proxy {
+
+struct FileTransferContext;
+class RelayEngine;
+
+/* Origine des fichiers servis par le proxy. Le serveur FTP est le backend par défaut; les mounts
+ * locaux (carte SD, LittleFS) en prennent le relais sous leur préfixe d'URL.
+ * download()/upload() s'exécutent sur un worker et répondent eux-mêmes à la requête
+ * (en-têtes, corps ou erreur); ctx->remote_path est le chemin complet demandé. */
+class StorageBackend {
+ public:
+  virtual ~StorageBackend() = default;
+
+  virtual const char *name() const = 0;
+  // > 0: backend momentanément indisponible, délai avant de réessayer (ms)
+  virtual uint32_t unavailable_for_ms() const { return 0; }
+  // Les GET simultanés d'un même fichier peuvent partager un seul téléchargement
+  virtual bool coalescable() const { return false; }
+
+  virtual void download(FileTransferContext *ctx, RelayEngine &relay) = 0;
+  virtual void upload(FileTransferContext *ctx) = 0;
+};
+
+}  // namespace ftp_http_proxy
+}  // namespace esphome
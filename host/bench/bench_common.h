@@ -0,0 +1,48 @@
+#pragma once
+
+// Outils partagés des mesures: options de ligne de commande et statistiques simples
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace ftp_http_proxy {
+namespace host {
+
+inline int64_t bench_now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// --quick: tailles réduites pour ctest; les résultats restent affichés mais ne sont pas représentatifs
+inline bool bench_quick(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Percentile (0 à 100) d'un échantillon, en place
+inline double percentile(std::vector<double> &samples, double p) {
+  if (samples.empty()) {
+    return 0;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t index = std::min(samples.size() - 1, (size_t) (p / 100.0 * (samples.size() - 1) + 0.5));
+  return samples[index];
+}
+
+inline double mb_per_s(uint64_t bytes, int64_t elapsed_us) {
+  return elapsed_us > 0 ? bytes / (double) elapsed_us * 1e6 / (1024.0 * 1024.0) : 0;
+}
+
+}  // namespace host
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,126 @@
+// Mesures de bout en bout sur le loopback: temps jusqu'au premier octet, débit d'un gros
+// fichier et montée en charge avec des clients simultanés.
+//   bench_proxy [--quick]
+#include "bench_common.h"
+#include "check.h"
+#include "host_harness.h"
+#include "http_client.h"
+#include <cstdio>
+#include <thread>
+
+using namespace esphome::ftp_http_proxy::host;
+
+static const int TRANSFER_WORKERS = 4;
+static const int POOL_SIZE = 4;
+
+static std::string make_content(size_t size) {
+  std::string content(size, '\0');
+  uint32_t state = 0x12345678;
+  for (size_t i = 0; i < size; i++) {
+    state = state * 1103515245 + 12345;
+    content[i] = (char) (state >> 24);
+  }
+  return content;
+}
+
+static void bench_ttfb(uint16_t port, int requests) {
+  // Première requête: connexion et login FTP compris; les suivantes réutilisent le pool
+  HttpResult cold = http_get(port, "/bench/small.bin");
+  CHECK_EQ(cold.status, 200);
+  std::vector<double> samples;
+  for (int i = 0; i < requests; i++) {
+    HttpResult result = http_get(port, "/bench/small.bin");
+    CHECK_EQ(result.status, 200);
+    samples.push_back(result.ttfb_us / 1000.0);
+  }
+  printf("TTFB (4 Ko, %d requêtes séquentielles)\n", requests);
+  printf("  à froid %.2f ms | médiane %.2f ms | p95 %.2f ms | max %.2f ms\n", cold.ttfb_us / 1000.0,
+         percentile(samples, 50), percentile(samples, 95), percentile(samples, 100));
+}
+
+static void bench_throughput(uint16_t port, size_t size, int runs) {
+  std::vector<double> rates;
+  for (int i = 0; i < runs; i++) {
+    HttpRequest request;
+    request.path = "/bench/large.bin";
+    request.keep_body = false;
+    HttpResult result;
+    CHECK(http_request(port, request, result));
+    CHECK_EQ(result.status, 200);
+    CHECK_EQ(result.body_bytes, size);
+    rates.push_back(mb_per_s(result.body_bytes, result.total_us));
+  }
+  printf("Débit (%zu Mo, %d passages)\n", size >> 20, runs);
+  printf("  médiane %.1f Mo/s | meilleur %.1f Mo/s\n", percentile(rates, 50), percentile(rates, 100));
+}
+
+static void bench_concurrency(uint16_t port, size_t size, int per_client) {
+  printf("Clients simultanés (%zu Ko par requête, %d requêtes par client, %d workers)\n", size >> 10, per_client,
+         TRANSFER_WORKERS);
+  printf("  %8s %10s %10s %12s %8s\n", "clients", "req/s", "Mo/s", "p95 (ms)", "503");
+  for (int clients : {1, 2, 4, 8}) {
+    std::vector<std::vector<double>> latencies(clients);
+    std::vector<uint64_t> bytes(clients, 0);
+    std::vector<int> rejected(clients, 0);
+    std::vector<std::thread> threads;
+    int64_t start = bench_now_us();
+    for (int c = 0; c < clients; c++) {
+      threads.emplace_back([&, c]() {
+        for (int i = 0; i < per_client; i++) {
+          HttpRequest request;
+          request.path = "/bench/medium.bin";
+          request.keep_body = false;
+          HttpResult result;
+          http_request(port, request, result);
+          if (result.status == 503) {
+            rejected[c]++;
+          } else if (result.status == 200 && result.body_bytes == size) {
+            bytes[c] += result.body_bytes;
+            latencies[c].push_back(result.total_us / 1000.0);
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    int64_t elapsed = bench_now_us() - start;
+    std::vector<double> all;
+    uint64_t total = 0;
+    int total_rejected = 0;
+    for (int c = 0; c < clients; c++) {
+      all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+      total += bytes[c];
+      total_rejected += rejected[c];
+    }
+    CHECK_EQ(all.size() + total_rejected, (size_t) clients * per_client);
+    printf("  %8d %10.1f %10.1f %12.2f %8d\n", clients, all.size() * 1e6 / elapsed, mb_per_s(total, elapsed),
+           percentile(all, 95), total_rejected);
+  }
+}
+
+int main(int argc, char **argv) {
+  bool quick = bench_quick(argc, argv);
+  size_t large_size = (quick ? 8 : 64) << 20;
+  size_t medium_size = 1 << 20;
+
+  FakeFtpServer ftp;
+  CHECK(ftp.start());
+  ftp.add_file("bench/small.bin", make_content(4096));
+  ftp.add_file("bench/medium.bin", make_content(medium_size));
+  ftp.add_file("bench/large.bin", make_content(large_size));
+
+  ProxyHarness harness(ftp);
+  harness.proxy().set_transfer_workers(TRANSFER_WORKERS);
+  harness.proxy().set_transfer_queue_size(16);
+  harness.proxy().set_pool_size(POOL_SIZE);
+  CHECK(harness.start());
+  uint16_t port = harness.http_port();
+
+  bench_ttfb(port, quick ? 20 : 200);
+  bench_throughput(port, large_size, quick ? 1 : 5);
+  bench_concurrency(port, medium_size, quick ? 2 : 16);
+  printf("Sessions FTP ouvertes: %u, logins: %u\n", ftp.sessions_opened(), ftp.logins());
+
+  check_exit("bench_proxy");
+}
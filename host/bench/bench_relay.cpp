@@ -0,0 +1,179 @@
+// Coût CPU et débit du relais FTP -> HTTP, hors proxy: une source TCP, le RelayEngine, un
+// client qui vide le socket de destination, le tout sur le loopback.
+//   bench_relay [--quick]
+// "tampon": run() avec envoi direct sur le socket, le chemin ESP-IDF d'un corps de longueur
+// connue (réception dans un buffer, send() depuis ce buffer: deux copies).
+// "splice": run_to_socket() de l'hôte Linux, sans passage en espace utilisateur.
+// "ancienne boucle": un buffer de 8 Ko, recv -> send -> vTaskDelay(1), avant le RelayEngine.
+#include "bench_common.h"
+#include "check.h"
+#include "loopback.h"
+#include "relay_engine.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <thread>
+
+using namespace esphome::ftp_http_proxy;
+using namespace esphome::ftp_http_proxy::host;
+
+enum RelayPath {
+  PATH_LEGACY,
+  PATH_BUFFERED,
+  PATH_SPLICE,
+};
+
+static int64_t cpu_time_us() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL + usage.ru_utime.tv_usec +
+         usage.ru_stime.tv_usec;
+}
+
+static bool send_all(int sock, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t sent = send(sock, data, len, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    len -= sent;
+  }
+  return true;
+}
+
+// Boucle d'origine de file_transfer_task, réception et envoi en série
+static RelayResult legacy_relay(int source, int dest) {
+  RelayResult result = {RELAY_EOF, 0, 0, 0, 0, 0, 0};
+  char buffer[8192];
+  ssize_t received;
+  while ((received = recv(source, buffer, sizeof(buffer), 0)) > 0) {
+    if (!send_all(dest, buffer, received)) {
+      result.status = RELAY_SINK_ERROR;
+      break;
+    }
+    result.bytes += received;
+    vTaskDelay(pdMS_TO_TICKS(1));
+  }
+  return result;
+}
+
+struct RelayRun {
+  double mb_per_s;
+  double cpu_us_per_mb;
+};
+
+// Relaie `size` octets de la source vers un client qui les jette, par le chemin demandé
+static RelayRun relay_once(RelayEngine *relay, size_t size, RelayPath path) {
+  int source_writer, source, dest, dest_reader;
+  CHECK(tcp_pair(source_writer, source));
+  CHECK(tcp_pair(dest, dest_reader));
+
+  std::thread producer([&]() {
+    std::vector<char> block(64 * 1024, 'x');
+    for (size_t sent = 0; sent < size;) {
+      ssize_t n = send(source_writer, block.data(), std::min(block.size(), size - sent), MSG_NOSIGNAL);
+      if (n <= 0) {
+        break;
+      }
+      sent += n;
+    }
+    close(source_writer);
+  });
+  size_t drained = 0;
+  std::thread consumer([&]() {
+    std::vector<char> block(64 * 1024);
+    ssize_t n;
+    while ((n = recv(dest_reader, block.data(), block.size(), 0)) > 0) {
+      drained += n;
+    }
+  });
+
+  int64_t cpu_start = cpu_time_us();
+  int64_t start = bench_now_us();
+  RelayResult result;
+  switch (path) {
+    case PATH_LEGACY:
+      result = legacy_relay(source, dest);
+      break;
+    case PATH_BUFFERED:
+      result = relay->run(source, -1, [dest](const char *data, size_t len) { return send_all(dest, data, len); });
+      break;
+    case PATH_SPLICE:
+      result = relay->run_to_socket(source, dest, -1);
+      break;
+  }
+  shutdown(dest, SHUT_WR);
+  producer.join();
+  consumer.join();
+  int64_t elapsed = bench_now_us() - start;
+  int64_t cpu = cpu_time_us() - cpu_start;
+  close(source);
+  close(dest);
+  close(dest_reader);
+
+  CHECK_EQ(result.status, RELAY_EOF);
+  CHECK_EQ(result.bytes, size);
+  CHECK_EQ(drained, size);
+  return {mb_per_s(size, elapsed), cpu / (size / (1024.0 * 1024.0))};
+}
+
+static RelayRun best_of(RelayEngine *relay, size_t size, RelayPath path, int runs) {
+  RelayRun best = {0, 0};
+  for (int i = 0; i < runs; i++) {
+    RelayRun run = relay_once(relay, size, path);
+    if (run.mb_per_s > best.mb_per_s) {
+      best = run;
+    }
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  bool quick = bench_quick(argc, argv);
+  size_t size = (quick ? 16 : 512) << 20;
+  // L'ancienne boucle plafonne vers 8 Ko par tick: un flux plus court suffit
+  size_t legacy_size = (quick ? 2 : 32) << 20;
+  int runs = quick ? 1 : 3;
+
+  RelayEngine relay;
+  CHECK(relay.init("bench_relay", 2, 8192, false));
+
+  printf("Chemins de relais, 2 buffers de 8 Ko (meilleur de %d passages)\n", runs);
+  printf("  %-28s %8s %10s %14s\n", "chemin", "Mo", "Mo/s", "CPU (µs/Mo)");
+  RelayRun legacy = best_of(nullptr, legacy_size, PATH_LEGACY, runs);
+  printf("  %-28s %8zu %10.1f %14.0f\n", "ancienne boucle", legacy_size >> 20, legacy.mb_per_s, legacy.cpu_us_per_mb);
+  RelayRun buffered = best_of(&relay, size, PATH_BUFFERED, runs);
+  printf("  %-28s %8zu %10.1f %14.0f\n", "tampon (ESP-IDF, 2 copies)", size >> 20, buffered.mb_per_s,
+         buffered.cpu_us_per_mb);
+  RelayRun spliced = best_of(&relay, size, PATH_SPLICE, runs);
+  printf("  %-28s %8zu %10.1f %14.0f\n", "splice (hôte)", size >> 20, spliced.mb_per_s, spliced.cpu_us_per_mb);
+  printf("CPU de tout le processus: source et client comptent autant dans tous les chemins\n\n");
+
+  // relay_buffer_count x relay_buffer_size, chemin ESP-IDF
+  std::vector<size_t> counts = quick ? std::vector<size_t>{1, 2} : std::vector<size_t>{1, 2, 3, 4};
+  std::vector<size_t> sizes = quick ? std::vector<size_t>{4096, 16384}
+                                    : std::vector<size_t>{4096, 8192, 16384, 32768, 65536};
+  printf("Configurations du relais (tampon, %zu Mo, Mo/s)\n", size >> 20);
+  printf("  %8s", "buffers");
+  for (size_t buffer_size : sizes) {
+    printf(" %9zu Ko", buffer_size >> 10);
+  }
+  printf("\n");
+  for (size_t count : counts) {
+    printf("  %8zu", count);
+    for (size_t buffer_size : sizes) {
+      // Une tâche de lecture par moteur, jamais arrêtée: un moteur par configuration
+      auto *engine = new RelayEngine();
+      CHECK(engine->init("bench_config", count, buffer_size, false));
+      printf(" %12.1f", best_of(engine, size, PATH_BUFFERED, runs).mb_per_s);
+      fflush(stdout);
+    }
+    printf("\n");
+  }
+
+  check_exit("bench_relay");
+}
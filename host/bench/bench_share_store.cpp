@@ -0,0 +1,76 @@
+// Démarrage avec 5 000 fichiers partageables et 5 000 liens dans la partition: ouverture
+// (en-têtes, projection, CRC), première recherche, puis recherches et écriture d'une image.
+//   bench_share_store [--quick]
+#include "bench_common.h"
+#include "check.h"
+#include "host_platform.h"
+#include "share_store.h"
+#include "share_token.h"
+#include <cstdio>
+#include <vector>
+
+using namespace esphome::ftp_http_proxy;
+using namespace esphome::ftp_http_proxy::host;
+
+static const size_t RECORDS = 5000;
+
+int main(int argc, char **argv) {
+  bool quick = bench_quick(argc, argv);
+  int opens = quick ? 5 : 200;
+  CHECK(host_partition_add("shares", 1024 * 1024));
+
+  std::vector<StoredFile> files;
+  std::vector<StoredShare> shares;
+  for (size_t i = 0; i < RECORDS; i++) {
+    char path[96];
+    snprintf(path, sizeof(path), "media/films/collection_%04u/episode_%04u.mkv", (unsigned) (i / 50), (unsigned) i);
+    files.push_back({path, true});
+    shares.push_back({(uint32_t) (i * 2654435761u), path, 2000000000});
+  }
+
+  ShareStore writer;
+  CHECK(writer.open("shares"));
+  int64_t start = bench_now_us();
+  CHECK(writer.commit(files, shares, false, 1700000000));
+  int64_t commit_us = bench_now_us() - start;
+  CHECK_EQ(writer.file_count(), RECORDS);
+  CHECK_EQ(writer.share_count(), RECORDS);
+
+  // Ouverture au démarrage, répétée: seule la première recherche suit immédiatement
+  std::vector<double> open_samples, first_lookup_samples;
+  bool shareable;
+  for (int i = 0; i < opens; i++) {
+    ShareStore store;
+    start = bench_now_us();
+    CHECK(store.open("shares"));
+    int64_t opened = bench_now_us();
+    CHECK(store.find_file(files[i % RECORDS].path, shareable) && shareable);
+    open_samples.push_back(opened - start);
+    first_lookup_samples.push_back(bench_now_us() - opened);
+  }
+
+  ShareStore store;
+  CHECK(store.open("shares"));
+  std::string path;
+  uint32_t expiry;
+  start = bench_now_us();
+  for (auto &file : files) {
+    CHECK(store.find_file(file.path, shareable) && shareable);
+  }
+  int64_t file_lookups_us = bench_now_us() - start;
+  start = bench_now_us();
+  for (auto &share : shares) {
+    CHECK(store.find_share(share.token, path, expiry));
+  }
+  int64_t share_lookups_us = bench_now_us() - start;
+  CHECK(store.find_path(share_path_id(files[42].path), path) && path == files[42].path);
+
+  printf("Partition de partages: %zu fichiers, %zu liens\n", RECORDS, RECORDS);
+  printf("  écriture de l'image            %10.0f µs\n", (double) commit_us);
+  printf("  ouverture (médiane de %d)     %10.1f µs\n", opens, percentile(open_samples, 50));
+  printf("  première recherche (médiane)   %10.2f µs\n", percentile(first_lookup_samples, 50));
+  printf("  find_file                      %10.2f µs\n", file_lookups_us / (double) RECORDS);
+  printf("  find_share                     %10.2f µs\n", share_lookups_us / (double) RECORDS);
+
+  check_exit("bench_share_store");
+}
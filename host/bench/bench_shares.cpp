@@ -0,0 +1,151 @@
+// Recherche et expiration des liens de partage et des drapeaux "partageable" à 10k entrées:
+// structures du proxy (OpenHashMap, tas d'échéances) contre les vecteurs parcourus qu'elles
+// ont remplacés.
+//   bench_shares [--quick]
+#include "bench_common.h"
+#include "check.h"
+#include "ftp_http_proxy.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace esphome::ftp_http_proxy;
+using namespace esphome::ftp_http_proxy::host;
+
+// Accès aux méthodes protégées du proxy, mutex compris comme dans les handlers
+class BenchProxy : public FTPHTTPProxy {
+ public:
+  using FTPHTTPProxy::ShareLink;
+  using FTPHTTPProxy::add_share;
+  using FTPHTTPProxy::expire_shares;
+  using FTPHTTPProxy::find_share;
+};
+
+// Représentation d'origine: vecteurs parcourus à chaque recherche, remove_if à chaque loop()
+struct VectorShares {
+  std::vector<BenchProxy::ShareLink> shares;
+  std::vector<std::pair<std::string, bool>> files;
+
+  bool find_share(const std::string &token, BenchProxy::ShareLink &out) {
+    for (auto &share : shares) {
+      if (share.token == token) {
+        out = share;
+        return true;
+      }
+    }
+    return false;
+  }
+  bool is_shareable(const std::string &path) {
+    for (auto &file : files) {
+      if (file.first == path) {
+        return file.second;
+      }
+    }
+    return false;
+  }
+  void expire(int64_t now) {
+    shares.erase(std::remove_if(shares.begin(), shares.end(),
+                                [now](const BenchProxy::ShareLink &share) { return share.expiry < now; }),
+                 shares.end());
+  }
+};
+
+static std::string token_for(size_t i) {
+  char token[9];
+  snprintf(token, sizeof(token), "%08x", (unsigned) (i * 2654435761u));
+  return token;
+}
+
+// Même longueur qu'un vrai token, pour que la comparaison ne s'arrête pas à la taille
+static std::string absent_token(size_t i) {
+  char token[9];
+  snprintf(token, sizeof(token), "z%07x", (unsigned) i);
+  return token;
+}
+
+static std::string path_for(size_t i) { return "/films/serie-" + std::to_string(i / 100) + "/episode-" + std::to_string(i) + ".mkv"; }
+
+// Durée moyenne d'un appel de f(i) pour i dans [0, iterations), en nanosecondes
+template<typename F> static double ns_per_op(size_t iterations, F f) {
+  int64_t start = bench_now_us();
+  for (size_t i = 0; i < iterations; i++) {
+    f(i);
+  }
+  return (bench_now_us() - start) * 1000.0 / iterations;
+}
+
+int main(int argc, char **argv) {
+  bool quick = bench_quick(argc, argv);
+  const size_t entries = 10000;
+  const size_t lookups = quick ? 2000 : 200000;
+  const size_t vector_lookups = quick ? 200 : 5000;  // Parcours linéaires: beaucoup plus lents
+  const size_t ticks = quick ? 100 : 2000;
+  const size_t expired_per_round = 100;  // 1 % des liens arrivent à échéance ensemble
+
+  BenchProxy proxy;
+  proxy.set_ftp_server("127.0.0.1");
+  proxy.setup();
+  VectorShares vectors;
+
+  int64_t now = esp_timer_get_time() / 1000000;
+  for (size_t i = 0; i < entries; i++) {
+    BenchProxy::ShareLink share{path_for(i), token_for(i), now + 3600 + (int64_t) i};
+    proxy.add_share(share);
+    vectors.shares.push_back(share);
+    proxy.set_shareable(path_for(i), i % 2 == 0);
+    vectors.files.emplace_back(path_for(i), i % 2 == 0);
+  }
+
+  BenchProxy::ShareLink found;
+  size_t hits = 0;
+  printf("Recherches à %zu entrées (ns par opération)\n", entries);
+  printf("  %-32s %12s %12s\n", "", "table", "vecteur");
+  double table_hit = ns_per_op(lookups, [&](size_t i) { hits += proxy.find_share(token_for(i % entries), found); });
+  double vector_hit =
+      ns_per_op(vector_lookups, [&](size_t i) { hits += vectors.find_share(token_for(i * 7 % entries), found); });
+  printf("  %-32s %12.0f %12.0f\n", "token présent", table_hit, vector_hit);
+  double table_miss = ns_per_op(lookups, [&](size_t i) { hits += proxy.find_share(absent_token(i), found); });
+  double vector_miss =
+      ns_per_op(vector_lookups, [&](size_t i) { hits += vectors.find_share(absent_token(i), found); });
+  printf("  %-32s %12.0f %12.0f\n", "token absent", table_miss, vector_miss);
+  double table_flag = ns_per_op(lookups, [&](size_t i) { hits += proxy.is_shareable(path_for(i % entries)); });
+  double vector_flag =
+      ns_per_op(vector_lookups, [&](size_t i) { hits += vectors.is_shareable(path_for(i * 7 % entries)); });
+  printf("  %-32s %12.0f %12.0f\n", "chemin partageable", table_flag, vector_flag);
+  CHECK(hits > 0);
+  CHECK(proxy.find_share(token_for(1234), found) && found.path == path_for(1234));
+  CHECK(proxy.is_shareable(path_for(1234)) && !proxy.is_shareable(path_for(1235)));
+
+  // Passage de loop() sans rien d'échu: sommet du tas contre parcours complet
+  double table_idle = ns_per_op(ticks, [&](size_t) { proxy.expire_shares(); });
+  double vector_idle = ns_per_op(ticks, [&](size_t) { vectors.expire(now); });
+  printf("Expiration par passage de loop() (ns)\n");
+  printf("  %-32s %12.0f %12.0f\n", "aucun lien échu", table_idle, vector_idle);
+
+  // Échéances groupées: expired_per_round liens déjà échus, ajoutés hors mesure à chaque tour
+  int64_t table_us = 0, vector_us = 0;
+  size_t rounds = quick ? 5 : 50;
+  size_t next = entries;
+  for (size_t round = 0; round < rounds; round++) {
+    int64_t past = esp_timer_get_time() / 1000000 - 10;
+    for (size_t i = 0; i < expired_per_round; i++, next++) {
+      BenchProxy::ShareLink share{path_for(next), token_for(next), past};
+      proxy.add_share(share);
+      vectors.shares.push_back(share);
+    }
+    int64_t start = bench_now_us();
+    proxy.expire_shares();
+    table_us += bench_now_us() - start;
+    start = bench_now_us();
+    vectors.expire(past + 1);
+    vector_us += bench_now_us() - start;
+    CHECK(!proxy.find_share(token_for(next - 1), found));
+  }
+  printf("  %-32s %12.0f %12.0f\n", "100 liens échus sur 10 100", table_us * 1000.0 / rounds,
+         vector_us * 1000.0 / rounds);
+  CHECK_EQ(vectors.shares.size(), entries);
+  CHECK(proxy.find_share(token_for(0), found));
+
+  check_exit("bench_shares");
+}
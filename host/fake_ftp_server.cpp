@@ -0,0 +1,512 @@
+#include "fake_ftp_server.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace esphome {
+namespace ftp_http_proxy {
+namespace host {
+
+// Délai laissé au client pour se connecter au port passif annoncé
+static const int DATA_ACCEPT_TIMEOUT_MS = 5000;
+static const size_t DATA_CHUNK = 64 * 1024;
+
+// Sockets des sessions ouvertes, fermés par stop()
+static std::mutex sessions_mutex;
+static std::map<const FakeFtpServer *, std::set<int>> session_fds;
+
+struct SessionStart {
+  FakeFtpServer *server;
+  int sock;
+  uint32_t number;  // Rang d'ouverture de la session, à partir de 1
+};
+
+static bool send_all(int sock, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t sent = send(sock, data, len, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    len -= sent;
+  }
+  return true;
+}
+
+static std::string format_timestamp(time_t t) {
+  struct tm tm_utc;
+  gmtime_r(&t, &tm_utc);
+  char out[16];
+  strftime(out, sizeof(out), "%Y%m%d%H%M%S", &tm_utc);
+  return out;
+}
+
+static std::string normalize(std::string path) {
+  while (!path.empty() && path[0] == '/') {
+    path.erase(0, 1);
+  }
+  while (!path.empty() && path.back() == '/') {
+    path.pop_back();
+  }
+  return path;
+}
+
+// Socket d'écoute sur le loopback (127.0.0.1 ou ::1), port choisi par le noyau
+static int listen_loopback(bool ipv6, int backlog, uint16_t &port) {
+  int fd = socket(ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  int flag = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+  struct sockaddr_storage addr = {};
+  socklen_t addr_len;
+  if (ipv6) {
+    auto *addr6 = (struct sockaddr_in6 *) &addr;
+    addr6->sin6_family = AF_INET6;
+    addr6->sin6_addr = in6addr_loopback;
+    addr_len = sizeof(*addr6);
+  } else {
+    auto *addr4 = (struct sockaddr_in *) &addr;
+    addr4->sin_family = AF_INET;
+    addr4->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr_len = sizeof(*addr4);
+  }
+  if (bind(fd, (struct sockaddr *) &addr, addr_len) != 0 || listen(fd, backlog) != 0 ||
+      getsockname(fd, (struct sockaddr *) &addr, &addr_len) != 0) {
+    close(fd);
+    return -1;
+  }
+  port = ntohs(ipv6 ? ((struct sockaddr_in6 *) &addr)->sin6_port : ((struct sockaddr_in *) &addr)->sin_port);
+  return fd;
+}
+
+bool FakeFtpServer::start() {
+  ipv6_ = options().ipv6;
+  listen_fd_ = listen_loopback(ipv6_, 64, port_);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+
+  running_ = true;
+  pthread_t thread;
+  if (pthread_create(&thread, nullptr, accept_thread, this) != 0) {
+    running_ = false;
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+  pthread_detach(thread);
+  return true;
+}
+
+void FakeFtpServer::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  shutdown(listen_fd_, SHUT_RDWR);
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    for (int sock : session_fds[this]) {
+      shutdown(sock, SHUT_RDWR);
+    }
+  }
+  // Les threads de session référencent le serveur: attendre leur fin avant de le détruire
+  for (int i = 0; i < 500 && active_sessions_ > 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  close(listen_fd_);
+  listen_fd_ = -1;
+}
+
+void FakeFtpServer::set_options(const Options &options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  options_ = options;
+}
+
+FakeFtpServer::Options FakeFtpServer::options() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return options_;
+}
+
+void FakeFtpServer::add_file(const std::string &path, const std::string &content, time_t modified) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  files_[normalize(path)] = File{content, modified};
+}
+
+bool FakeFtpServer::get_file(const std::string &path, std::string &content) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = files_.find(normalize(path));
+  if (it == files_.end()) {
+    return false;
+  }
+  content = it->second.content;
+  return true;
+}
+
+void FakeFtpServer::remove_file(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  files_.erase(normalize(path));
+}
+
+void FakeFtpServer::drop_sessions() {
+  std::lock_guard<std::mutex> lock(sessions_mutex);
+  for (int sock : session_fds[this]) {
+    shutdown(sock, SHUT_RDWR);
+  }
+}
+
+uint32_t FakeFtpServer::count(const std::string &command) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = commands_.find(command);
+  return it == commands_.end() ? 0 : it->second;
+}
+
+void FakeFtpServer::reset_counters() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  commands_.clear();
+  logins_ = 0;
+  sessions_opened_ = 0;
+  sessions_refused_ = 0;
+}
+
+void FakeFtpServer::record_command(const std::string &command) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  commands_[command]++;
+}
+
+void *FakeFtpServer::accept_thread(void *param) {
+  auto *server = (FakeFtpServer *) param;
+  while (server->running_) {
+    int sock = accept(server->listen_fd_, nullptr, nullptr);
+    if (sock < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      break;
+    }
+    int max_sessions = server->options().max_sessions;
+    if (max_sessions > 0 && (int) server->active_sessions_ >= max_sessions) {
+      server->sessions_refused_++;
+      send_all(sock, "421 Too many connections\r\n", 26);
+      close(sock);
+      continue;
+    }
+    // Réponses courtes envoyées une à une: sans TCP_NODELAY, Nagle côté serveur et ACK retardé
+    // côté proxy ajoutent ~40 ms par réponse et masquent tout ce que l'on veut mesurer
+    int flag = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    server->active_sessions_++;
+    uint32_t number = ++server->sessions_opened_;
+    {
+      std::lock_guard<std::mutex> lock(sessions_mutex);
+      session_fds[server].insert(sock);
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, session_thread, new SessionStart{server, sock, number}) != 0) {
+      close(sock);
+      server->active_sessions_--;
+      continue;
+    }
+    pthread_detach(thread);
+  }
+  return nullptr;
+}
+
+void *FakeFtpServer::session_thread(void *param) {
+  auto *start = (SessionStart *) param;
+  FakeFtpServer *server = start->server;
+  int sock = start->sock;
+  uint32_t number = start->number;
+  delete start;
+  server->run_session(sock, number);
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    session_fds[server].erase(sock);
+  }
+  close(sock);
+  server->active_sessions_--;
+  return nullptr;
+}
+
+// Socket d'écoute passif, de la famille de la session de contrôle; retourne son port
+static int open_passive(int &listen_fd, bool ipv6) {
+  if (listen_fd >= 0) {
+    close(listen_fd);
+  }
+  uint16_t port;
+  listen_fd = listen_loopback(ipv6, 1, port);
+  return listen_fd >= 0 ? port : -1;
+}
+
+static int accept_data(int &listen_fd) {
+  if (listen_fd < 0) {
+    return -1;
+  }
+  struct pollfd waiting = {listen_fd, POLLIN, 0};
+  int sock = poll(&waiting, 1, DATA_ACCEPT_TIMEOUT_MS) == 1 ? accept(listen_fd, nullptr, nullptr) : -1;
+  close(listen_fd);
+  listen_fd = -1;
+  return sock;
+}
+
+void FakeFtpServer::run_session(int sock, uint32_t number) {
+  std::string input;
+  int passive_fd = -1;
+  int64_t rest_offset = 0;
+  bool user_given = false;
+  bool logged_in = false;
+
+  auto reply = [&](const std::string &text) {
+    uint32_t delay = options().reply_delay_ms;
+    if (delay > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    }
+    return send_all(sock, text.data(), text.size());
+  };
+
+  if (!reply("220 Fake FTP ready\r\n")) {
+    return;
+  }
+
+  while (running_) {
+    size_t eol = input.find("\r\n");
+    if (eol == std::string::npos) {
+      char chunk[512];
+      ssize_t received = recv(sock, chunk, sizeof(chunk), 0);
+      if (received <= 0) {
+        break;
+      }
+      input.append(chunk, received);
+      continue;
+    }
+    std::string line = input.substr(0, eol);
+    input.erase(0, eol + 2);
+    size_t space = line.find(' ');
+    std::string command = line.substr(0, space);
+    std::transform(command.begin(), command.end(), command.begin(), ::toupper);
+    std::string argument = space == std::string::npos ? "" : line.substr(space + 1);
+    record_command(command);
+    Options opts = options();
+
+    if (command == "USER") {
+      user_given = argument == opts.username;
+      reply("331 Password required\r\n");
+      continue;
+    }
+    if (command == "PASS") {
+      logged_in = user_given && argument == opts.password;
+      if (logged_in) {
+        logins_++;
+      }
+      reply(logged_in ? "230 Logged in\r\n" : "530 Login incorrect\r\n");
+      continue;
+    }
+    if (command == "QUIT") {
+      reply("221 Bye\r\n");
+      break;
+    }
+    if (command == "NOOP") {
+      reply("200 OK\r\n");
+      continue;
+    }
+    if (!logged_in) {
+      reply("530 Not logged in\r\n");
+      continue;
+    }
+
+    if (command == "TYPE") {
+      reply("200 Type set\r\n");
+    } else if (command == "SYST") {
+      reply("215 UNIX Type: L8\r\n");
+    } else if (command == "FEAT") {
+      reply(std::string("211-Features:\r\n") + (opts.mlsd ? " MLSD\r\n" : "") + " SIZE\r\n MDTM\r\n" +
+            (opts.rest ? " REST STREAM\r\n" : "") + (opts.epsv ? " EPSV\r\n" : "") + "211 End\r\n");
+    } else if (command == "PWD") {
+      reply("257 \"/\"\r\n");
+    } else if (command == "EPSV") {
+      int port = opts.epsv ? open_passive(passive_fd, ipv6_) : -1;
+      if (!opts.epsv) {
+        reply("502 EPSV not implemented\r\n");
+      } else if (port < 0) {
+        reply("425 Cannot open passive connection\r\n");
+      } else {
+        reply("229 Entering Extended Passive Mode (|||" + std::to_string(port) + "|)\r\n");
+      }
+    } else if (command == "PASV") {
+      // PASV ne sait annoncer qu'une adresse IPv4 (RFC 959)
+      int port = ipv6_ ? -1 : open_passive(passive_fd, false);
+      if (ipv6_) {
+        reply("522 Network protocol not supported, use (2)\r\n");
+      } else if (port < 0) {
+        reply("425 Cannot open passive connection\r\n");
+      } else {
+        char text[96];
+        snprintf(text, sizeof(text), "227 Entering Passive Mode (%s,%d,%d)\r\n", opts.pasv_address.c_str(),
+                 port / 256, port % 256);
+        reply(text);
+      }
+    } else if (command == "SIZE" || command == "MDTM") {
+      std::string path = normalize(argument);
+      std::string text;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = files_.find(path);
+        if (it != files_.end()) {
+          text = command == "SIZE" ? std::to_string(it->second.content.size()) : format_timestamp(it->second.modified);
+        }
+      }
+      reply(text.empty() ? "550 No such file\r\n" : "213 " + text + "\r\n");
+    } else if (command == "REST") {
+      if (!opts.rest) {
+        reply("502 REST not implemented\r\n");
+        continue;
+      }
+      rest_offset = strtoll(argument.c_str(), nullptr, 10);
+      reply("350 Restarting at " + std::to_string((long long) rest_offset) + "\r\n");
+    } else if (command == "RETR") {
+      std::string content;
+      if (!get_file(argument, content)) {
+        reply("550 No such file\r\n");
+        rest_offset = 0;
+        continue;
+      }
+      int64_t offset = std::min<int64_t>(rest_offset, content.size());
+      rest_offset = 0;
+      if (opts.refuse_retr_session == number) {
+        close(passive_fd);
+        passive_fd = -1;
+        reply("425 Can't open data connection\r\n");
+        continue;
+      }
+      reply("150 Opening BINARY mode data connection\r\n");
+      int data = accept_data(passive_fd);
+      if (data < 0) {
+        reply("425 No data connection\r\n");
+        continue;
+      }
+      bool complete = true;
+      auto started = std::chrono::steady_clock::now();
+      for (size_t pos = offset; pos < content.size() && running_;) {
+        size_t len = std::min(DATA_CHUNK, content.size() - pos);
+        if (opts.rate_bytes_per_s > 0) {
+          // Débit borné: chaque bloc attend l'instant où il aurait fini d'arriver
+          auto due = started + std::chrono::microseconds((int64_t) (pos - offset + len) * 1000000 /
+                                                          opts.rate_bytes_per_s);
+          std::this_thread::sleep_until(due);
+        }
+        if (!send_all(data, content.data() + pos, len)) {
+          complete = false;
+          break;
+        }
+        pos += len;
+      }
+      close(data);
+      reply(complete ? "226 Transfer complete\r\n" : "426 Connection closed; transfer aborted\r\n");
+    } else if (command == "STOR" || command == "APPE") {
+      std::string path = normalize(argument);
+      reply("150 Ok to send data\r\n");
+      int data = accept_data(passive_fd);
+      if (data < 0) {
+        reply("425 No data connection\r\n");
+        continue;
+      }
+      std::string content;
+      char chunk[DATA_CHUNK];
+      ssize_t received;
+      while ((received = recv(data, chunk, sizeof(chunk), 0)) > 0) {
+        content.append(chunk, received);
+      }
+      close(data);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        File &file = files_[path];
+        if (command == "APPE") {
+          file.content += content;
+        } else {
+          file.content = content;
+        }
+        file.modified = time(nullptr);
+      }
+      reply(received == 0 ? "226 Transfer complete\r\n" : "426 Transfer aborted\r\n");
+    } else if (command == "MLSD" || command == "LIST") {
+      bool mlsd = command == "MLSD";
+      if (mlsd && !opts.mlsd) {
+        reply("500 Unknown command\r\n");
+        continue;
+      }
+      std::string dir = normalize(argument);
+      std::string prefix = dir.empty() ? "" : dir + "/";
+      std::string listing;
+      std::set<std::string> subdirs;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &entry : files_) {
+          if (entry.first.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+          }
+          std::string name = entry.first.substr(prefix.size());
+          size_t slash = name.find('/');
+          if (slash != std::string::npos) {
+            subdirs.insert(name.substr(0, slash));
+            continue;
+          }
+          if (mlsd) {
+            listing += "type=file;size=" + std::to_string(entry.second.content.size()) +
+                       ";modify=" + format_timestamp(entry.second.modified) + "; " + name + "\r\n";
+          } else {
+            char date[16];
+            struct tm tm_utc;
+            gmtime_r(&entry.second.modified, &tm_utc);
+            strftime(date, sizeof(date), "%b %d  %Y", &tm_utc);
+            listing += "-rw-r--r--    1 ftp      ftp      " + std::to_string(entry.second.content.size()) + " " +
+                       date + " " + name + "\r\n";
+          }
+        }
+      }
+      for (auto &name : subdirs) {
+        listing += mlsd ? "type=dir;modify=20240101000000; " + name + "\r\n"
+                        : "drwxr-xr-x    2 ftp      ftp      4096 Jan 01  2024 " + name + "\r\n";
+      }
+      reply("150 Here comes the directory listing\r\n");
+      int data = accept_data(passive_fd);
+      if (data < 0) {
+        reply("425 No data connection\r\n");
+        continue;
+      }
+      bool complete = send_all(data, listing.data(), listing.size());
+      close(data);
+      reply(complete ? "226 Directory send OK\r\n" : "426 Transfer aborted\r\n");
+    } else if (command == "DELE") {
+      bool found;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        found = files_.erase(normalize(argument)) > 0;
+      }
+      reply(found ? "250 Deleted\r\n" : "550 No such file\r\n");
+    } else {
+      reply("502 Command not implemented\r\n");
+    }
+  }
+
+  if (passive_fd >= 0) {
+    close(passive_fd);
+  }
+}
+
+}  // namespace host
+}  // namespace ftp_http_proxy
+}  // namespace esphome
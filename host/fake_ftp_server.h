@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace esphome {
+namespace ftp_http_proxy {
+namespace host {
+
+/* Serveur FTP en mémoire, dans le processus, écoutant sur 127.0.0.1 ou ::1 (port choisi par le noyau).
+ * Commandes: USER PASS TYPE NOOP SYST FEAT PWD EPSV PASV SIZE MDTM REST RETR STOR APPE MLSD LIST
+ * DELE QUIT. Chaque session de contrôle a son thread; les réglages se lisent à chaque commande et
+ * peuvent changer pendant un test. */
+class FakeFtpServer {
+ public:
+  struct Options {
+    std::string username{"user"};
+    std::string password{"pass"};
+    bool epsv{true};             // false: EPSV répond 502, le client doit se replier sur PASV
+    bool mlsd{true};             // false: MLSD répond 500, le client doit se replier sur LIST
+    bool rest{true};             // false: REST répond 502
+    int max_sessions{0};         // > 0: sessions au-delà refusées par "421 Too many connections"
+    uint32_t reply_delay_ms{0};  // Latence ajoutée avant chaque réponse de contrôle (aller-retour simulé)
+    uint32_t rate_bytes_per_s{0};  // > 0: débit maximal d'un RETR
+    bool ipv6{false};              // Écoute sur ::1 (lu par start()); PASV répond alors 522
+    std::string pasv_address{"127,0,0,1"};  // Adresse annoncée par PASV, fausse derrière un NAT
+    uint32_t refuse_retr_session{0};  // > 0: la n-ième session ouverte répond 425 à chaque RETR
+  };
+
+  FakeFtpServer() = default;
+  explicit FakeFtpServer(const Options &options) : options_(options) {}
+  ~FakeFtpServer() { stop(); }
+
+  bool start();
+  void stop();
+  uint16_t port() const { return port_; }
+
+  void set_options(const Options &options);
+  Options options();
+
+  // Chemins sans '/' initial ("films/a.mkv"); les répertoires découlent des chemins
+  void add_file(const std::string &path, const std::string &content, time_t modified = 1700000000);
+  bool get_file(const std::string &path, std::string &content);
+  void remove_file(const std::string &path);
+  // Coupe les sessions de contrôle ouvertes (redémarrage ou délai d'inactivité côté serveur)
+  void drop_sessions();
+
+  // Compteurs depuis le démarrage
+  uint32_t logins() const { return logins_; }
+  uint32_t sessions_opened() const { return sessions_opened_; }
+  uint32_t sessions_refused() const { return sessions_refused_; }
+  uint32_t active_sessions() const { return active_sessions_; }
+  uint32_t count(const std::string &command);
+  void reset_counters();
+
+ protected:
+  struct File {
+    std::string content;
+    time_t modified;
+  };
+
+  static void *accept_thread(void *param);
+  static void *session_thread(void *param);
+  void run_session(int sock, uint32_t number);
+  void record_command(const std::string &command);
+
+  Options options_;
+  std::mutex mutex_;  // options_, files_, commands_
+  std::map<std::string, File> files_;
+  std::map<std::string, uint32_t> commands_;
+  int listen_fd_{-1};
+  uint16_t port_{0};
+  bool ipv6_{false};
+  std::atomic<bool> running_{false};
+  std::atomic<uint32_t> logins_{0};
+  std::atomic<uint32_t> sessions_opened_{0};
+  std::atomic<uint32_t> sessions_refused_{0};
+  std::atomic<uint32_t> active_sessions_{0};
+};
+
+}  // namespace host
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,37 @@
+#!/usr/bin/env python3
+"""Globales normalement émises par __init__.py (interface compressée, table MIME vide) pour la cible hôte.
+
+Usage: gen_assets.py <web/index.html> <sortie.cpp>
+Même compression et même ETag que gzip_asset()/asset_definition() du composant.
+"""
+import gzip
+import hashlib
+import sys
+
+
+def main():
+    source, output = sys.argv[1], sys.argv[2]
+    with open(source, 'rb') as f:
+        compressed = gzip.compress(f.read(), compresslevel=9, mtime=0)
+    etag = '"' + hashlib.sha1(compressed).hexdigest()[:16] + '"'
+    rows = []
+    for i in range(0, len(compressed), 16):
+        rows.append('  ' + ', '.join('0x%02x' % b for b in compressed[i:i + 16]) + ',')
+    escaped_etag = etag.replace('"', '\\"')
+    with open(output, 'w') as f:
+        f.write(
+            '// Généré par host/gen_assets.py, ne pas modifier\n'
+            '#include <cstddef>\n#include <cstdint>\n#include "mime_types.h"\n\n'
+            'namespace esphome {\nnamespace ftp_http_proxy {\n'
+            'extern const uint8_t INDEX_HTML_GZ[] = {\n' + '\n'.join(rows) + '\n};\n'
+            f'extern const size_t INDEX_HTML_GZ_SIZE = {len(compressed)};\n'
+            f'extern const char INDEX_HTML_ETAG[] = "{escaped_etag}";\n'
+            '// Un tableau C++ ne peut pas être vide: entrée sentinelle jamais consultée (compte à 0)\n'
+            'extern const MimeType MIME_TYPES_EXTRA[] = {\n  {"", "", 0},\n};\n'
+            'extern const size_t MIME_TYPES_EXTRA_COUNT = 0;\n'
+            '}  // namespace ftp_http_proxy\n}  // namespace esphome\n'
+        )
+
+
+if __name__ == '__main__':
+    main()
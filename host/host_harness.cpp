@@ -0,0 +1,55 @@
+#include "host_harness.h"
+#include "host_platform.h"
+#include <chrono>
+
+namespace esphome {
+namespace ftp_http_proxy {
+namespace host {
+
+// Passages de loop() attendus avant setup_http_server(), avec une marge
+static const int MAX_STARTUP_LOOPS = 20;
+
+ProxyHarness::ProxyHarness(FakeFtpServer &ftp) {
+  FakeFtpServer::Options options = ftp.options();
+  proxy_->set_ftp_server(options.ipv6 ? "::1" : "127.0.0.1");
+  proxy_->set_ftp_port(ftp.port());
+  proxy_->set_username(options.username);
+  proxy_->set_password(options.password);
+  proxy_->set_local_port(0);
+  proxy_->set_relay_use_psram(false);
+}
+
+ProxyHarness::~ProxyHarness() {
+  running_ = false;
+  if (loop_thread_.joinable()) {
+    loop_thread_.join();
+  }
+}
+
+bool ProxyHarness::start() {
+  proxy_->setup();
+  if (proxy_->is_failed()) {
+    return false;
+  }
+  for (int i = 0; i < MAX_STARTUP_LOOPS && host_httpd_last_started() == nullptr; i++) {
+    proxy_->loop();
+  }
+  httpd_handle_t server = host_httpd_last_started();
+  if (server == nullptr) {
+    return false;
+  }
+  http_port_ = host_httpd_port(server);
+
+  running_ = true;
+  loop_thread_ = std::thread([this]() {
+    while (running_) {
+      proxy_->loop();
+      std::this_thread::sleep_for(std::chrono::milliseconds(HARNESS_LOOP_INTERVAL_MS));
+    }
+  });
+  return true;
+}
+
+}  // namespace host
+}  // namespace ftp_http_proxy
+}  // namespace esphome
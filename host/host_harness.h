@@ -0,0 +1,43 @@
+#pragma once
+
+// Proxy complet dans le processus de test: FTPHTTPProxy configuré vers un FakeFtpServer, serveur
+// HTTP sur un port choisi par le noyau, loop() appelée en tâche de fond comme par ESPHome.
+
+#include "fake_ftp_server.h"
+#include "ftp_http_proxy.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace esphome {
+namespace ftp_http_proxy {
+namespace host {
+
+// Intervalle entre deux appels de loop(), proche de celui d'ESPHome
+static const uint32_t HARNESS_LOOP_INTERVAL_MS = 16;
+
+class ProxyHarness {
+ public:
+  // Serveur FTP, identifiants et port local déjà renseignés; le reste se règle par proxy()
+  explicit ProxyHarness(FakeFtpServer &ftp);
+  ~ProxyHarness();
+
+  FTPHTTPProxy &proxy() { return *proxy_; }
+  // setup(), puis loop() jusqu'au démarrage du serveur HTTP. Une seule fois par processus:
+  // le compteur de démarrage de loop() est statique.
+  bool start();
+  uint16_t http_port() const { return http_port_; }
+
+ protected:
+  // Jamais détruit: le composant, comme sous ESPHome, vit autant que le programme et ses
+  // workers ne s'arrêtent pas
+  FTPHTTPProxy *proxy_{new FTPHTTPProxy()};
+  std::thread loop_thread_;
+  std::atomic<bool> running_{false};
+  uint16_t http_port_{0};
+};
+
+}  // namespace host
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,182 @@
+#include "http_client.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+
+namespace esphome {
+namespace ftp_http_proxy {
+namespace host {
+
+static const int CLIENT_TIMEOUT_S = 30;
+
+static int64_t now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Lecture tamponnée: l'en-tête, les tailles de blocs et le corps passent par le même buffer
+class Reader {
+ public:
+  explicit Reader(int sock) : sock_(sock) {}
+
+  bool fill() {
+    if (pos_ < buffer_.size()) {
+      return true;
+    }
+    buffer_.resize(64 * 1024);
+    ssize_t received = recv(sock_, &buffer_[0], buffer_.size(), 0);
+    if (received <= 0) {
+      buffer_.clear();
+      pos_ = 0;
+      return false;
+    }
+    buffer_.resize(received);
+    pos_ = 0;
+    return true;
+  }
+
+  bool read_line(std::string &line) {
+    line.clear();
+    while (fill()) {
+      size_t end = buffer_.find('\n', pos_);
+      if (end == std::string::npos) {
+        line.append(buffer_, pos_, std::string::npos);
+        pos_ = buffer_.size();
+        continue;
+      }
+      line.append(buffer_, pos_, end - pos_);
+      pos_ = end + 1;
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      return true;
+    }
+    return false;
+  }
+
+  // Jusqu'à max octets (SIZE_MAX: jusqu'à la fermeture); false si la connexion se ferme avant
+  bool read_body(size_t max, HttpResult &result, bool keep) {
+    while (max > 0 && fill()) {
+      size_t len = std::min(max, buffer_.size() - pos_);
+      if (keep) {
+        result.body.append(buffer_, pos_, len);
+      }
+      result.body_bytes += len;
+      pos_ += len;
+      if (max != SIZE_MAX) {
+        max -= len;
+      }
+    }
+    return max == 0;
+  }
+
+ protected:
+  int sock_;
+  std::string buffer_;
+  size_t pos_{0};
+};
+
+bool http_request(uint16_t port, const HttpRequest &request, HttpResult &result) {
+  result = HttpResult();
+  int64_t start = now_us();
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock < 0) {
+    return false;
+  }
+  struct timeval timeout = {CLIENT_TIMEOUT_S, 0};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  int flag = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+    close(sock);
+    return false;
+  }
+
+  std::string head = request.method + " " + request.path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n" +
+                     request.headers;
+  if (!request.body.empty() || request.method == "POST" || request.method == "PUT") {
+    head += "Content-Length: " + std::to_string(request.body.size()) + "\r\n";
+  }
+  head += "\r\n";
+  std::string out = head + request.body;
+  int64_t sent_at = now_us();
+  for (size_t pos = 0; pos < out.size();) {
+    ssize_t sent = send(sock, out.data() + pos, out.size() - pos, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      close(sock);
+      return false;
+    }
+    pos += sent;
+  }
+
+  Reader reader(sock);
+  if (!reader.fill()) {
+    close(sock);
+    return false;
+  }
+  result.ttfb_us = now_us() - sent_at;
+  std::string line;
+  if (!reader.read_line(line) || line.compare(0, 5, "HTTP/") != 0 || line.size() < 12) {
+    close(sock);
+    return false;
+  }
+  result.status = atoi(line.c_str() + 9);
+  while (reader.read_line(line) && !line.empty()) {
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    std::string name = line.substr(0, colon);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    size_t value_start = line.find_first_not_of(' ', colon + 1);
+    result.headers[name] = value_start == std::string::npos ? "" : line.substr(value_start);
+  }
+
+  if (request.method == "HEAD" || result.status == 204 || result.status == 304) {
+    result.complete = true;
+  } else if (result.headers.count("content-length") != 0) {
+    result.complete = reader.read_body(strtoull(result.headers["content-length"].c_str(), nullptr, 10), result,
+                                       request.keep_body);
+  } else if (result.headers["transfer-encoding"] == "chunked") {
+    while (reader.read_line(line)) {
+      size_t chunk = strtoul(line.c_str(), nullptr, 16);
+      if (chunk == 0) {
+        result.complete = reader.read_line(line);
+        break;
+      }
+      if (!reader.read_body(chunk, result, request.keep_body) || !reader.read_line(line)) {
+        break;
+      }
+    }
+  } else {
+    reader.read_body(SIZE_MAX, result, request.keep_body);
+    result.complete = true;
+  }
+  close(sock);
+  result.total_us = now_us() - start;
+  return true;
+}
+
+HttpResult http_get(uint16_t port, const std::string &path, const std::string &headers) {
+  HttpRequest request;
+  request.path = path;
+  request.headers = headers;
+  HttpResult result;
+  http_request(port, request, result);
+  return result;
+}
+
+}  // namespace host
+}  // namespace ftp_http_proxy
+}  // namespace esphome
@@ -0,0 +1,39 @@
+#pragma once
+
+// Client HTTP/1.1 minimal des tests et des mesures: une connexion par requête (Connection: close),
+// corps à longueur fixe, découpé (chunked) ou jusqu'à la fermeture.
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace esphome {
+namespace ftp_http_proxy {
+namespace host {
+
+struct HttpResult {
+  int status{0};  // 0: pas de réponse (connexion refusée, coupée avant l'en-tête)
+  std::map<std::string, std::string> headers;  // Noms en minuscules
+  std::string body;   // Vide si le corps n'est pas conservé
+  size_t body_bytes{0};
+  bool complete{false};  // Corps reçu en entier (longueur annoncée ou dernier bloc)
+  int64_t ttfb_us{0};    // Envoi de la requête -> premier octet de la réponse
+  int64_t total_us{0};   // Connexion -> dernier octet du corps
+};
+
+struct HttpRequest {
+  std::string method{"GET"};
+  std::string path{"/"};
+  std::string headers;  // Lignes supplémentaires, chacune terminée par \r\n
+  std::string body;
+  bool keep_body{true};  // false: octets seulement comptés (mesures de débit)
+};
+
+bool http_request(uint16_t port, const HttpRequest &request, HttpResult &result);
+// Raccourci pour un GET dont le corps est conservé
+HttpResult http_get(uint16_t port, const std::string &path, const std::string &headers = "");
+
+}  // namespace host
+}  // namespace ftp_http_proxy
+}  // namespace esphome
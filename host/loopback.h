@@ -0,0 +1,35 @@
+#pragma once
+
+// Connexions TCP sur 127.0.0.1 pour les tests et mesures qui n'ont pas besoin du proxy complet
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace esphome {
+namespace ftp_http_proxy {
+namespace host {
+
+// Deux extrémités connectées d'une même connexion
+inline bool tcp_pair(int &client, int &server) {
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  if (bind(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(listener, 1) != 0 ||
+      getsockname(listener, (struct sockaddr *) &addr, &addr_len) != 0) {
+    close(listener);
+    return false;
+  }
+  client = socket(AF_INET, SOCK_STREAM, 0);
+  bool connected = connect(client, (struct sockaddr *) &addr, sizeof(addr)) == 0;
+  server = connected ? accept(listener, nullptr, nullptr) : -1;
+  close(listener);
+  return server >= 0;
+}
+
+}  // namespace host
+}  // namespace ftp_http_proxy
+}  // namespace esphome
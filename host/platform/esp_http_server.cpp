@@ -0,0 +1,674 @@
+#include <esp_http_server.h>
+#include "esphome/core/log.h"
+#include "host_platform.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const char *TAG = "httpd";
+
+// Taille maximale de la ligne de requête et des en-têtes réunis
+static const size_t MAX_REQUEST_HEAD = 8192;
+
+struct HttpdServer;
+
+// Connexion client, servie par son propre thread
+struct HttpdSession {
+  HttpdServer *server;
+  int fd;
+  std::string input;  // Octets reçus au-delà de ce qui a été consommé (corps, requête suivante)
+  std::mutex mutex;
+  std::condition_variable async_done;
+  int async_pending{0};  // Copies asynchrones de la requête pas encore rendues
+  std::atomic<bool> close_requested{false};
+};
+
+// État d'une requête, pointé par httpd_req_t::aux (partagé avec ses copies asynchrones)
+struct HttpdRequestState {
+  HttpdSession *session;
+  std::vector<std::pair<std::string, std::string>> headers;
+  size_t remaining{0};  // Octets du corps pas encore lus
+  std::string status{"200 OK"};
+  std::string content_type{HTTPD_TYPE_TEXT};
+  std::vector<std::pair<std::string, std::string>> resp_headers;
+  bool chunked{false};  // En-têtes d'une réponse chunked déjà envoyés
+};
+
+struct HttpdHandler {
+  std::string uri;
+  httpd_uri_t info;
+};
+
+struct HttpdServer {
+  httpd_config_t config;
+  int listen_fd{-1};
+  uint16_t port{0};
+  std::atomic<bool> running{true};
+  std::mutex mutex;
+  std::vector<HttpdHandler> handlers;
+  std::map<int, HttpdSession *> sessions;
+};
+
+static std::atomic<HttpdServer *> last_started{nullptr};
+
+static HttpdRequestState *state_of(httpd_req_t *r) { return (HttpdRequestState *) r->aux; }
+
+static bool send_raw(int fd, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    len -= sent;
+  }
+  return true;
+}
+
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto) {
+  // '*' final: n'importe quelle suite; '?' final: caractère précédent facultatif; "?*" et "*?" combinés
+  size_t template_len = strlen(uri_template);
+  char last = template_len > 0 ? uri_template[template_len - 1] : '\0';
+  char before_last = template_len > 1 ? uri_template[template_len - 2] : '\0';
+  bool asterisk = last == '*' || (before_last == '*' && last == '?');
+  bool question = last == '?' || (before_last == '?' && last == '*');
+
+  size_t special = (asterisk ? 1 : 0) + (question ? 2 : 0);
+  if (template_len < special) {
+    return false;
+  }
+  size_t exact = template_len - special;
+  if (match_upto < exact) {
+    return false;
+  }
+  if (!question) {
+    if (!asterisk && match_upto != exact) {
+      return false;
+    }
+    return strncmp(uri_template, uri_to_match, exact) == 0;
+  }
+  if (match_upto > exact && uri_template[exact] != uri_to_match[exact]) {
+    return false;
+  }
+  if (strncmp(uri_template, uri_to_match, exact) != 0) {
+    return false;
+  }
+  return asterisk || match_upto <= exact + 1;
+}
+
+static const char *method_name(int method) {
+  switch (method) {
+    case HTTP_DELETE:
+      return "DELETE";
+    case HTTP_GET:
+      return "GET";
+    case HTTP_HEAD:
+      return "HEAD";
+    case HTTP_POST:
+      return "POST";
+    case HTTP_PUT:
+      return "PUT";
+    default:
+      return "?";
+  }
+}
+
+static int parse_method(const std::string &name) {
+  for (int method = HTTP_DELETE; method <= HTTP_PUT; method++) {
+    if (name == method_name(method)) {
+      return method;
+    }
+  }
+  return -1;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status) {
+  state_of(r)->status = status;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type) {
+  state_of(r)->content_type = type;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value) {
+  HttpdRequestState *state = state_of(r);
+  if (state->resp_headers.size() >= state->session->server->config.max_resp_headers) {
+    return ESP_ERR_HTTPD_RESP_HDR;
+  }
+  state->resp_headers.emplace_back(field, value);
+  return ESP_OK;
+}
+
+static std::string response_head(HttpdRequestState *state, const char *length_header) {
+  std::string head = "HTTP/1.1 " + state->status + "\r\nContent-Type: " + state->content_type + "\r\n";
+  head += length_header;
+  for (auto &header : state->resp_headers) {
+    head += header.first + ": " + header.second + "\r\n";
+  }
+  head += "\r\n";
+  return head;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+  HttpdRequestState *state = state_of(r);
+  size_t len = buf == nullptr ? 0 : buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t) buf_len;
+  char length_header[48];
+  snprintf(length_header, sizeof(length_header), "Content-Length: %u\r\n", (unsigned) len);
+  std::string head = response_head(state, length_header);
+  if (!send_raw(state->session->fd, head.data(), head.size()) || !send_raw(state->session->fd, buf, len)) {
+    return ESP_ERR_HTTPD_RESP_SEND;
+  }
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+  HttpdRequestState *state = state_of(r);
+  int fd = state->session->fd;
+  if (!state->chunked) {
+    std::string head = response_head(state, "Transfer-Encoding: chunked\r\n");
+    if (!send_raw(fd, head.data(), head.size())) {
+      return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    state->chunked = true;
+  }
+  size_t len = buf == nullptr ? 0 : buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t) buf_len;
+  char size_line[16];
+  snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned) len);
+  if (!send_raw(fd, size_line, strlen(size_line)) || !send_raw(fd, buf, len) || !send_raw(fd, "\r\n", 2)) {
+    return ESP_ERR_HTTPD_RESP_SEND;
+  }
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg) {
+  const char *status;
+  const char *default_msg;
+  switch (error) {
+    case HTTPD_501_METHOD_NOT_IMPLEMENTED:
+      status = "501 Method Not Implemented";
+      default_msg = "Server does not support this method";
+      break;
+    case HTTPD_505_VERSION_NOT_SUPPORTED:
+      status = "505 Version Not Supported";
+      default_msg = "HTTP version not supported by server";
+      break;
+    case HTTPD_400_BAD_REQUEST:
+      status = "400 Bad Request";
+      default_msg = "Bad request syntax";
+      break;
+    case HTTPD_401_UNAUTHORIZED:
+      status = "401 Unauthorized";
+      default_msg = "No permission -- see authorization schemes";
+      break;
+    case HTTPD_403_FORBIDDEN:
+      status = "403 Forbidden";
+      default_msg = "Request forbidden -- authorization will not help";
+      break;
+    case HTTPD_404_NOT_FOUND:
+      status = "404 Not Found";
+      default_msg = "Nothing matches the given URI";
+      break;
+    case HTTPD_405_METHOD_NOT_ALLOWED:
+      status = "405 Method Not Allowed";
+      default_msg = "Specified method is invalid for this resource";
+      break;
+    case HTTPD_408_REQ_TIMEOUT:
+      status = "408 Request Timeout";
+      default_msg = "Server closed this connection";
+      break;
+    case HTTPD_411_LENGTH_REQUIRED:
+      status = "411 Length Required";
+      default_msg = "Chunked encoding not supported";
+      break;
+    case HTTPD_414_URI_TOO_LONG:
+      status = "414 URI Too Long";
+      default_msg = "URI is too long";
+      break;
+    case HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE:
+      status = "431 Request Header Fields Too Large";
+      default_msg = "Header fields are too long";
+      break;
+    default:
+      status = "500 Internal Server Error";
+      default_msg = "Server has encountered an unexpected error";
+      break;
+  }
+  httpd_resp_set_status(req, status);
+  httpd_resp_set_type(req, HTTPD_TYPE_TEXT);
+  return httpd_resp_sendstr(req, msg != nullptr ? msg : default_msg);
+}
+
+int httpd_send(httpd_req_t *r, const char *buf, size_t buf_len) {
+  ssize_t sent = send(state_of(r)->session->fd, buf, buf_len, MSG_NOSIGNAL);
+  if (sent < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+  }
+  return (int) sent;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len) {
+  HttpdRequestState *state = state_of(r);
+  HttpdSession *session = state->session;
+  size_t wanted = std::min(buf_len, state->remaining);
+  if (wanted == 0) {
+    return 0;
+  }
+  if (!session->input.empty()) {
+    size_t len = std::min(wanted, session->input.size());
+    memcpy(buf, session->input.data(), len);
+    session->input.erase(0, len);
+    state->remaining -= len;
+    return (int) len;
+  }
+  ssize_t received = recv(session->fd, buf, wanted, 0);
+  if (received < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+  }
+  state->remaining -= received;
+  return (int) received;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r) { return state_of(r)->session->fd; }
+
+static const std::string *find_header(httpd_req_t *r, const char *field) {
+  for (auto &header : state_of(r)->headers) {
+    if (strcasecmp(header.first.c_str(), field) == 0) {
+      return &header.second;
+    }
+  }
+  return nullptr;
+}
+
+// Copie tronquée à la manière d'ESP-IDF: toujours terminée par un zéro, ESP_ERR_HTTPD_RESULT_TRUNC si coupée
+static esp_err_t copy_value(const char *value, size_t len, char *out, size_t out_size) {
+  if (out_size == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  size_t copied = std::min(len, out_size - 1);
+  memcpy(out, value, copied);
+  out[copied] = '\0';
+  return copied < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field) {
+  const std::string *value = find_header(r, field);
+  return value != nullptr ? value->size() : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size) {
+  const std::string *value = find_header(r, field);
+  if (value == nullptr) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  return copy_value(value->data(), value->size(), val, val_size);
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r) {
+  const char *query = strchr(r->uri, '?');
+  return query != nullptr ? strlen(query + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len) {
+  const char *query = strchr(r->uri, '?');
+  if (query == nullptr) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  return copy_value(query + 1, strlen(query + 1), buf, buf_len);
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size) {
+  size_t key_len = strlen(key);
+  const char *pair = qry;
+  while (pair != nullptr && *pair != '\0') {
+    const char *end = strchr(pair, '&');
+    size_t pair_len = end != nullptr ? (size_t) (end - pair) : strlen(pair);
+    if (pair_len > key_len && strncmp(pair, key, key_len) == 0 && pair[key_len] == '=') {
+      return copy_value(pair + key_len + 1, pair_len - key_len - 1, val, val_size);
+    }
+    pair = end != nullptr ? end + 1 : nullptr;
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out) {
+  // uri[] constant: la structure se copie octet par octet, comme dans ESP-IDF
+  auto *copy = (httpd_req_t *) malloc(sizeof(httpd_req_t));
+  if (copy == nullptr) {
+    return ESP_ERR_NO_MEM;
+  }
+  memcpy((void *) copy, r, sizeof(*copy));
+  HttpdSession *session = state_of(r)->session;
+  std::lock_guard<std::mutex> lock(session->mutex);
+  session->async_pending++;
+  *out = copy;
+  return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r) {
+  HttpdSession *session = state_of(r)->session;
+  free(r);
+  {
+    std::lock_guard<std::mutex> lock(session->mutex);
+    session->async_pending--;
+  }
+  session->async_done.notify_all();
+  return ESP_OK;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd) {
+  auto *server = (HttpdServer *) handle;
+  std::lock_guard<std::mutex> lock(server->mutex);
+  auto it = server->sessions.find(sockfd);
+  if (it == server->sessions.end()) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  it->second->close_requested = true;
+  return ESP_OK;
+}
+
+// Lit la ligne de requête et les en-têtes. false: connexion terminée (fermée par le client, délai
+// dépassé au milieu d'une requête, requête invalide à laquelle une erreur a déjà été répondue)
+static bool read_request_head(HttpdSession *session, std::string &head) {
+  while (true) {
+    size_t end = session->input.find("\r\n\r\n");
+    if (end != std::string::npos) {
+      head = session->input.substr(0, end + 2);
+      session->input.erase(0, end + 4);
+      return true;
+    }
+    if (session->input.size() > MAX_REQUEST_HEAD) {
+      const char reply[] = "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\n\r\n";
+      send_raw(session->fd, reply, sizeof(reply) - 1);
+      return false;
+    }
+    char chunk[2048];
+    ssize_t received = recv(session->fd, chunk, sizeof(chunk), 0);
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Connexion au repos entre deux requêtes: on continue d'attendre, comme le select() d'ESP-IDF
+      if (session->input.empty() && session->server->running && !session->close_requested) {
+        continue;
+      }
+      return false;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    session->input.append(chunk, received);
+  }
+}
+
+static void send_simple_error(httpd_req_t *req, httpd_err_code_t error) { httpd_resp_send_err(req, error, nullptr); }
+
+// Traite une requête; false si la connexion doit être fermée ensuite
+static bool handle_request(HttpdSession *session, const std::string &head) {
+  HttpdServer *server = session->server;
+  HttpdRequestState state;
+  state.session = session;
+  alignas(httpd_req_t) unsigned char req_storage[sizeof(httpd_req_t)] = {};
+  httpd_req_t &req = *(httpd_req_t *) req_storage;
+  req.handle = server;
+  req.aux = &state;
+
+  size_t line_end = head.find("\r\n");
+  std::string request_line = head.substr(0, line_end);
+  size_t first_space = request_line.find(' ');
+  size_t last_space = request_line.rfind(' ');
+  if (first_space == std::string::npos || last_space == first_space) {
+    send_simple_error(&req, HTTPD_400_BAD_REQUEST);
+    return false;
+  }
+  std::string version = request_line.substr(last_space + 1);
+  std::string uri = request_line.substr(first_space + 1, last_space - first_space - 1);
+  req.method = parse_method(request_line.substr(0, first_space));
+  if (req.method < 0) {
+    send_simple_error(&req, HTTPD_501_METHOD_NOT_IMPLEMENTED);
+    return false;
+  }
+  if (version != "HTTP/1.1" && version != "HTTP/1.0") {
+    send_simple_error(&req, HTTPD_505_VERSION_NOT_SUPPORTED);
+    return false;
+  }
+  if (uri.size() > HTTPD_MAX_URI_LEN) {
+    send_simple_error(&req, HTTPD_414_URI_TOO_LONG);
+    return false;
+  }
+  memcpy((void *) req.uri, uri.c_str(), uri.size() + 1);
+
+  for (size_t pos = line_end + 2; pos < head.size();) {
+    size_t end = head.find("\r\n", pos);
+    std::string line = head.substr(pos, end - pos);
+    pos = end + 2;
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      send_simple_error(&req, HTTPD_400_BAD_REQUEST);
+      return false;
+    }
+    if (line.size() > HTTPD_MAX_REQ_HDR_LEN) {
+      send_simple_error(&req, HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE);
+      return false;
+    }
+    size_t value_start = line.find_first_not_of(" \t", colon + 1);
+    state.headers.emplace_back(line.substr(0, colon),
+                               value_start == std::string::npos ? "" : line.substr(value_start));
+  }
+
+  char value[32];
+  if (httpd_req_get_hdr_value_str(&req, "Transfer-Encoding", value, sizeof(value)) != ESP_ERR_NOT_FOUND) {
+    send_simple_error(&req, HTTPD_411_LENGTH_REQUIRED);
+    return false;
+  }
+  if (httpd_req_get_hdr_value_str(&req, "Content-Length", value, sizeof(value)) == ESP_OK) {
+    req.content_len = strtoull(value, nullptr, 10);
+  }
+  state.remaining = req.content_len;
+  bool keep_alive = version == "HTTP/1.1";
+  if (httpd_req_get_hdr_value_str(&req, "Connection", value, sizeof(value)) == ESP_OK) {
+    keep_alive = strcasecmp(value, "close") != 0 && (keep_alive || strcasecmp(value, "keep-alive") == 0);
+  }
+
+  // Premier handler dont l'URI correspond (chemin sans la requête) et la méthode aussi
+  size_t path_len = strcspn(req.uri, "?");
+  httpd_uri_t handler = {};
+  bool uri_matched = false;
+  {
+    std::lock_guard<std::mutex> lock(server->mutex);
+    for (auto &candidate : server->handlers) {
+      bool match = server->config.uri_match_fn != nullptr
+                       ? server->config.uri_match_fn(candidate.uri.c_str(), req.uri, path_len)
+                       : candidate.uri.size() == path_len && strncmp(candidate.uri.c_str(), req.uri, path_len) == 0;
+      if (!match) {
+        continue;
+      }
+      uri_matched = true;
+      if (candidate.info.method == req.method) {
+        handler = candidate.info;
+        break;
+      }
+    }
+  }
+  if (handler.handler == nullptr) {
+    ESP_LOGW(TAG, "Aucun handler pour %s %s", method_name(req.method), req.uri);
+    send_simple_error(&req, uri_matched ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND);
+    return false;
+  }
+
+  req.user_ctx = handler.user_ctx;
+  esp_err_t result = handler.handler(&req);
+
+  // Requête passée à un worker: la session reste suspendue jusqu'à sa complétion
+  {
+    std::unique_lock<std::mutex> lock(session->mutex);
+    session->async_done.wait(lock, [session] { return session->async_pending == 0; });
+  }
+  if (result != ESP_OK) {
+    ESP_LOGW(TAG, "Le handler de %s a échoué, connexion fermée", req.uri);
+    return false;
+  }
+  if (session->close_requested || !keep_alive) {
+    return false;
+  }
+  for (auto &header : state.resp_headers) {
+    if (strcasecmp(header.first.c_str(), "Connection") == 0 && strcasecmp(header.second.c_str(), "close") == 0) {
+      return false;
+    }
+  }
+
+  // Corps laissé de côté par le handler: purgé pour retrouver le début de la requête suivante
+  char discard[1024];
+  while (state.remaining > 0) {
+    int received = httpd_req_recv(&req, discard, sizeof(discard));
+    if (received <= 0 && received != HTTPD_SOCK_ERR_TIMEOUT) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void *session_thread(void *param) {
+  auto *session = (HttpdSession *) param;
+  HttpdServer *server = session->server;
+  std::string head;
+  while (server->running && !session->close_requested && read_request_head(session, head)) {
+    if (!handle_request(session, head)) {
+      break;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(server->mutex);
+    server->sessions.erase(session->fd);
+  }
+  close(session->fd);
+  delete session;
+  return nullptr;
+}
+
+static void *accept_thread(void *param) {
+  auto *server = (HttpdServer *) param;
+  pthread_setname_np(pthread_self(), "httpd");
+  while (server->running) {
+    int fd = accept(server->listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      break;
+    }
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    struct timeval recv_timeout = {.tv_sec = server->config.recv_wait_timeout, .tv_usec = 0};
+    struct timeval send_timeout = {.tv_sec = server->config.send_wait_timeout, .tv_usec = 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+    auto *session = new HttpdSession;
+    session->server = server;
+    session->fd = fd;
+    {
+      std::lock_guard<std::mutex> lock(server->mutex);
+      server->sessions[fd] = session;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, session_thread, session) != 0) {
+      std::lock_guard<std::mutex> lock(server->mutex);
+      server->sessions.erase(fd);
+      close(fd);
+      delete session;
+      continue;
+    }
+    pthread_detach(thread);
+  }
+  return nullptr;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config) {
+  // lwIP n'a pas de signaux: un client parti fait seulement échouer send(), splice() ou sendfile()
+  signal(SIGPIPE, SIG_IGN);
+  int fd = socket(AF_INET6, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return ESP_FAIL;
+  }
+  int flag = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+  int v6only = 0;
+  setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+
+  struct sockaddr_in6 addr = {};
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(config->server_port);
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, std::max<int>(config->backlog_conn, 16)) != 0) {
+    ESP_LOGE(TAG, "Port %u indisponible: %s", config->server_port, strerror(errno));
+    close(fd);
+    return ESP_FAIL;
+  }
+  socklen_t addr_len = sizeof(addr);
+  getsockname(fd, (struct sockaddr *) &addr, &addr_len);
+
+  auto *server = new HttpdServer;
+  server->config = *config;
+  server->listen_fd = fd;
+  server->port = ntohs(addr.sin6_port);
+
+  pthread_t thread;
+  if (pthread_create(&thread, nullptr, accept_thread, server) != 0) {
+    close(fd);
+    delete server;
+    return ESP_ERR_HTTPD_TASK;
+  }
+  pthread_detach(thread);
+  last_started = server;
+  *handle = server;
+  return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle) {
+  auto *server = (HttpdServer *) handle;
+  server->running = false;
+  // Débloque accept(); les sessions se terminent d'elles-mêmes. Le serveur n'est pas libéré:
+  // un worker peut encore tenir une requête asynchrone qui y fait référence.
+  shutdown(server->listen_fd, SHUT_RDWR);
+  std::lock_guard<std::mutex> lock(server->mutex);
+  for (auto &session : server->sessions) {
+    shutdown(session.first, SHUT_RD);
+  }
+  return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler) {
+  auto *server = (HttpdServer *) handle;
+  std::lock_guard<std::mutex> lock(server->mutex);
+  if (server->handlers.size() >= server->config.max_uri_handlers) {
+    return ESP_ERR_HTTPD_HANDLERS_FULL;
+  }
+  for (auto &existing : server->handlers) {
+    if (existing.uri == uri_handler->uri && existing.info.method == uri_handler->method) {
+      return ESP_ERR_HTTPD_HANDLER_EXISTS;
+    }
+  }
+  server->handlers.push_back({uri_handler->uri, *uri_handler});
+  return ESP_OK;
+}
+
+uint16_t host_httpd_port(httpd_handle_t handle) { return ((HttpdServer *) handle)->port; }
+
+httpd_handle_t host_httpd_last_started() { return last_started.load(); }
@@ -0,0 +1,317 @@
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "host_platform.h"
+#include "nvs.h"
+#include <sys/random.h>
+#include <time.h>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+int64_t esp_timer_get_time() {
+  // Temps écoulé depuis le démarrage de la machine: jamais nul, comme sur l'appareil où le
+  // composant démarre bien après le boot (0 y signifie souvent "pas encore horodaté")
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+    case ESP_OK:
+      return "ESP_OK";
+    case ESP_FAIL:
+      return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+      return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+      return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+      return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+      return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_TIMEOUT:
+      return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_FOUND:
+      return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_INVALID_LENGTH:
+      return "ESP_ERR_NVS_INVALID_LENGTH";
+    case ESP_ERR_WIFI_NOT_CONNECT:
+      return "ESP_ERR_WIFI_NOT_CONNECT";
+    default:
+      return "UNKNOWN ERROR";
+  }
+}
+
+uint32_t esp_random() {
+  uint32_t value;
+  esp_fill_random(&value, sizeof(value));
+  return value;
+}
+
+void esp_fill_random(void *buf, size_t len) {
+  auto *out = (uint8_t *) buf;
+  while (len > 0) {
+    ssize_t got = getrandom(out, len, 0);
+    if (got <= 0) {
+      abort();
+    }
+    out += got;
+    len -= got;
+  }
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+  static uint32_t table[256];
+  static std::once_flag table_ready;
+  std::call_once(table_ready, [] {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; bit++) {
+        value = (value >> 1) ^ (value & 1 ? 0xEDB88320u : 0);
+      }
+      table[i] = value;
+    }
+  });
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) {
+    crc = table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// Tailles annoncées d'un ESP32-S3 N16R8 au démarrage; aucune comptabilité des allocations
+static const size_t HOST_INTERNAL_FREE = 300 * 1024;
+static const size_t HOST_PSRAM_FREE = 8 * 1024 * 1024;
+
+void *heap_caps_malloc(size_t size, uint32_t /* caps */) { return malloc(size); }
+
+void *heap_caps_calloc(size_t count, size_t size, uint32_t /* caps */) { return calloc(count, size); }
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t /* caps */) { return realloc(ptr, size); }
+
+void heap_caps_free(void *ptr) { free(ptr); }
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  return caps & MALLOC_CAP_SPIRAM ? HOST_PSRAM_FREE : HOST_INTERNAL_FREE;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return heap_caps_get_free_size(caps); }
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return heap_caps_get_free_size(caps); }
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info) {
+  memset(ap_info, 0, sizeof(*ap_info));
+  strcpy((char *) ap_info->ssid, "host");
+  return ESP_OK;
+}
+
+// Partitions de données en RAM: le contenu survit aux ouvertures successives (redémarrage simulé)
+struct HostPartition {
+  esp_partition_t info;
+  std::vector<uint8_t> data;
+};
+
+static std::mutex partitions_mutex;
+static std::vector<std::unique_ptr<HostPartition>> partitions;
+
+static const uint32_t FLASH_SECTOR_SIZE = 4096;
+
+bool host_partition_add(const char *label, size_t size) {
+  if (strlen(label) >= sizeof(esp_partition_t::label) || size % FLASH_SECTOR_SIZE != 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(partitions_mutex);
+  for (auto &partition : partitions) {
+    if (strcmp(partition->info.label, label) == 0) {
+      return false;
+    }
+  }
+  auto partition = std::unique_ptr<HostPartition>(new HostPartition);
+  partition->info = {};
+  partition->info.type = ESP_PARTITION_TYPE_DATA;
+  partition->info.subtype = (esp_partition_subtype_t) 0x40;
+  partition->info.size = size;
+  partition->info.erase_size = FLASH_SECTOR_SIZE;
+  strcpy(partition->info.label, label);
+  partition->data.assign(size, 0xFF);
+  partitions.push_back(std::move(partition));
+  return true;
+}
+
+static HostPartition *find_partition(const esp_partition_t *info) {
+  std::lock_guard<std::mutex> lock(partitions_mutex);
+  for (auto &partition : partitions) {
+    if (&partition->info == info) {
+      return partition.get();
+    }
+  }
+  return nullptr;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+  std::lock_guard<std::mutex> lock(partitions_mutex);
+  for (auto &partition : partitions) {
+    if (partition->info.type == type &&
+        (subtype == ESP_PARTITION_SUBTYPE_ANY || partition->info.subtype == subtype) &&
+        (label == nullptr || strcmp(partition->info.label, label) == 0)) {
+      return &partition->info;
+    }
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *info, size_t offset, void *dst, size_t size) {
+  HostPartition *partition = find_partition(info);
+  if (partition == nullptr || offset > info->size || size > info->size - offset) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memcpy(dst, &partition->data[offset], size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *info, size_t offset, const void *src, size_t size) {
+  HostPartition *partition = find_partition(info);
+  if (partition == nullptr || offset > info->size || size > info->size - offset) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  // Comme en NOR flash, une écriture ne peut que faire passer des bits de 1 à 0
+  auto *in = (const uint8_t *) src;
+  for (size_t i = 0; i < size; i++) {
+    partition->data[offset + i] &= in[i];
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *info, size_t offset, size_t size) {
+  HostPartition *partition = find_partition(info);
+  if (partition == nullptr || offset > info->size || size > info->size - offset) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (offset % FLASH_SECTOR_SIZE != 0 || size % FLASH_SECTOR_SIZE != 0) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  memset(&partition->data[offset], 0xFF, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *info, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t /* memory */, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle) {
+  HostPartition *partition = find_partition(info);
+  if (partition == nullptr || offset > info->size || size > info->size - offset) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  // Vue directe sur la RAM de la partition: les écritures suivantes y sont visibles, comme
+  // après une invalidation du cache flash
+  *out_ptr = &partition->data[offset];
+  *out_handle = 0;
+  return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t /* handle */) {}
+
+// NVS: un espace de noms par handle ouvert, clés et valeurs binaires
+static std::mutex nvs_mutex;
+static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs_store;
+static std::map<nvs_handle_t, std::string> nvs_handles;
+static nvs_handle_t nvs_next_handle = 1;
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+  if (namespace_name == nullptr || strlen(namespace_name) > 15) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  if (open_mode == NVS_READONLY && nvs_store.count(namespace_name) == 0) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  nvs_store[namespace_name];
+  *out_handle = nvs_next_handle++;
+  nvs_handles[*out_handle] = namespace_name;
+  return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  nvs_handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  return nvs_handles.count(handle) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+static std::map<std::string, std::vector<uint8_t>> *nvs_namespace(nvs_handle_t handle) {
+  auto it = nvs_handles.find(handle);
+  return it == nvs_handles.end() ? nullptr : &nvs_store[it->second];
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  auto *entries = nvs_namespace(handle);
+  if (entries == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return entries->erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  auto *entries = nvs_namespace(handle);
+  if (entries == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  auto it = entries->find(key);
+  if (it == entries->end()) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  // out_value nul: seule la taille est demandée
+  if (out_value != nullptr) {
+    if (*length < it->second.size()) {
+      return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, it->second.data(), it->second.size());
+  }
+  *length = it->second.size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  auto *entries = nvs_namespace(handle);
+  if (entries == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  auto *bytes = (const uint8_t *) value;
+  (*entries)[key].assign(bytes, bytes + length);
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value) {
+  size_t length = sizeof(*out_value);
+  uint32_t value;
+  esp_err_t err = nvs_get_blob(handle, key, &value, &length);
+  if (err == ESP_OK && length != sizeof(value)) {
+    err = ESP_ERR_NVS_INVALID_LENGTH;
+  }
+  if (err == ESP_OK) {
+    *out_value = value;
+  }
+  return err;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+  return nvs_set_blob(handle, key, &value, sizeof(value));
+}
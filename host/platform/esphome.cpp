@@ -0,0 +1,63 @@
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esp_timer.h"
+#include "host_platform.h"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace esphome {
+
+namespace setup_priority {
+const float BUS = 1000.0f;
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+const float WIFI = 250.0f;
+const float AFTER_WIFI = 200.0f;
+const float AFTER_CONNECTION = 100.0f;
+const float LATE = -100.0f;
+}  // namespace setup_priority
+
+static const char *TAG = "component";
+
+float Component::get_setup_priority() const { return setup_priority::DATA; }
+
+void Component::mark_failed() {
+  ESP_LOGE(TAG, "Composant marqué en échec");
+  failed_ = true;
+}
+
+uint32_t millis() { return (uint32_t) (esp_timer_get_time() / 1000); }
+
+uint32_t micros() { return (uint32_t) esp_timer_get_time(); }
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+static int initial_log_level() {
+  const char *value = getenv("FTP_PROXY_LOG_LEVEL");
+  return value != nullptr ? atoi(value) : ESPHOME_LOG_LEVEL_WARN;
+}
+
+static std::atomic<int> log_level{initial_log_level()};
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) {
+  if (level > log_level.load(std::memory_order_relaxed)) {
+    return;
+  }
+  static const char LETTERS[] = "?EWICDVV";
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  // Une seule écriture par ligne: les lignes de threads différents ne s'entremêlent pas
+  fprintf(stderr, "[%10.3f][%c][%s:%d]: %s\n", esp_timer_get_time() / 1e6, LETTERS[level & 7], tag, line, message);
+}
+
+}  // namespace esphome
+
+void host_log_set_level(int level) { esphome::log_level = level; }
@@ -0,0 +1,204 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <sched.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// File FreeRTOS: anneau d'éléments copiés, protégé par un mutex; deux conditions réveillent
+// les tâches bloquées en envoi ou en réception
+struct HostQueue {
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::vector<uint8_t> storage;
+  size_t item_size;
+  size_t length;
+  size_t head{0};
+  size_t count{0};
+};
+
+struct HostTask {
+  HostTask(const char *name, TaskFunction_t function, void *param) : name(name), function(function), param(param) {}
+
+  std::string name;
+  TaskFunction_t function;
+  void *param;
+  std::mutex mutex;
+  std::condition_variable notified;
+  uint32_t notify_count{0};
+};
+
+// Tâche du thread courant; le thread principal reçoit la sienne au premier appel
+static thread_local HostTask *current_task = nullptr;
+
+// Attend pred() au plus `wait` ticks (portMAX_DELAY: sans limite)
+template<typename Pred>
+static bool wait_for(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, TickType_t wait, Pred pred) {
+  if (wait == portMAX_DELAY) {
+    cond.wait(lock, pred);
+    return true;
+  }
+  return cond.wait_for(lock, std::chrono::milliseconds(wait), pred);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  if (length == 0) {
+    return nullptr;
+  }
+  auto *queue = new HostQueue;
+  queue->item_size = item_size;
+  queue->length = length;
+  queue->storage.resize((size_t) length * item_size);
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!wait_for(lock, queue->not_full, wait, [queue] { return queue->count < queue->length; })) {
+    return pdFAIL;
+  }
+  if (queue->item_size > 0) {
+    size_t slot = (queue->head + queue->count) % queue->length;
+    memcpy(&queue->storage[slot * queue->item_size], item, queue->item_size);
+  }
+  queue->count++;
+  lock.unlock();
+  queue->not_empty.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!wait_for(lock, queue->not_empty, wait, [queue] { return queue->count > 0; })) {
+    return pdFALSE;
+  }
+  if (queue->item_size > 0) {
+    memcpy(item, &queue->storage[queue->head * queue->item_size], queue->item_size);
+  }
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  lock.unlock();
+  queue->not_full.notify_one();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->length - queue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->head = 0;
+    queue->count = 0;
+  }
+  queue->not_full.notify_all();
+  return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return xSemaphoreCreateCounting(1, 1); }
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return xSemaphoreCreateCounting(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+  QueueHandle_t queue = xQueueCreate(max_count, 0);
+  if (queue != nullptr) {
+    queue->count = initial_count;
+  }
+  return queue;
+}
+
+static HostTask *self_task() {
+  if (current_task == nullptr) {
+    current_task = new HostTask("main", nullptr, nullptr);
+  }
+  return current_task;
+}
+
+// pthread plutôt que std::thread: vTaskDelete(nullptr) termine le thread par pthread_exit()
+static void *run_task(void *param) {
+  auto *task = (HostTask *) param;
+  current_task = task;
+  // Nom visible dans gdb et top (15 caractères au plus)
+  pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+  task->function(task->param);
+  return nullptr;
+}
+
+// Pile et priorité ignorées: les threads de l'hôte ont la pile et l'ordonnancement par défaut
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t /* stack_size */, void *param,
+                       UBaseType_t /* priority */, TaskHandle_t *handle) {
+  auto *task = new HostTask(name != nullptr ? name : "", function, param);
+  if (handle != nullptr) {
+    *handle = task;
+  }
+  pthread_t thread;
+  if (pthread_create(&thread, nullptr, run_task, task) != 0) {
+    if (handle != nullptr) {
+      *handle = nullptr;
+    }
+    delete task;
+    return pdFAIL;
+  }
+  pthread_detach(thread);
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_size, void *param,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t /* core_id */) {
+  return xTaskCreate(function, name, stack_size, param, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == nullptr || task == current_task) {
+    // La structure de la tâche reste allouée: un xTaskNotifyGive tardif ne vise pas de mémoire libérée
+    pthread_exit(nullptr);
+  }
+}
+
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return self_task(); }
+
+char *pcTaskGetName(TaskHandle_t task) { return &(task != nullptr ? task : self_task())->name[0]; }
+
+TickType_t xTaskGetTickCount() { return (TickType_t) (esp_timer_get_time() / 1000); }
+
+void taskYIELD() { sched_yield(); }
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait) {
+  HostTask *task = self_task();
+  std::unique_lock<std::mutex> lock(task->mutex);
+  wait_for(lock, task->notified, wait, [task] { return task->notify_count > 0; });
+  uint32_t value = task->notify_count;
+  if (value > 0) {
+    task->notify_count = clear_on_exit ? 0 : value - 1;
+  }
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notify_count++;
+  }
+  task->notified.notify_one();
+  return pdPASS;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "esp_err.h"
+#include <cstdio>
+
+#define ESP_ERROR_CHECK_WITHOUT_ABORT(x) \
+  ({ \
+    esp_err_t err_rc_ = (x); \
+    if (err_rc_ != ESP_OK) { \
+      fprintf(stderr, "%s:%d: %s a échoué: %s\n", __FILE__, __LINE__, #x, esp_err_to_name(err_rc_)); \
+    } \
+    err_rc_; \
+  })
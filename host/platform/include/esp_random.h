@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Aléa du noyau (getrandom)
+uint32_t esp_random();
+void esp_fill_random(void *buf, size_t len);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// CRC-32 IEEE 802.3 réfléchi, même résultat que la ROM de l'ESP32 (et que zlib crc32)
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
@@ -0,0 +1,3 @@
+#pragma once
+
+// Plateforme hôte: pas de watchdog des tâches
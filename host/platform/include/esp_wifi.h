@@ -0,0 +1,15 @@
+#pragma once
+
+// Plateforme hôte: aucune interface Wi-Fi, le réseau de la machine est toujours disponible
+
+#include "esp_err.h"
+#include <cstdint>
+
+typedef struct {
+  uint8_t bssid[6];
+  uint8_t ssid[33];
+  int8_t rssi;
+} wifi_ap_record_t;
+
+// Toujours connecté, au point d'accès fictif "host"
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+namespace esphome {
+namespace sensor {
+
+// Capteur réduit à sa dernière valeur publiée
+class Sensor {
+ public:
+  explicit Sensor(const std::string &name = "") : name_(name) {}
+
+  void publish_state(float state) {
+    this->state = state;
+    has_state_ = true;
+  }
+  float get_state() const { return state; }
+  bool has_state() const { return has_state_; }
+  const std::string &get_name() const { return name_; }
+
+  float state{0};
+
+ protected:
+  std::string name_;
+  bool has_state_{false};
+};
+
+}  // namespace sensor
+}  // namespace esphome
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+#include <cstdint>
+
+namespace esphome {
+
+namespace setup_priority {
+extern const float BUS;
+extern const float HARDWARE;
+extern const float DATA;
+extern const float WIFI;
+extern const float AFTER_WIFI;
+extern const float AFTER_CONNECTION;
+extern const float LATE;
+}  // namespace setup_priority
+
+// Sous-ensemble de Component: le programme hôte appelle lui-même setup() puis loop()
+class Component {
+ public:
+  virtual ~Component() = default;
+
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual void on_shutdown() {}
+  virtual float get_setup_priority() const;
+
+  virtual void mark_failed();
+  bool is_failed() const { return failed_; }
+
+ protected:
+  bool failed_{false};
+};
+
+}  // namespace esphome
@@ -0,0 +1,5 @@
+#pragma once
+
+// Plateforme hôte: USE_HOST comme la plateforme host d'ESPHome (définie par la compilation),
+// capteurs compilés pour que leur code soit couvert
+#define USE_SENSOR
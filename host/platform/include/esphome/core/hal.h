@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+
+// Horloge monotone depuis le démarrage du processus, avec le débordement 32 bits de l'appareil
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+}  // namespace esphome
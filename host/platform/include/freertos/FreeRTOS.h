@@ -0,0 +1,24 @@
+#pragma once
+
+// Plateforme hôte: sous-ensemble de FreeRTOS utilisé par le composant, implémenté sur pthreads
+// (host/platform/freertos.cpp). Un tick vaut une milliseconde.
+
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY ((TickType_t) 0xffffffffu)
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
+
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7fffffff
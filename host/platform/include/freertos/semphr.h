@@ -0,0 +1,16 @@
+#pragma once
+
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+// Les sémaphores sont des files d'éléments vides: Take reçoit, Give envoie.
+// Un mutex n'a pas d'héritage de priorité sur l'hôte.
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+
+#define xSemaphoreTake(sem, wait) xQueueReceive((sem), nullptr, (wait))
+#define xSemaphoreGive(sem) xQueueSend((sem), nullptr, 0)
+#define vSemaphoreDelete(sem) vQueueDelete(sem)
+#define uxSemaphoreGetCount(sem) uxQueueMessagesWaiting(sem)
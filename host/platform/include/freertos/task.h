@@ -0,0 +1,22 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Une tâche est un thread détaché; priorité, taille de pile et cœur sont ignorés
+typedef struct HostTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *param);
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_size, void *param,
+                       UBaseType_t priority, TaskHandle_t *handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_size, void *param,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core_id);
+// Seule la tâche courante (nullptr) peut être supprimée: le thread se termine
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+char *pcTaskGetName(TaskHandle_t task);
+TickType_t xTaskGetTickCount();
+void taskYIELD();
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
@@ -0,0 +1,20 @@
+#pragma once
+
+// Fonctions propres à la plateforme hôte, sans équivalent ESP-IDF: configuration de ce qui,
+// sur l'appareil, vient de la table de partitions, du menuconfig ou de l'ordonnanceur d'ESPHome
+
+#include <esp_http_server.h>
+#include <cstddef>
+#include <cstdint>
+
+// Déclare une partition de données en RAM (effacée à 0xFF), trouvée ensuite par esp_partition_find_first()
+bool host_partition_add(const char *label, size_t size);
+
+// Port TCP réellement écouté par un serveur démarré avec server_port = 0 (port choisi par le noyau)
+uint16_t host_httpd_port(httpd_handle_t handle);
+// Dernier serveur démarré par httpd_start(): le composant garde son handle pour lui
+httpd_handle_t host_httpd_last_started();
+
+// Niveau des logs ESP_LOGx (ESPHOME_LOG_LEVEL_*); par défaut la variable d'environnement
+// FTP_PROXY_LOG_LEVEL (0 à 7), sinon ESPHOME_LOG_LEVEL_WARN
+void host_log_set_level(int level);
@@ -0,0 +1,11 @@
+#pragma once
+
+// Plateforme hôte: sockets POSIX à la place de lwIP
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
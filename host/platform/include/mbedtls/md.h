@@ -0,0 +1,29 @@
+#pragma once
+
+// Plateforme hôte: HMAC de mbedtls réalisé avec l'API EVP_MAC d'OpenSSL (libcrypto)
+
+#include <cstddef>
+
+typedef enum {
+  MBEDTLS_MD_NONE = 0,
+  MBEDTLS_MD_SHA256 = 6,
+} mbedtls_md_type_t;
+
+typedef struct mbedtls_md_info_t mbedtls_md_info_t;
+
+typedef struct mbedtls_md_context_t {
+  const mbedtls_md_info_t *md_info;
+  void *mac_ctx;  // EVP_MAC_CTX*
+} mbedtls_md_context_t;
+
+#define MBEDTLS_ERR_MD_BAD_INPUT_DATA -0x5100
+#define MBEDTLS_ERR_MD_ALLOC_FAILED -0x5180
+
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t md_type);
+unsigned char mbedtls_md_get_size(const mbedtls_md_info_t *md_info);
+void mbedtls_md_init(mbedtls_md_context_t *ctx);
+void mbedtls_md_free(mbedtls_md_context_t *ctx);
+int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *md_info, int hmac);
+int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key, size_t keylen);
+int mbedtls_md_hmac_update(mbedtls_md_context_t *ctx, const unsigned char *input, size_t ilen);
+int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *output);
@@ -0,0 +1,4 @@
+#pragma once
+
+// Plateforme hôte: valeurs par défaut d'ESP-IDF utilisées par le composant
+#define CONFIG_ESP_TASK_WDT_TIMEOUT_S 5
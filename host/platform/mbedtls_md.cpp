@@ -0,0 +1,75 @@
+#include "mbedtls/md.h"
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+
+// Seul SHA-256 est utilisé par le composant (tokens de partage signés)
+struct mbedtls_md_info_t {
+  mbedtls_md_type_t type;
+  const char *openssl_name;
+  unsigned char size;
+};
+
+static const mbedtls_md_info_t SHA256_INFO = {MBEDTLS_MD_SHA256, "SHA256", 32};
+
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t md_type) {
+  return md_type == MBEDTLS_MD_SHA256 ? &SHA256_INFO : nullptr;
+}
+
+unsigned char mbedtls_md_get_size(const mbedtls_md_info_t *md_info) { return md_info != nullptr ? md_info->size : 0; }
+
+void mbedtls_md_init(mbedtls_md_context_t *ctx) {
+  ctx->md_info = nullptr;
+  ctx->mac_ctx = nullptr;
+}
+
+void mbedtls_md_free(mbedtls_md_context_t *ctx) {
+  EVP_MAC_CTX_free((EVP_MAC_CTX *) ctx->mac_ctx);
+  ctx->mac_ctx = nullptr;
+  ctx->md_info = nullptr;
+}
+
+int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *md_info, int hmac) {
+  if (md_info == nullptr || !hmac) {
+    return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+  }
+  EVP_MAC *mac = EVP_MAC_fetch(nullptr, OSSL_MAC_NAME_HMAC, nullptr);
+  if (mac == nullptr) {
+    return MBEDTLS_ERR_MD_ALLOC_FAILED;
+  }
+  ctx->mac_ctx = EVP_MAC_CTX_new(mac);
+  EVP_MAC_free(mac);
+  if (ctx->mac_ctx == nullptr) {
+    return MBEDTLS_ERR_MD_ALLOC_FAILED;
+  }
+  ctx->md_info = md_info;
+  return 0;
+}
+
+int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key, size_t keylen) {
+  if (ctx->mac_ctx == nullptr) {
+    return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+  }
+  OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char *) ctx->md_info->openssl_name, 0),
+      OSSL_PARAM_construct_end(),
+  };
+  return EVP_MAC_init((EVP_MAC_CTX *) ctx->mac_ctx, key, keylen, params) == 1 ? 0 : MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+}
+
+int mbedtls_md_hmac_update(mbedtls_md_context_t *ctx, const unsigned char *input, size_t ilen) {
+  if (ctx->mac_ctx == nullptr) {
+    return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+  }
+  return EVP_MAC_update((EVP_MAC_CTX *) ctx->mac_ctx, input, ilen) == 1 ? 0 : MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+}
+
+int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *output) {
+  if (ctx->mac_ctx == nullptr) {
+    return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+  }
+  size_t written = 0;
+  return EVP_MAC_final((EVP_MAC_CTX *) ctx->mac_ctx, output, &written, ctx->md_info->size) == 1
+             ? 0
+             : MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+}
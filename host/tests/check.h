@@ -0,0 +1,48 @@
+#pragma once
+
+// Assertions des tests hôtes: un échec est signalé et compté, le test continue. Chaque exécutable
+// se termine par check_exit(): les tâches du proxy tournent encore et ne doivent pas voir les
+// destructeurs statiques.
+
+#include <cstdio>
+#include <unistd.h>
+
+namespace esphome {
+namespace ftp_http_proxy {
+namespace host {
+
+inline int &check_failures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: échec: %s\n", __FILE__, __LINE__, #cond); \
+      esphome::ftp_http_proxy::host::check_failures()++; \
+    } \
+  } while (0)
+
+#define CHECK_EQ(a, b) \
+  do { \
+    auto check_a_ = (a); \
+    auto check_b_ = (b); \
+    if (!(check_a_ == check_b_)) { \
+      fprintf(stderr, "%s:%d: échec: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, (long long) check_a_, \
+              (long long) check_b_); \
+      esphome::ftp_http_proxy::host::check_failures()++; \
+    } \
+  } while (0)
+
+[[noreturn]] inline void check_exit(const char *name) {
+  int failures = check_failures();
+  printf("%s: %s (%d échec(s))\n", name, failures == 0 ? "OK" : "ÉCHEC", failures);
+  fflush(stdout);
+  fflush(stderr);
+  _exit(failures == 0 ? 0 : 1);
+}
+
+}  // namespace host
+}  // namespace ftp_http_proxy
+}  // namespace esphome
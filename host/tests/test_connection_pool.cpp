@@ -0,0 +1,54 @@
+// Pool de sessions FTP: des téléchargements successifs ne coûtent qu'un login
+#include "check.h"
+#include "host_harness.h"
+#include "http_client.h"
+#include "metrics.h"
+#include <chrono>
+#include <thread>
+
+using namespace esphome::ftp_http_proxy;
+using namespace esphome::ftp_http_proxy::host;
+
+static const int DOWNLOADS = 20;
+static const uint32_t IDLE_TIMEOUT_MS = 300;
+
+int main() {
+  FakeFtpServer ftp;
+  CHECK(ftp.start());
+  ftp.add_file("a.txt", std::string(5000, 'a'));
+  ftp.add_file("b.txt", std::string(70000, 'b'));
+
+  ProxyHarness harness(ftp);
+  harness.proxy().set_idle_timeout(IDLE_TIMEOUT_MS);
+  CHECK(harness.start());
+  uint16_t port = harness.http_port();
+
+  // Téléchargements et listings en série: une seule session, ouverte à la première requête
+  for (int i = 0; i < DOWNLOADS; i++) {
+    HttpResult result = http_get(port, i % 2 == 0 ? "/a.txt" : "/b.txt");
+    CHECK_EQ(result.status, 200);
+    CHECK_EQ(result.body.size(), i % 2 == 0 ? 5000u : 70000u);
+    if (i % 5 == 0) {
+      CHECK_EQ(http_get(port, "/api/files?dir=/").status, 200);
+    }
+  }
+  CHECK_EQ(ftp.logins(), 1u);
+  CHECK_EQ(ftp.sessions_opened(), 1u);
+  CHECK_EQ(ftp.count("USER"), 1u);
+  CHECK_EQ(proxy_metrics().ftp_logins.load(), 1u);
+
+  // Session coupée par le serveur: NOOP échoue, une nouvelle session remplace l'ancienne
+  ftp.drop_sessions();
+  CHECK_EQ(http_get(port, "/a.txt").status, 200);
+  CHECK_EQ(ftp.logins(), 2u);
+  CHECK_EQ(http_get(port, "/b.txt").status, 200);
+  CHECK_EQ(ftp.logins(), 2u);
+
+  // Inactivité: loop() ferme la session, la requête suivante se reconnecte
+  std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_TIMEOUT_MS * 3));
+  CHECK_EQ(ftp.active_sessions(), 0u);
+  CHECK_EQ(http_get(port, "/a.txt").status, 200);
+  CHECK_EQ(ftp.logins(), 3u);
+
+  check_exit("test_connection_pool");
+}
@@ -0,0 +1,86 @@
+// Mount local (LocalStorage): plages servies par sendfile() sur l'hôte, validateurs, envois
+#include "check.h"
+#include "host_harness.h"
+#include "http_client.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using namespace esphome::ftp_http_proxy::host;
+
+static std::string read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+int main() {
+  char root_template[] = "/tmp/ftp_proxy_mountXXXXXX";
+  std::string root = mkdtemp(root_template);
+  std::string content(200000, '\0');
+  for (size_t i = 0; i < content.size(); i++) {
+    content[i] = (char) (i % 253);
+  }
+  std::ofstream(root + "/film.mkv", std::ios::binary) << content;
+
+  FakeFtpServer ftp;
+  CHECK(ftp.start());
+  ProxyHarness harness(ftp);
+  harness.proxy().add_local_mount("sd", root);
+  CHECK(harness.start());
+  uint16_t port = harness.http_port();
+
+  HttpResult full = http_get(port, "/sd/film.mkv");
+  CHECK_EQ(full.status, 200);
+  CHECK(full.body == content);
+  CHECK(!full.headers["etag"].empty());
+
+  // Plage au milieu: positionnement dans le fichier, puis sendfile() de la seule tranche
+  HttpResult middle = http_get(port, "/sd/film.mkv", "Range: bytes=65537-131072\r\n");
+  CHECK_EQ(middle.status, 206);
+  CHECK(middle.body == content.substr(65537, 65536));
+  CHECK(middle.headers["content-range"] == "bytes 65537-131072/200000");
+
+  HttpResult suffix = http_get(port, "/sd/film.mkv", "Range: bytes=-100\r\n");
+  CHECK_EQ(suffix.status, 206);
+  CHECK(suffix.body == content.substr(content.size() - 100));
+
+  CHECK_EQ(http_get(port, "/sd/film.mkv", "Range: bytes=300000-\r\n").status, 416);
+  CHECK_EQ(http_get(port, "/sd/film.mkv", "If-None-Match: " + full.headers["etag"] + "\r\n").status, 304);
+  CHECK_EQ(http_get(port, "/sd/absent.mkv").status, 404);
+  CHECK(http_get(port, "/sd/../etc/passwd").status >= 400);
+  CHECK(http_get(port, "/sd/%2e%2e/etc/passwd").status >= 400);
+
+  // Envoi puis ajout (?append=1) dans le répertoire du mount, sans passer par le FTP
+  HttpRequest put;
+  put.method = "PUT";
+  put.path = "/sd/notes.txt";
+  put.body = "début";
+  HttpResult stored;
+  CHECK(http_request(port, put, stored));
+  CHECK(stored.status == 200 || stored.status == 201);
+  put.path = "/sd/notes.txt?append=1";
+  put.body = " suite";
+  CHECK(http_request(port, put, stored));
+  CHECK(stored.status == 200 || stored.status == 201);
+  CHECK(read_file(root + "/notes.txt") == "début suite");
+  CHECK_EQ(ftp.count("STOR") + ftp.count("APPE"), 0u);
+
+  // Chemin encodé: même fichier à l'envoi et au téléchargement
+  put.path = "/sd/mes%20notes.txt";
+  put.body = "encodé";
+  CHECK(http_request(port, put, stored));
+  CHECK(stored.status == 200 || stored.status == 201);
+  CHECK(read_file(root + "/mes notes.txt") == "encodé");
+  HttpResult encoded = http_get(port, "/sd/mes%20notes.txt");
+  CHECK_EQ(encoded.status, 200);
+  CHECK(encoded.body == "encodé");
+
+  remove((root + "/film.mkv").c_str());
+  remove((root + "/notes.txt").c_str());
+  remove((root + "/mes notes.txt").c_str());
+  remove(root.c_str());
+  check_exit("test_local_storage");
+}
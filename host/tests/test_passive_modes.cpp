@@ -0,0 +1,82 @@
+// Canal de données: EPSV par défaut, repli sur PASV, PASV seul, contrôle et données en IPv6.
+//   test_passive_modes epsv|pasv|ipv6 (un mode par processus: use_epsv est fixé au démarrage)
+#include "check.h"
+#include "host_harness.h"
+#include "http_client.h"
+#include <cstring>
+
+using namespace esphome::ftp_http_proxy::host;
+
+static std::string content;
+
+// Téléchargement complet, plage (REST), listing et envoi: tout ce qui ouvre un canal de données
+static void exercise(FakeFtpServer &ftp, uint16_t port, const std::string &name) {
+  HttpResult full = http_get(port, "/data/" + name);
+  CHECK_EQ(full.status, 200);
+  CHECK(full.body == content);
+  HttpResult range = http_get(port, "/data/" + name, "Range: bytes=5000-5999\r\n");
+  CHECK_EQ(range.status, 206);
+  CHECK(range.body == content.substr(5000, 1000));
+  HttpResult listing = http_get(port, "/api/files?dir=/data");
+  CHECK_EQ(listing.status, 200);
+  CHECK(listing.body.find(name) != std::string::npos);
+
+  HttpRequest put;
+  put.method = "PUT";
+  put.path = "/data/up-" + name;
+  put.body = "envoi " + name;
+  HttpResult stored;
+  CHECK(http_request(port, put, stored));
+  std::string uploaded;
+  CHECK(ftp.get_file("data/up-" + name, uploaded) && uploaded == put.body);
+}
+
+int main(int argc, char **argv) {
+  const char *mode = argc > 1 ? argv[1] : "epsv";
+  for (int i = 0; i < 50000; i++) {
+    content += (char) ('0' + i % 10);
+  }
+
+  FakeFtpServer::Options options;
+  options.ipv6 = strcmp(mode, "ipv6") == 0;
+  // Adresse PASV injoignable: le proxy doit se connecter à l'adresse du canal de contrôle
+  options.pasv_address = "10,0,0,99";
+  FakeFtpServer ftp(options);
+  CHECK(ftp.start());
+  ftp.add_file("data/a.bin", content);
+  ftp.add_file("data/b.bin", content);
+
+  ProxyHarness harness(ftp);
+  harness.proxy().set_use_epsv(strcmp(mode, "pasv") != 0);
+  // Chaque listing doit ouvrir un canal de données
+  harness.proxy().set_listing_cache_ttl(0);
+  CHECK(harness.start());
+  uint16_t port = harness.http_port();
+
+  if (strcmp(mode, "epsv") == 0) {
+    exercise(ftp, port, "a.bin");
+    CHECK(ftp.count("EPSV") >= 4);
+    CHECK_EQ(ftp.count("PASV"), 0u);
+
+    // Serveur sans EPSV: 502, repli sur PASV retenu pour le reste de la session
+    options.epsv = false;
+    ftp.set_options(options);
+    ftp.drop_sessions();
+    ftp.reset_counters();
+    exercise(ftp, port, "b.bin");
+    CHECK_EQ(ftp.count("EPSV"), 1u);
+    CHECK(ftp.count("PASV") >= 4);
+    CHECK_EQ(ftp.logins(), 1u);
+  } else if (strcmp(mode, "pasv") == 0) {
+    exercise(ftp, port, "a.bin");
+    CHECK_EQ(ftp.count("EPSV"), 0u);
+    CHECK(ftp.count("PASV") >= 4);
+  } else {
+    // Contrôle sur ::1: EPSV seul convient, PASV n'est jamais tenté
+    exercise(ftp, port, "a.bin");
+    CHECK(ftp.count("EPSV") >= 4);
+    CHECK_EQ(ftp.count("PASV"), 0u);
+  }
+
+  check_exit(mode);
+}
@@ -0,0 +1,76 @@
+// Parcours de bout en bout: client HTTP -> FTPHTTPProxy -> FakeFtpServer, sur le loopback
+#include "check.h"
+#include "host_harness.h"
+#include "http_client.h"
+
+using namespace esphome::ftp_http_proxy::host;
+
+int main() {
+  FakeFtpServer ftp;
+  CHECK(ftp.start());
+  std::string content;
+  for (int i = 0; i < 100000; i++) {
+    content += (char) ('a' + i % 26);
+  }
+  ftp.add_file("docs/a.txt", content);
+  ftp.add_file("docs/b.bin", std::string(1000, '\x7f'));
+
+  ProxyHarness harness(ftp);
+  CHECK(harness.start());
+  uint16_t port = harness.http_port();
+
+  // Interface embarquée
+  HttpResult index = http_get(port, "/");
+  CHECK_EQ(index.status, 200);
+  CHECK(index.headers["content-encoding"] == "gzip");
+  CHECK(!index.headers["etag"].empty());
+  CHECK_EQ(http_get(port, "/", "If-None-Match: " + index.headers["etag"] + "\r\n").status, 304);
+
+  // Téléchargement complet, puis une plage
+  HttpResult file = http_get(port, "/docs/a.txt");
+  CHECK_EQ(file.status, 200);
+  CHECK(file.complete);
+  CHECK(file.body == content);
+  CHECK(file.headers["accept-ranges"] == "bytes");
+
+  HttpResult range = http_get(port, "/docs/a.txt", "Range: bytes=1000-1999\r\n");
+  CHECK_EQ(range.status, 206);
+  CHECK(range.body == content.substr(1000, 1000));
+  CHECK(range.headers["content-range"] == "bytes 1000-1999/100000");
+
+  // 550 du RETR: relayé en erreur HTTP, la session de contrôle reste dans le pool
+  CHECK(http_get(port, "/docs/absent.txt").status >= 400);
+  CHECK_EQ(http_get(port, "/docs/b.bin").status, 200);
+
+  // Listing JSON
+  HttpResult listing = http_get(port, "/api/files?dir=/docs");
+  CHECK_EQ(listing.status, 200);
+  CHECK(listing.body.find("a.txt") != std::string::npos);
+  CHECK(listing.body.find("b.bin") != std::string::npos);
+
+  // Envoi, relu ensuite sur le serveur FTP
+  HttpRequest put;
+  put.method = "PUT";
+  put.path = "/docs/upload.txt";
+  put.body = "contenu envoyé";
+  HttpResult stored;
+  CHECK(http_request(port, put, stored));
+  CHECK(stored.status == 200 || stored.status == 201);
+  std::string uploaded;
+  CHECK(ftp.get_file("docs/upload.txt", uploaded));
+  CHECK(uploaded == put.body);
+
+  // Même chemin décodé à l'envoi et au téléchargement; requête ignorée, '+' littéral
+  put.path = "/docs/a%20b+c.txt?append=0";
+  CHECK(http_request(port, put, stored));
+  CHECK(stored.status == 200 || stored.status == 201);
+  CHECK(ftp.get_file("docs/a b+c.txt", uploaded));
+  HttpResult encoded = http_get(port, "/docs/a%20b+c.txt?v=1");
+  CHECK_EQ(encoded.status, 200);
+  CHECK(encoded.body == put.body);
+  // Retour à la ligne décodé: jamais transmis au serveur FTP
+  CHECK_EQ(http_get(port, "/docs/a.txt%0D%0ADELE%20docs/b.bin").status, 400);
+  CHECK_EQ(ftp.count("DELE"), 0u);
+
+  check_exit("test_proxy");
+}
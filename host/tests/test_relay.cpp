@@ -0,0 +1,109 @@
+// Relais direct vers un socket (splice() sur l'hôte): limite, fin de source, client parti
+#include "check.h"
+#include "loopback.h"
+#include "relay_engine.h"
+#include <csignal>
+#include <string>
+#include <thread>
+
+using namespace esphome::ftp_http_proxy;
+using namespace esphome::ftp_http_proxy::host;
+
+static std::string receive_all(int sock) {
+  std::string out;
+  char chunk[4096];
+  ssize_t n;
+  while ((n = recv(sock, chunk, sizeof(chunk), 0)) > 0) {
+    out.append(chunk, n);
+  }
+  return out;
+}
+
+int main() {
+  // Comme httpd_start() sur l'hôte: un envoi vers un client parti échoue au lieu de tuer le processus
+  signal(SIGPIPE, SIG_IGN);
+  RelayEngine relay;
+  CHECK(relay.init("test_relay", 2, 4096, false));
+  std::string content(300000, '\0');
+  for (size_t i = 0; i < content.size(); i++) {
+    content[i] = (char) (i * 7 + i / 251);
+  }
+
+  // Limite atteinte avant la fin de la source: seuls les premiers octets partent
+  {
+    int writer, source, dest, reader;
+    CHECK(tcp_pair(writer, source));
+    CHECK(tcp_pair(dest, reader));
+    std::thread producer([&]() {
+      send(writer, content.data(), content.size(), MSG_NOSIGNAL);
+      close(writer);
+    });
+    std::string received;
+    std::thread consumer([&]() { received = receive_all(reader); });
+    // Progression signalée au fil des blocs, pour les métriques en direct
+    size_t progress = 0;
+    uint32_t blocks = 0;
+    RelayResult result = relay.run_to_socket(source, dest, 100000, [&](size_t len) {
+      progress += len;
+      blocks++;
+    });
+    shutdown(dest, SHUT_WR);
+    producer.join();
+    consumer.join();
+    CHECK_EQ(result.status, RELAY_LIMIT);
+    CHECK_EQ(result.bytes, 100000u);
+    CHECK_EQ(progress, 100000u);
+    CHECK(blocks > 1);
+    CHECK(result.first_data_us > 0);
+    CHECK(received == content.substr(0, 100000));
+    close(source);
+    close(dest);
+    close(reader);
+  }
+
+  // Source fermée: tout est relayé, fin signalée par RELAY_EOF
+  {
+    int writer, source, dest, reader;
+    CHECK(tcp_pair(writer, source));
+    CHECK(tcp_pair(dest, reader));
+    std::thread producer([&]() {
+      send(writer, content.data(), content.size(), MSG_NOSIGNAL);
+      close(writer);
+    });
+    std::string received;
+    std::thread consumer([&]() { received = receive_all(reader); });
+    RelayResult result = relay.run_to_socket(source, dest, -1);
+    shutdown(dest, SHUT_WR);
+    producer.join();
+    consumer.join();
+    CHECK_EQ(result.status, RELAY_EOF);
+    CHECK_EQ(result.bytes, content.size());
+    CHECK(received == content);
+    close(source);
+    close(dest);
+    close(reader);
+  }
+
+  // Client déconnecté: erreur côté destination, sans SIGPIPE ni blocage sur la source
+  {
+    int writer, source, dest, reader;
+    CHECK(tcp_pair(writer, source));
+    CHECK(tcp_pair(dest, reader));
+    close(reader);
+    std::thread producer([&]() {
+      for (int i = 0; i < 100; i++) {
+        if (send(writer, content.data(), content.size(), MSG_NOSIGNAL) <= 0) {
+          break;
+        }
+      }
+      close(writer);
+    });
+    RelayResult result = relay.run_to_socket(source, dest, -1);
+    CHECK_EQ(result.status, RELAY_SINK_ERROR);
+    close(source);
+    producer.join();
+    close(dest);
+  }
+
+  check_exit("test_relay");
+}
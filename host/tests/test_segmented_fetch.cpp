@@ -0,0 +1,64 @@
+// Téléchargement segmenté: une session qui refuse son segment est écartée avant l'envoi des en-têtes
+#include "check.h"
+#include "host_harness.h"
+#include "http_client.h"
+#include <string>
+
+using namespace esphome::ftp_http_proxy;
+using namespace esphome::ftp_http_proxy::host;
+
+static const size_t FILE_SIZE = 1024 * 1024;
+static const uint32_t SEGMENT_SIZE = 64 * 1024;
+
+int main() {
+  std::string content(FILE_SIZE, '\0');
+  for (size_t i = 0; i < content.size(); i++) {
+    content[i] = (char) ((i * 131 + i / 4099) & 0xff);
+  }
+
+  FakeFtpServer ftp;
+  CHECK(ftp.start());
+  ftp.add_file("big.bin", content);
+
+  ProxyHarness harness(ftp);
+  harness.proxy().set_pool_size(3);
+  harness.proxy().set_segment_connections(3);
+  harness.proxy().set_segment_size(SEGMENT_SIZE);
+  harness.proxy().set_segment_min_file_size(256 * 1024);
+  CHECK(harness.start());
+  uint16_t port = harness.http_port();
+
+  // Trois sessions, un REST par segment
+  HttpResult result = http_get(port, "/big.bin");
+  CHECK_EQ(result.status, 200);
+  CHECK(result.body == content);
+  CHECK_EQ(ftp.sessions_opened(), 3u);
+  CHECK_EQ(ftp.count("REST"), FILE_SIZE / SEGMENT_SIZE);
+
+  // Une session refuse tout RETR: les deux autres se partagent les segments
+  FakeFtpServer::Options options = ftp.options();
+  options.refuse_retr_session = 2;
+  ftp.set_options(options);
+  ftp.reset_counters();
+  result = http_get(port, "/big.bin");
+  CHECK_EQ(result.status, 200);
+  CHECK(result.body == content);
+  CHECK_EQ(ftp.count("RETR"), FILE_SIZE / SEGMENT_SIZE + 1);
+
+  result = http_get(port, "/big.bin", "Range: bytes=300000-\r\n");
+  CHECK_EQ(result.status, 206);
+  CHECK(result.body == content.substr(300000));
+
+  // REST refusé partout: repli sur un flux unique, fichier complet
+  options.refuse_retr_session = 0;
+  options.rest = false;
+  ftp.set_options(options);
+  ftp.reset_counters();
+  result = http_get(port, "/big.bin");
+  CHECK_EQ(result.status, 200);
+  CHECK(result.body == content);
+  // Sessions resynchronisées après le refus: aucune nouvelle connexion
+  CHECK_EQ(ftp.sessions_opened(), 0u);
+
+  check_exit("test_segmented_fetch");
+}
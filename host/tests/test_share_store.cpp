@@ -0,0 +1,106 @@
+// Image des partages sur partition: fusion des changements, réouverture, emplacement altéré
+#include "check.h"
+#include "host_platform.h"
+#include "share_store.h"
+#include "share_token.h"
+#include <vector>
+
+using namespace esphome::ftp_http_proxy;
+using namespace esphome::ftp_http_proxy::host;
+
+static const size_t PARTITION_SIZE = 1024 * 1024;
+static const size_t SLOT_SIZE = PARTITION_SIZE / 2;
+static const size_t HEADER_SIZE = 7 * sizeof(uint32_t);
+
+// Met à 0 le premier octet non nul des enregistrements d'un emplacement (la flash ne sait
+// que faire passer des bits de 1 à 0): l'en-tête reste valide, le CRC du contenu ne l'est plus
+static void corrupt_slot(uint32_t slot) {
+  const esp_partition_t *partition =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "shares");
+  std::vector<uint8_t> body(256);
+  size_t offset = slot * SLOT_SIZE + HEADER_SIZE;
+  CHECK(esp_partition_read(partition, offset, body.data(), body.size()) == ESP_OK);
+  for (size_t i = 0; i < body.size(); i++) {
+    if (body[i] != 0) {
+      uint8_t zero = 0;
+      CHECK(esp_partition_write(partition, offset + i, &zero, 1) == ESP_OK);
+      return;
+    }
+  }
+  CHECK(!"aucun octet à altérer");
+}
+
+int main() {
+  CHECK(host_partition_add("shares", PARTITION_SIZE));
+  {
+    ShareStore missing;
+    CHECK(!missing.open("absente"));
+  }
+
+  ShareStore store;
+  CHECK(store.open("shares"));
+  bool shareable;
+  std::string path;
+  uint32_t expiry;
+  CHECK(!store.find_file("a", shareable));
+
+  CHECK(store.commit({{"films/a.mkv", true}, {"doc/b.pdf", true}}, {{0x12345678, "films/a.mkv", 2000000000}}, false,
+                     1700000000));
+  CHECK(store.find_file("films/a.mkv", shareable) && shareable);
+  CHECK(store.find_path(share_path_id("doc/b.pdf"), path) && path == "doc/b.pdf");
+  CHECK(store.find_share(0x12345678, path, expiry) && path == "films/a.mkv" && expiry == 2000000000);
+
+  // Plus partageables: a.mkv reste (un lien le désigne), b.pdf disparaît de l'image
+  CHECK(store.commit({{"films/a.mkv", false}, {"doc/b.pdf", false}}, {}, false, 1700000000));
+  CHECK(store.find_file("films/a.mkv", shareable) && !shareable);
+  CHECK(!store.find_file("doc/b.pdf", shareable));
+  CHECK(!store.find_path(share_path_id("films/a.mkv"), path));
+  CHECK_EQ(store.file_count(), 1u);
+  CHECK_EQ(store.share_count(), 1u);
+
+  // Liens échus écartés, révocation de tous les liens de l'image
+  CHECK(store.commit({}, {{0x1, "x", 1600000000}}, false, 1700000000));
+  CHECK(!store.find_share(0x1, path, expiry));
+  CHECK(store.commit({{"y", true}}, {}, true, 0));
+  CHECK(!store.find_share(0x12345678, path, expiry));
+
+  // Réouverture (redémarrage): la dernière image est retenue
+  {
+    ShareStore reopened;
+    CHECK(reopened.open("shares"));
+    CHECK(reopened.find_file("y", shareable) && shareable);
+    CHECK(!reopened.find_file("films/a.mkv", shareable));
+  }
+
+  // Deux nouvelles images, la plus récente altérée: l'image précédente est servie, puis le
+  // commit suivant réécrit l'emplacement altéré
+  CHECK(store.commit({{"c", true}}, {}, false, 0));
+  CHECK(store.commit({{"d", true}}, {}, false, 0));
+  {
+    ShareStore probe;
+    CHECK(probe.open("shares"));
+    CHECK(probe.find_file("d", shareable));
+  }
+  // Emplacement le plus récent: séquence (second mot de l'en-tête) la plus haute
+  const esp_partition_t *partition =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "shares");
+  uint32_t headers[2][2];
+  esp_partition_read(partition, 0, headers[0], sizeof(headers[0]));
+  esp_partition_read(partition, SLOT_SIZE, headers[1], sizeof(headers[1]));
+  corrupt_slot((int32_t) (headers[1][1] - headers[0][1]) > 0 ? 1 : 0);
+  {
+    ShareStore fallback;
+    CHECK(fallback.open("shares"));
+    CHECK(fallback.find_file("c", shareable) && shareable);
+    CHECK(!fallback.find_file("d", shareable));
+    CHECK(fallback.commit({{"e", true}}, {}, false, 0));
+  }
+  {
+    ShareStore repaired;
+    CHECK(repaired.open("shares"));
+    CHECK(repaired.find_file("c", shareable));
+    CHECK(repaired.find_file("e", shareable));
+  }
+
+  check_exit("test_share_store");
+}